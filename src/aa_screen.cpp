@@ -95,8 +95,11 @@ void AaScreen::blit(Layer *src) {
     return;
   }
 
-  if(src->need_crop)
+  if(src->need_crop) {
+    src->lock(); // the layer can change its geometry
     src->blitter->crop( src, this );
+    src->unlock();
+  }
 
   b = src->current_blit;
 
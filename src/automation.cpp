@@ -0,0 +1,266 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include <automation.h>
+#include <parameter.h>
+#include <fps.h>
+#include <jutils.h>
+
+Automation::track_t *Automation::track = NULL;
+int Automation::ntracks = 0;
+int Automation::tracks_alloc = 0;
+Automation::key_t *Automation::keys = NULL;
+int Automation::nkeys = 0;
+int Automation::keys_alloc = 0;
+int Automation::next_id = 1;
+uint64_t Automation::evaluated = 0;
+uint64_t Automation::applied = 0;
+
+// tracks are added from javascript and controllers, run by the context
+static pthread_mutex_t automation_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int Automation::add_track(track_t *t, const double *times, const double *values, int n) {
+  int c;
+
+  if(!t->param || n < 1) {
+    error("automation needs a parameter and at least a keyframe");
+    return -1;
+  }
+  if(t->param->type == Parameter::NUMBER) t->component = 0;
+  else if(t->param->type == Parameter::POSITION) {
+    if(t->component < 0 || t->component > 1) return -1;
+  } else if(t->param->type == Parameter::COLOR) {
+    if(t->component < 0 || t->component > 2) return -1;
+  } else {
+    error("parameter %s can't be automated", t->param->name);
+    return -1;
+  }
+  for(c = 1; c < n; c++)
+    if(times[c] < times[c - 1]) {
+      error("keyframes of parameter %s are not in time order", t->param->name);
+      return -1;
+    }
+
+  pthread_mutex_lock(&automation_lock);
+
+  if(ntracks == tracks_alloc) {
+    tracks_alloc = tracks_alloc ? tracks_alloc * 2 : 32;
+    track = (track_t*)realloc(track, tracks_alloc * sizeof(track_t));
+  }
+  if(nkeys + n > keys_alloc) {
+    while(nkeys + n > keys_alloc)
+      keys_alloc = keys_alloc ? keys_alloc * 2 : 256;
+    keys = (key_t*)realloc(keys, keys_alloc * sizeof(key_t));
+  }
+
+  // the keyframes of a track follow each other
+  t->first = nkeys;
+  t->count = n;
+  for(c = 0; c < n; c++) {
+    keys[nkeys + c].time = times[c];
+    // values are in the range of Parameter::set()
+    keys[nkeys + c].value = (values[c] < 0.0) ? 0.0 : (values[c] > 1.0) ? 1.0 : values[c];
+  }
+  nkeys += n;
+
+  t->id = next_id++;
+  t->cursor = 0;
+  t->done = false;
+  t->start = FPS::now() / 1000000000.0;
+  t->last = -1.0; // the first value is always applied
+  track[ntracks++] = *t;
+
+  pthread_mutex_unlock(&automation_lock);
+
+  func("automation track %u on parameter %s with %u keyframes", t->id, t->param->name, n);
+  return t->id;
+}
+
+int Automation::add(Layer *lay, Parameter *param, int idx, int component,
+		    const double *times, const double *values, int n,
+		    automation_curve_t curve, iterator_mode_t mode) {
+  track_t t;
+  t.param = param;
+  t.owner = lay;
+  t.layer = true;
+  t.idx = idx;
+  t.component = component;
+  t.curve = curve;
+  t.mode = mode;
+  return add_track(&t, times, values, n);
+}
+
+int Automation::add(FilterInstance *filt, Parameter *param, int idx, int component,
+		    const double *times, const double *values, int n,
+		    automation_curve_t curve, iterator_mode_t mode) {
+  track_t t;
+  t.param = param;
+  t.owner = filt;
+  t.layer = false;
+  t.idx = idx;
+  t.component = component;
+  t.curve = curve;
+  t.mode = mode;
+  return add_track(&t, times, values, n);
+}
+
+// called with the lock held
+void Automation::remove_track(int t) {
+  int first = track[t].first, count = track[t].count;
+  int c;
+
+  // close the gap in the keyframes, then in the tracks
+  memmove(keys + first, keys + first + count, (nkeys - first - count) * sizeof(key_t));
+  nkeys -= count;
+  for(c = 0; c < ntracks; c++)
+    if(track[c].first > first) track[c].first -= count;
+
+  memmove(track + t, track + t + 1, (ntracks - t - 1) * sizeof(track_t));
+  ntracks--;
+}
+
+bool Automation::remove(int id) {
+  bool found = false;
+  int c;
+
+  pthread_mutex_lock(&automation_lock);
+  for(c = 0; c < ntracks; c++)
+    if(track[c].id == id) {
+      remove_track(c);
+      found = true;
+      break;
+    }
+  pthread_mutex_unlock(&automation_lock);
+  return found;
+}
+
+void Automation::drop(void *owner) {
+  int c;
+
+  pthread_mutex_lock(&automation_lock);
+  for(c = ntracks - 1; c >= 0; c--)
+    if(track[c].owner == owner)
+      remove_track(c);
+  pthread_mutex_unlock(&automation_lock);
+}
+
+int Automation::tracks() {
+  return ntracks;
+}
+
+double Automation::eval(track_t *t, double now) {
+  key_t *k = keys + t->first;
+  double local, length, f;
+  int last = t->count - 1;
+
+  local = now - t->start;
+  length = k[last].time;
+
+  // fold the time of repeating tracks in the envelope
+  if(local > length) {
+    if(length <= 0.0) local = length;
+    else switch(t->mode) {
+    case LOOP:
+      local = fmod(local, length);
+      break;
+    case BOUNCE:
+      local = fmod(local, 2.0 * length);
+      if(local > length) local = 2.0 * length - local;
+      break;
+    case PULSE: // there and back once
+      if(local >= 2.0 * length) {
+	local = 0.0;
+	t->done = true;
+      } else local = 2.0 * length - local;
+      break;
+    default: // ONCE
+      local = length;
+      t->done = true;
+    }
+  }
+
+  // the keyframe before the time, searched from the last one found
+  if(local < k[t->cursor].time) t->cursor = 0;
+  while(t->cursor < last && k[t->cursor + 1].time <= local) t->cursor++;
+
+  if(t->cursor == last || local <= k[t->cursor].time)
+    return k[t->cursor].value;
+
+  k += t->cursor;
+  f = (local - k[0].time) / (k[1].time - k[0].time);
+  switch(t->curve) {
+  case AUTOMATION_STEP:
+    return k[0].value;
+  case AUTOMATION_SMOOTH:
+    f = (1.0 - cos(f * M_PI)) * 0.5;
+    // fall through
+  default:
+    return k[0].value + (k[1].value - k[0].value) * f;
+  }
+}
+
+void Automation::apply(track_t *t, double v) {
+  Parameter *p = t->param;
+
+  if(p->type == Parameter::NUMBER) {
+    *(double*)p->value = (p->multiplier != 1.0) ? v * p->multiplier : v;
+  } else
+    ((double*)p->value)[t->component] = v;
+
+  if(t->layer) {
+    if(p->layer_set_f)
+      (*p->layer_set_f)((Layer*)t->owner, p, t->idx);
+  } else
+    p->changed = true; // the filter applies it before its next frame
+}
+
+int Automation::run(uint64_t now) {
+  double secs = now / 1000000000.0;
+  double v;
+  int c, n = 0;
+
+  pthread_mutex_lock(&automation_lock);
+
+  for(c = 0; c < ntracks; c++) {
+    track_t *t = track + c;
+    if(t->done) continue;
+
+    v = eval(t, secs);
+    evaluated++;
+    if(v == t->last) continue;
+
+    apply(t, v);
+    t->last = v;
+    n++;
+  }
+
+  // finished tracks leave the value at their end
+  for(c = ntracks - 1; c >= 0; c--)
+    if(track[c].done) remove_track(c);
+
+  applied += n;
+  pthread_mutex_unlock(&automation_lock);
+
+  return n;
+}
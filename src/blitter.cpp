@@ -27,6 +27,8 @@
 
 
 #include <sdl_screen.h>
+#include <rotozoom.h>
+#include <buffer_pool.h>
 
 #include <jutils.h>
 #include <config.h>
@@ -44,6 +46,18 @@ Blit::Blit() :Entry() {
   type = NONE;
   past_frame = NULL;
 
+  mixer = NULL;
+  mixer_rows = false;
+  mixer_w = mixer_h = 0;
+  mixer_by_rows = false;
+  mixer_band = NULL;
+  mixer_bands = 0;
+  mixer_band_w = 0;
+  mixer_defaults = false;
+  mixer_time = 0.0;
+  mixer_stage = NULL;
+  mixer_stage_size = 0;
+
 }
 
 Blit::~Blit() {
@@ -55,11 +69,16 @@ Blit::~Blit() {
     delete par;
     par = parameters.begin();
   }
+  if(mixer) delete mixer;
+  while(mixer_bands) delete mixer_band[--mixer_bands];
+  free(mixer_band);
+  BufferPool::put(mixer_stage);
 }
 
 Blitter::Blitter() {
 
   screen = NULL;
+  rotozoom = NULL;
 
   old_lay_x = 0;
   old_lay_y = 0;
@@ -78,6 +97,7 @@ Blitter::~Blitter() {
     b = blitlist.begin();
   }
 
+  if(rotozoom) delete rotozoom;
 }
 
 
@@ -186,7 +206,8 @@ void Blitter::crop(Layer *lay, ViewPort *scr) {
 
     // crop for the linear and past blit
   } else if(b->type == Blit::LINEAR 
-	    || b->type == Blit::PAST) {
+	    || b->type == Blit::PAST
+	    || b->type == Blit::MIXER) {
 
     b->lay_pitch =  geo->w; // how many pixels to copy each row
     b->lay_height = geo->h; // how many rows we should copy
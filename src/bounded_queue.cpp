@@ -0,0 +1,134 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <stdlib.h>
+
+#include <bounded_queue.h>
+#include <jutils.h>
+#include <config.h>
+
+BoundedQueue::BoundedQueue() {
+  items = NULL;
+  len = head = count = 0;
+  aborted = false;
+
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&not_empty, NULL);
+  pthread_cond_init(&not_full, NULL);
+}
+
+BoundedQueue::~BoundedQueue() {
+  if(items) free(items);
+  pthread_cond_destroy(&not_full);
+  pthread_cond_destroy(&not_empty);
+  pthread_mutex_destroy(&mutex);
+}
+
+bool BoundedQueue::init(int size) {
+  if(size <= 0) {
+    error("bounded queue size must be positive, not %i", size);
+    return false;
+  }
+  pthread_mutex_lock(&mutex);
+  items = (void**)realloc(items, size * sizeof(void*));
+  len = size;
+  head = count = 0;
+  pthread_mutex_unlock(&mutex);
+  return (items != NULL);
+}
+
+bool BoundedQueue::push(void *item) {
+  pthread_mutex_lock(&mutex);
+  while(count == len && !aborted)
+    pthread_cond_wait(&not_full, &mutex);
+  if(aborted) {
+    pthread_mutex_unlock(&mutex);
+    return false;
+  }
+  items[(head + count) % len] = item;
+  count++;
+  pthread_cond_signal(&not_empty);
+  pthread_mutex_unlock(&mutex);
+  return true;
+}
+
+bool BoundedQueue::try_push(void *item) {
+  bool pushed = false;
+  pthread_mutex_lock(&mutex);
+  if(count < len && !aborted) {
+    items[(head + count) % len] = item;
+    count++;
+    pthread_cond_signal(&not_empty);
+    pushed = true;
+  }
+  pthread_mutex_unlock(&mutex);
+  return pushed;
+}
+
+void *BoundedQueue::pop() {
+  void *item;
+  pthread_mutex_lock(&mutex);
+  while(count == 0 && !aborted)
+    pthread_cond_wait(&not_empty, &mutex);
+  if(aborted) {
+    pthread_mutex_unlock(&mutex);
+    return NULL;
+  }
+  item = items[head];
+  head = (head + 1) % len;
+  count--;
+  pthread_cond_signal(&not_full);
+  pthread_mutex_unlock(&mutex);
+  return item;
+}
+
+void *BoundedQueue::try_pop() {
+  void *item = NULL;
+  pthread_mutex_lock(&mutex);
+  if(count) {
+    item = items[head];
+    head = (head + 1) % len;
+    count--;
+    pthread_cond_signal(&not_full);
+  }
+  pthread_mutex_unlock(&mutex);
+  return item;
+}
+
+void BoundedQueue::abort() {
+  pthread_mutex_lock(&mutex);
+  aborted = true;
+  pthread_cond_broadcast(&not_empty);
+  pthread_cond_broadcast(&not_full);
+  pthread_mutex_unlock(&mutex);
+}
+
+void BoundedQueue::reset() {
+  pthread_mutex_lock(&mutex);
+  aborted = false;
+  pthread_mutex_unlock(&mutex);
+}
+
+int BoundedQueue::depth() {
+  int c;
+  pthread_mutex_lock(&mutex);
+  c = count;
+  pthread_mutex_unlock(&mutex);
+  return c;
+}
@@ -0,0 +1,147 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <buffer_pool.h>
+#include <jutils.h>
+
+// the size of a buffer and the slabs it goes back to are stored
+// before it, keeping the alignment
+#define HEADER 16
+enum { FRAME, PACKET };
+
+uint64_t BufferPool::allocations = 0;
+uint64_t BufferPool::reuses = 0;
+size_t BufferPool::kept = 0;
+size_t BufferPool::used = 0;
+BufferPool::slab_t BufferPool::slabs[BUFFER_POOL_SLABS];
+int BufferPool::nslabs = 0;
+BufferPool::slab_t BufferPool::packets[BUFFER_POOL_PACKET_SLABS];
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+BufferPool::slab_t *BufferPool::find(size_t size) {
+  int c;
+  for(c = 0; c < nslabs; c++)
+    if(slabs[c].size == size) return &slabs[c];
+  if(nslabs == BUFFER_POOL_SLABS) return NULL;
+  slabs[nslabs].size = size;
+  slabs[nslabs].count = 0;
+  return &slabs[nslabs++];
+}
+
+// the slab of the power of two size was rounded to, NULL past the
+// largest one: those are freed when given back
+BufferPool::slab_t *BufferPool::find_packet(size_t size) {
+  int c;
+  for(c = 0; c < BUFFER_POOL_PACKET_SLABS; c++)
+    if(((size_t)64 << c) == size) {
+      packets[c].size = size;
+      return &packets[c];
+    }
+  return NULL;
+}
+
+void *BufferPool::take(size_t size, int kind) {
+  slab_t *slab;
+  uint8_t *buf = NULL;
+
+  pthread_mutex_lock(&pool_lock);
+  slab = (kind == PACKET) ? find_packet(size) : find(size);
+  if(slab && slab->count) {
+    buf = (uint8_t*)slab->free[--slab->count];
+    kept -= size;
+    reuses++;
+  }
+  used += size;
+  pthread_mutex_unlock(&pool_lock);
+
+  if(!buf) {
+    if(posix_memalign((void**)&buf, HEADER, size + HEADER) != 0) {
+      error("BufferPool :: can't allocate %lu bytes", (unsigned long)size);
+      pthread_mutex_lock(&pool_lock);
+      used -= size;
+      pthread_mutex_unlock(&pool_lock);
+      return NULL;
+    }
+    ((size_t*)buf)[0] = size;
+    ((size_t*)buf)[1] = kind;
+    __sync_fetch_and_add(&allocations, 1);
+  }
+  return buf + HEADER;
+}
+
+void *BufferPool::get(size_t size) {
+  // the frames of a geometry are all of one size, a slab each
+  return take((size + 63) & ~(size_t)63, FRAME);
+}
+
+void *BufferPool::get_packet(size_t size) {
+  size_t r;
+  for(r = 64; r < size; r <<= 1) continue;
+  return take(r, PACKET);
+}
+
+void *BufferPool::get_zero(size_t size) {
+  void *buf = get(size);
+  if(buf) memset(buf, 0, size);
+  return buf;
+}
+
+void BufferPool::put(void *ptr) {
+  slab_t *slab;
+  uint8_t *buf;
+  size_t size;
+
+  if(!ptr) return;
+  buf = (uint8_t*)ptr - HEADER;
+  size = ((size_t*)buf)[0];
+
+  pthread_mutex_lock(&pool_lock);
+  used -= size;
+  slab = (((size_t*)buf)[1] == PACKET) ? find_packet(size) : find(size);
+  if(slab && slab->count < BUFFER_POOL_KEEP
+     && kept + size <= BUFFER_POOL_KEEP_BYTES) {
+    slab->free[slab->count++] = buf;
+    kept += size;
+    buf = NULL;
+  }
+  pthread_mutex_unlock(&pool_lock);
+
+  // no room to keep it
+  if(buf) free(buf);
+}
+
+void BufferPool::trim() {
+  int c;
+
+  pthread_mutex_lock(&pool_lock);
+  for(c = 0; c < nslabs; c++)
+    while(slabs[c].count)
+      free(slabs[c].free[--slabs[c].count]);
+  nslabs = 0;
+  for(c = 0; c < BUFFER_POOL_PACKET_SLABS; c++)
+    while(packets[c].count)
+      free(packets[c].free[--packets[c].count]);
+  kept = 0;
+  pthread_mutex_unlock(&pool_lock);
+}
@@ -272,3 +272,32 @@ JSBool _js_is_instanceOf(JSContext* cx, JSClass* clasp, jsval v, const char* cal
     return ret;
 }
 
+int js_get_keyframes(JSContext *cx, jsval val, double *times, double *values, int max) {
+  JSObject *arr;
+  jsuint len, c;
+  jsval el;
+  jsdouble t, v;
+  int n = 0;
+
+  if(!JSVAL_IS_OBJECT(val) || JSVAL_IS_NULL(val)
+     || !JS_IsArrayObject(cx, (arr = JSVAL_TO_OBJECT(val)))) {
+    error("keyframes should be an array of times and values");
+    return 0;
+  }
+  JS_GetArrayLength(cx, arr, &len);
+  if(len & 1)
+    warning("odd number of elements in keyframes, the last one is ignored");
+
+  for(c = 0; c + 1 < len && n < max; c += 2) {
+    JS_GetElement(cx, arr, c, &el);
+    if(!JS_ValueToNumber(cx, el, &t)) break;
+    JS_GetElement(cx, arr, c + 1, &el);
+    if(!JS_ValueToNumber(cx, el, &v)) break;
+    times[n] = t;
+    values[n] = v;
+    n++;
+  }
+  if(n == max && c + 1 < len)
+    warning("too many keyframes, only the first %u are used", max);
+  return n;
+}
@@ -0,0 +1,217 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <clip_cache.h>
+#include <jutils.h>
+#include <config.h>
+
+size_t ClipCache::budget = 0;
+size_t ClipCache::used = 0;
+uint64_t ClipCache::uses = 0;
+
+CachedClip::CachedClip()
+  : Entry() {
+  width = height = 0;
+  count = 0;
+  complete = false;
+  frames = NULL;
+  times = NULL;
+  capacity = 0;
+  frame_size = 0;
+  bytes = 0;
+  users = 0;
+  last_use = 0;
+}
+
+CachedClip::~CachedClip() {
+  int c;
+  for(c = 0; c < count; c++)
+    free(frames[c]);
+  if(frames) free(frames);
+  if(times) free(times);
+}
+
+int CachedClip::find(double t) {
+  int lo = 0, hi = count - 1, mid;
+
+  if(count < 1 || t <= times[0]) return 0;
+  // times grow with the frame number
+  while(lo < hi) {
+    mid = (lo + hi + 1) / 2;
+    if(times[mid] <= t) lo = mid;
+    else hi = mid - 1;
+  }
+  return lo;
+}
+
+Linklist<CachedClip> &ClipCache::clips() {
+  static Linklist<CachedClip> all;
+  return all;
+}
+
+void ClipCache::set_budget(size_t bytes) {
+  clips().lock();
+  budget = bytes;
+  reserve(0, NULL);
+  clips().unlock();
+  act("clip cache budget is %lu MB, %lu MB in use",
+      budget / 1048576, used / 1048576);
+}
+
+CachedClip *ClipCache::find(const char *file, int w, int h) {
+  CachedClip *clip;
+
+  clips().lock();
+  clip = clips().begin();
+  while(clip) {
+    if(clip->complete && clip->width == w && clip->height == h
+       && strncmp(clip->name, file, sizeof(clip->name)) == 0) {
+      clip->users++;
+      clip->last_use = ++uses;
+      break;
+    }
+    clip = (CachedClip*)clip->next;
+  }
+  clips().unlock();
+  return clip;
+}
+
+CachedClip *ClipCache::create(const char *file, int w, int h) {
+  CachedClip *clip;
+
+  if(!budget) return NULL;
+
+  clip = new CachedClip();
+  clip->set_name(file);
+  clip->width = w;
+  clip->height = h;
+  clip->frame_size = w * h * 4;
+  clip->users = 1;
+
+  clips().lock();
+  clip->last_use = ++uses;
+  clips().append(clip);
+  clips().unlock();
+  return clip;
+}
+
+bool ClipCache::add_frame(CachedClip *clip, const uint8_t *rgba, double pts) {
+  uint8_t *buf;
+  size_t need = clip->frame_size;
+  int cap;
+
+  if(clip->count == clip->capacity)
+    need += (clip->capacity ? clip->capacity : 64) * (sizeof(uint8_t*) + sizeof(double));
+
+  clips().lock();
+  if(!reserve(need, clip)) {
+    clips().unlock();
+    return false;
+  }
+  used += need;
+  clip->bytes += need;
+  clip->last_use = ++uses;
+  clips().unlock();
+
+  if(clip->count == clip->capacity) {
+    uint8_t **frames;
+    double *times;
+    cap = clip->capacity ? clip->capacity * 2 : 64;
+    frames = (uint8_t**)realloc(clip->frames, cap * sizeof(uint8_t*));
+    if(frames) clip->frames = frames;
+    times = (double*)realloc(clip->times, cap * sizeof(double));
+    if(times) clip->times = times;
+    if(!frames || !times) {
+      error("clip cache out of memory growing %s", clip->name);
+      unreserve(clip, need);
+      return false;
+    }
+    clip->capacity = cap;
+  }
+
+  buf = (uint8_t*)malloc(clip->frame_size);
+  if(!buf) {
+    error("clip cache out of memory for a frame of %s", clip->name);
+    unreserve(clip, clip->frame_size);
+    return false;
+  }
+  memcpy(buf, rgba, clip->frame_size);
+  clip->frames[clip->count] = buf;
+  clip->times[clip->count] = pts;
+  clip->count++;
+  return true;
+}
+
+// give back bytes reserved for what could not be allocated
+void ClipCache::unreserve(CachedClip *clip, size_t bytes) {
+  clips().lock();
+  used -= bytes;
+  clip->bytes -= bytes;
+  clips().unlock();
+}
+
+void ClipCache::finish(CachedClip *clip) {
+  clips().lock();
+  clip->complete = (clip->count > 0);
+  clips().unlock();
+  act("clip cache holds %u frames of %s, %lu of %lu MB in use",
+      clip->count, clip->name, used / 1048576, budget / 1048576);
+}
+
+void ClipCache::release(CachedClip *clip) {
+  clips().lock();
+  clip->users--;
+  clip->last_use = ++uses;
+  if(!clip->complete) {
+    func("clip cache drops %s after %u frames", clip->name, clip->count);
+    evict(clip);
+  } else if(clip->users == 0)
+    reserve(0, NULL); // the budget may have shrunk while in use
+  clips().unlock();
+}
+
+// called with the list locked
+bool ClipCache::reserve(size_t bytes, CachedClip *keep) {
+  CachedClip *clip, *lru;
+
+  while(used + bytes > budget) {
+    // least recently used among the clips no one is playing
+    lru = NULL;
+    clip = clips().begin();
+    while(clip) {
+      if(clip != keep && clip->users == 0
+	 && (!lru || clip->last_use < lru->last_use))
+	lru = clip;
+      clip = (CachedClip*)clip->next;
+    }
+    if(!lru) return false;
+    func("clip cache evicts %s", lru->name);
+    evict(lru);
+  }
+  return true;
+}
+
+void ClipCache::evict(CachedClip *clip) {
+  used -= clip->bytes;
+  clip->rem();
+  delete clip;
+}
@@ -32,6 +32,9 @@
 #include <video_encoder.h>
 #include <audio_collector.h>
 #include <fps.h>
+#include <frame_stats.h>
+#include <automation.h>
+#include <buffer_pool.h>
 
 #include <signal.h>
 #include <errno.h>
@@ -142,6 +145,7 @@ Context::Context() {
   screens_description = (char*)
 " .  - [ sdl   ] screen - Simple Directmedia Layer\n"
 " .  - [ soft  ] screen - internal shared buffer\n"
+" .  - [ yuv   ] screen - headless yuv 4:2:0 buffer for encoders\n"
 #ifdef WITH_OPENGL
 " .  - [ sdlgl ] screen - SDL 3d opengl\n"
 " .  - [ gl    ] screen - 3d opengl surface\n"
@@ -263,10 +267,29 @@ void Context::cafudda(double secs) {
     handle_controllers();
 	 
   ///////////////////////////////
-  
+
+  render_screens();
+
+  /////////////////////////////
+  // TODO - try to garbage collect only if we have been faster
+  //        than fps
+  // XXX - temporarily disabling explicit garbage-collection
+  //       because it still triggers deadlocks somewhere
+  if (js)
+    js->gc();
+  /// FPS calculation
+  fps.calc();
+  fps.delay();
+}
+
+void Context::render_screens() {
   /////////////////////////////
   // blit layers on screens
   ViewPort *scr;
+
+  // animated parameters take the values of this frame, all at once
+  Automation::run(FPS::now());
+
   scr = screens.begin();
   while(scr) {
 
@@ -278,21 +301,119 @@ void Context::cafudda(double secs) {
     scr->blit_layers();
 
     // show the new painted screen
+    scr->show_stats.start();
     scr->show();
+    scr->show_stats.stop();
 
     scr = (ViewPort*)scr->next;
 
   }
-  /////////////////////////////
-  // TODO - try to garbage collect only if we have been faster
-  //        than fps
-  // XXX - temporarily disabling explicit garbage-collection
-  //       because it still triggers deadlocks somewhere
-  if (js)
-    js->gc();
-  /// FPS calculation
-  fps.calc();
-  fps.delay();
+}
+
+int Context::render_offline(int frames) {
+  ViewPort *scr;
+  Layer *lay;
+  VideoEncoder *enc;
+  uint64_t period, start, elapsed;
+  Layer **was_running;
+  VideoEncoder **was_encoding;
+  int nlayers = 0, nencoders = 0;
+  int c;
+
+  if(frames <= 0) {
+    error("offline render needs a positive number of frames");
+    return 0;
+  }
+  if(!screens.len()) {
+    error("no screen initialized, can't render offline");
+    return 0;
+  }
+
+  period = (uint64_t)(1000000000.0 / (fps.fps > 0 ? fps.fps : fps_speed));
+  notice("offline render of %u frames at %.2f fps", frames, 1000000000.0 / period);
+
+  // from now on layers and encoders only run when stepped here,
+  // those running are started again when the render is over
+  scr = screens.begin();
+  while(scr) {
+    nlayers += scr->layers.len();
+    nencoders += scr->encoders.len();
+    scr = (ViewPort*)scr->next;
+  }
+  was_running = (Layer**)calloc(nlayers + 1, sizeof(Layer*));
+  was_encoding = (VideoEncoder**)calloc(nencoders + 1, sizeof(VideoEncoder*));
+  nlayers = nencoders = 0;
+
+  scr = screens.begin();
+  while(scr) {
+    lay = scr->layers.begin();
+    while(lay) {
+      if(lay->is_running()) was_running[nlayers++] = lay;
+      lay->stop();
+      lay = (Layer*)lay->next;
+    }
+    enc = scr->encoders.begin();
+    while(enc) {
+      if(enc->is_running()) was_encoding[nencoders++] = enc;
+      enc->stop();
+      enc = (VideoEncoder*)enc->next;
+    }
+    scr = (ViewPort*)scr->next;
+  }
+
+  FPS::set_virtual(true);
+  start = FPS::wall();
+
+  for(c = 0; c < frames && !quit; c++) {
+
+    // feed all layers for the time of this frame
+    scr = screens.begin();
+    while(scr) {
+      lay = scr->layers.begin();
+      while(lay) {
+	if(lay->active && lay->opened) lay->step();
+	lay = (Layer*)lay->next;
+      }
+      scr = (ViewPort*)scr->next;
+    }
+
+    render_screens();
+
+    // every rendered frame reaches the encoders
+    scr = screens.begin();
+    while(scr) {
+      enc = scr->encoders.begin();
+      while(enc) {
+	if(enc->active) enc->step();
+	enc = (VideoEncoder*)enc->next;
+      }
+      scr = (ViewPort*)scr->next;
+    }
+
+    if (js)
+      js->gc();
+    fps.calc();
+    FPS::advance(period);
+  }
+
+  elapsed = FPS::wall() - start;
+  FPS::set_virtual(false);
+
+  // back to the live clock, with the threads of before
+  for(int n = 0; n < nlayers; n++)
+    was_running[n]->start();
+  for(int n = 0; n < nencoders; n++)
+    was_encoding[n]->start();
+  free(was_running);
+  free(was_encoding);
+
+  notice("rendered %u frames in %.3f secs: %.2f fps, %.3f ms per frame",
+	 c, elapsed / 1000000000.0,
+	 elapsed ? c * 1000000000.0 / elapsed : 0.0,
+	 c ? elapsed / (c * 1000000.0) : 0.0);
+  FrameStats::report();
+
+  return c;
 }
 
 #define SDL_KEYEVENTMASK (SDL_KEYDOWNMASK|SDL_KEYUPMASK)
@@ -481,6 +602,9 @@ int Context::reset() {
     
   if (js)
     js->reset();
+
+  // the frames of the layers gone are not reused by the next ones
+  BufferPool::trim();
   //does anyone care about reset() return value?
   return 1; 
 }
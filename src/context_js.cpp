@@ -25,6 +25,13 @@
 #include <jsparser.h>
 #include <video_encoder.h>
 #include <controller.h>
+#include <frame_stats.h>
+#include <clip_cache.h>
+#include <buffer_pool.h>
+#include <automation.h>
+#ifdef WITH_FFMPEG
+#include <video_layer.h>
+#endif
 //#include <fps.h>
 
 // global environment class
@@ -72,6 +79,17 @@ JSFunctionSpec global_functions[] = {
     {"use",		execute_javascript_command, 1},
     {"exec",            system_exec,            1},
     {"list_filters",    list_filters,           0},
+    {"frame_stats",     frame_stats,            0},
+    {"frame_deadlines", frame_deadlines,        0},
+    {"render_offline",  render_offline,         1},
+    {"clip_cache",      clip_cache,             0},
+    {"buffer_stats",    buffer_stats,           0},
+    {"automation_stop", automation_stop,        1},
+    {"automation_stats", automation_stats,      0},
+#ifdef WITH_FFMPEG
+    {"decode_budget",   decode_budget,          0},
+    {"keyframe_index",  keyframe_index,         0},
+#endif
     {"gc",		js_gc,			0},
     {"reset",		reset_js,		0},
     {0}
@@ -113,6 +131,60 @@ JS(cafudda) {
   return JS_TRUE;
 }
 
+JS(render_offline) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+  JS_CHECK_ARGC(1);
+
+  jsint frames = js_get_int(argv[0]);
+
+  *rval = INT_TO_JSVAL(global_environment->render_offline(frames));
+  return JS_TRUE;
+}
+
+// memory budget of the decoded clips in megabytes, 0 disables the cache
+JS(clip_cache) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+
+  if(argc > 0) {
+    jsint mb = js_get_int(argv[0]);
+    ClipCache::set_budget((mb < 0) ? 0 : (size_t)mb * 1048576);
+  }
+  *rval = INT_TO_JSVAL(ClipCache::get_budget() / 1048576);
+  return JS_TRUE;
+}
+
+#ifdef WITH_FFMPEG
+// codec threads shared by the movie layers opened next, 0 is automatic,
+// optionally the number of clips playing together that split them
+JS(decode_budget) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+
+  if(argc > 0) {
+    jsint threads = js_get_int(argv[0]);
+    VideoLayer::decode_budget = (threads < 0) ? 0 : threads;
+  }
+  if(argc > 1) {
+    jsint clips = js_get_int(argv[1]);
+    VideoLayer::decode_clips = (clips < 1) ? 1 : clips;
+  }
+  *rval = INT_TO_JSVAL(VideoLayer::decode_budget);
+  return JS_TRUE;
+}
+
+// save the keyframe indexes of movies next to them and load them back
+JS(keyframe_index) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+  JSBool persist;
+
+  if(argc > 0) {
+    JS_ValueToBoolean(cx, argv[0], &persist);
+    KeyframeIndex::persist = persist;
+  }
+  *rval = BOOLEAN_TO_JSVAL(KeyframeIndex::persist);
+  return JS_TRUE;
+}
+#endif
+
 JS(pause) {
   func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
   global_environment->pause = !global_environment->pause;
@@ -219,6 +291,104 @@ JS(list_filters) {
     return JS_TRUE;
 }
 
+// set a number property on a javascript object
+static void js_set_number(JSContext *cx, JSObject *obj, const char *name, double num) {
+  jsval val;
+  JS_NewNumberValue(cx, num, &val);
+  JS_SetProperty(cx, obj, name, &val);
+}
+
+JS(frame_stats) {
+    func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+    JSObject *arr, *objtmp;
+    JSString *str;
+    jsval val;
+    FrameStats *st;
+    FrameStats::summary_t sum;
+    char name[512];
+    int c = 0;
+
+    arr = JS_NewArrayObject(cx, 0, NULL); // create void array
+    if(!arr) return JS_FALSE;
+
+    // one object per timed stage, durations in milliseconds
+    FrameStats::stages().lock();
+    st = FrameStats::stages().begin();
+    while(st) {
+      if(st->summary(&sum)) {
+	objtmp = JS_NewObject(cx, NULL, NULL, NULL);
+	st->get_name(name, sizeof(name));
+	str = JS_NewStringCopyZ(cx, name);
+	val = STRING_TO_JSVAL(str);
+	JS_SetProperty(cx, objtmp, "name", &val);
+	js_set_number(cx, objtmp, "frames", sum.frames);
+	js_set_number(cx, objtmp, "min", sum.min);
+	js_set_number(cx, objtmp, "avg", sum.avg);
+	js_set_number(cx, objtmp, "p99", sum.p99);
+	js_set_number(cx, objtmp, "max", sum.max);
+	val = OBJECT_TO_JSVAL(objtmp);
+	JS_SetElement(cx, arr, c, &val);
+	c++;
+      }
+      st = (FrameStats*)st->next;
+    }
+    FrameStats::stages().unlock();
+
+    *rval = OBJECT_TO_JSVAL( arr );
+    return JS_TRUE;
+}
+
+JS(frame_deadlines) {
+    func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+    JSObject *objtmp;
+
+    objtmp = JS_NewObject(cx, NULL, NULL, NULL);
+    if(!objtmp) return JS_FALSE;
+    js_set_number(cx, objtmp, "late", FPS::total_late);
+    js_set_number(cx, objtmp, "missed", FPS::total_missed);
+
+    *rval = OBJECT_TO_JSVAL( objtmp );
+    return JS_TRUE;
+}
+
+// a steady stream raises only the reused buffers, not the allocated
+JS(buffer_stats) {
+    func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+    JSObject *objtmp;
+
+    objtmp = JS_NewObject(cx, NULL, NULL, NULL);
+    if(!objtmp) return JS_FALSE;
+    js_set_number(cx, objtmp, "allocated", (double)BufferPool::allocations);
+    js_set_number(cx, objtmp, "reused", (double)BufferPool::reuses);
+    js_set_number(cx, objtmp, "kept", (double)BufferPool::kept);
+    js_set_number(cx, objtmp, "used", (double)BufferPool::used);
+
+    *rval = OBJECT_TO_JSVAL( objtmp );
+    return JS_TRUE;
+}
+
+JS(automation_stop) {
+    func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+    JS_CHECK_ARGC(1);
+    *rval = BOOLEAN_TO_JSVAL(Automation::remove(js_get_int(argv[0])));
+    return JS_TRUE;
+}
+
+// evaluated grows with the tracks running, applied only with the values moving
+JS(automation_stats) {
+    func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+    JSObject *objtmp;
+
+    objtmp = JS_NewObject(cx, NULL, NULL, NULL);
+    if(!objtmp) return JS_FALSE;
+    js_set_number(cx, objtmp, "tracks", (double)Automation::tracks());
+    js_set_number(cx, objtmp, "evaluated", (double)Automation::evaluated);
+    js_set_number(cx, objtmp, "applied", (double)Automation::applied);
+
+    *rval = OBJECT_TO_JSVAL( objtmp );
+    return JS_TRUE;
+}
+
 JS(register_controller) {
     func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
     Controller *ctrl;
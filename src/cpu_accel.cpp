@@ -49,6 +49,7 @@
 
 #include <stdio.h>
 #include <signal.h>
+#include <pthread.h>
 #include <setjmp.h>
 
 #include <cpu_accel.h>
@@ -59,10 +60,21 @@
 static __u32 arch_accel (void)
 {
      __u32 eax, ebx, ecx, edx;
+     __u32 max_leaf;
      int AMD;
      __u32 caps = 0;
 
-#ifndef HAVE_64BIT // XXX HACK!
+#ifdef HAVE_64BIT
+     /* every x86_64 cpu has cpuid and ebx is not reserved for PIC */
+#define cpuid(op,eax,ebx,ecx,edx)  \
+     asm ("cpuid"                  \
+          : "=a" (eax),            \
+            "=b" (ebx),            \
+            "=c" (ecx),            \
+            "=d" (edx)             \
+          : "a" (op), "2" (0)      \
+          : "cc")
+#else
 #define cpuid(op,eax,ebx,ecx,edx)  \
      asm ("pushl %%ebx\n\t"        \
           "cpuid\n\t"              \
@@ -72,7 +84,7 @@ static __u32 arch_accel (void)
             "=r" (ebx),            \
             "=c" (ecx),            \
             "=d" (edx)             \
-          : "a" (op)               \
+          : "a" (op), "2" (0)      \
           : "cc")
 
      asm ("pushfl\n\t"
@@ -92,10 +104,12 @@ static __u32 arch_accel (void)
 
      if (eax == ebx)             /* no cpuid */
           return 0;
+#endif /* HAVE_64BIT */
 
      cpuid (0x00000000, eax, ebx, ecx, edx);
      if (!eax)                   /* vendor string only */
           return 0;
+     max_leaf = eax;
 
      AMD = (ebx == 0x68747541) && (ecx == 0x444d4163) && (edx == 0x69746e65);
 
@@ -103,7 +117,6 @@ static __u32 arch_accel (void)
      if (! (edx & 0x00800000))   /* no MMX */
           return 0;
 
-#endif /* HAVE_64BIT */
 #ifdef HAVE_MMX
      caps = MM_ACCEL_X86_MMX;
 #ifdef HAVE_SSE
@@ -113,7 +126,17 @@ static __u32 arch_accel (void)
      if (edx & 0x04000000)       /* SSE2 */
           caps |= MM_ACCEL_X86_SSE2;
 
-#ifndef HAVE_64BIT // XXX HACK!
+     /* AVX2 needs OSXSAVE and AVX, plus the OS saving ymm state */
+     if ((ecx & 0x18000000) == 0x18000000 && max_leaf >= 7) {
+          __u32 xcr0_lo, xcr0_hi;
+          asm ("xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+          if ((xcr0_lo & 0x6) == 0x6) {
+               cpuid (0x00000007, eax, ebx, ecx, edx);
+               if (ebx & 0x00000020)
+                    caps |= MM_ACCEL_X86_AVX2;
+          }
+     }
+
      cpuid (0x80000000, eax, ebx, ecx, edx);
      if (eax < 0x80000001)       /* no extended capabilities */
           return caps;
@@ -125,9 +148,8 @@ static __u32 arch_accel (void)
 
      if (AMD && (edx & 0x00400000))      /* AMD MMX extensions */
           caps |= MM_ACCEL_X86_MMXEXT;
-#endif /* USE_SSE */
-#endif /* USE_MMX */
-#endif /* HAVE_64BIT */
+#endif /* HAVE_SSE */
+#endif /* HAVE_MMX */
 
      return caps;
 }
@@ -188,7 +210,7 @@ __u32 detect_mm_accel() {
      /* test OS support for SSE */
      if (accel & MM_ACCEL_X86_SSE) {
           if (setjmp(sigill_return)) {
-               accel &= ~(MM_ACCEL_X86_SSE|MM_ACCEL_X86_SSE2);
+               accel &= ~(MM_ACCEL_X86_SSE|MM_ACCEL_X86_SSE2|MM_ACCEL_X86_AVX2);
           }
           else {
                signal (SIGILL, sigill_handler);
@@ -209,3 +231,16 @@ __u32 detect_mm_accel() {
 #endif /* !ARCH_X86 && !ARCH_PPC/ENABLE_ALTIVEC */
 }
 
+/* the probe installs a SIGILL handler, which is process wide: it runs
+   once, whatever thread asks first */
+static __u32 probed_accel = 0;
+static pthread_once_t probe_once = PTHREAD_ONCE_INIT;
+
+static void probe_accel() {
+     probed_accel = detect_mm_accel();
+}
+
+__u32 mm_accel() {
+     pthread_once(&probe_once, probe_accel);
+     return probed_accel;
+}
@@ -0,0 +1,434 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+
+#include <encoder_sink.h>
+#include <jutils.h>
+#include <fps.h>
+#include <config.h>
+
+EncoderSink::EncoderSink()
+  : Entry() {
+  int c;
+  policy = SINK_DROP;
+  latency = 0;
+  reconnect = false;
+  id = 0;
+  running = false;
+  quit = false;
+  bytes_written = 0;
+  bytes_dropped = 0;
+  errors = 0;
+  reconnects = 0;
+  rate = 0;
+  rate_bytes = 0;
+  headers = NULL;
+  headers_len = 0;
+
+  queue.init(SINK_QUEUE_SIZE);
+  free_chunks.init(SINK_QUEUE_SIZE);
+  for(c = 0; c < SINK_QUEUE_SIZE; c++) {
+    pool[c].data = NULL;
+    pool[c].len = pool[c].size = 0;
+    free_chunks.push(&pool[c]);
+  }
+}
+
+EncoderSink::~EncoderSink() {
+  int c;
+  // implementations close() in their destructor, _close() is gone here
+  if(running)
+    error("sink %s deleted while running", name);
+  for(c = 0; c < SINK_QUEUE_SIZE; c++)
+    if(pool[c].data) free(pool[c].data);
+  if(headers) free(headers);
+}
+
+EncoderSink *EncoderSink::create(const char *url) {
+  ShoutSink *shout;
+  char host[256], auth[256], *at, *slash, *colon;
+  const char *s;
+  int port = 8000;
+
+  if(strncmp(url, "pipe:", 5) == 0)
+    return new PipeSink(url + 5);
+
+  if(strncmp(url, "file:", 5) == 0)
+    return new FileSink(url + 5);
+
+  if(strncmp(url, "icecast://", 10) != 0)
+    return (strstr(url, "://")) ? NULL : new FileSink(url);
+
+  // icecast://[user:password@]host[:port]/mount
+  s = url + 10;
+  auth[0] = 0;
+  slash = strchr((char*)s, '/');
+  at = strchr((char*)s, '@');
+  if(at && (!slash || at < slash)) {
+    snprintf(auth, sizeof(auth), "%.*s", (int)(at - s), s);
+    s = at + 1;
+  }
+  if(!slash || slash == s) {
+    error("no host or mountpoint in the icecast url %s", url);
+    return NULL;
+  }
+  snprintf(host, sizeof(host), "%.*s", (int)(slash - s), s);
+  colon = strchr(host, ':');
+  if(colon) {
+    *colon = 0;
+    port = atoi(colon + 1);
+  }
+
+  shout = new ShoutSink();
+  shout_set_host(shout->ice, host);
+  shout_set_port(shout->ice, port);
+  shout_set_mount(shout->ice, slash);
+  if(auth[0]) {
+    colon = strchr(auth, ':');
+    if(colon) {
+      *colon = 0;
+      shout_set_password(shout->ice, colon + 1);
+    }
+    shout_set_user(shout->ice, auth);
+  }
+  return shout;
+}
+
+bool EncoderSink::start() {
+  if(running) return true;
+
+  if(!_open()) return false;
+
+  gettimeofday(&rate_time, NULL);
+  queue.reset();
+  free_chunks.reset();
+  quit = false;
+  running = true;
+  if(pthread_create(&thread, NULL, &EncoderSink::_run, this) != 0) {
+    error("can't create the thread of sink %s", name);
+    running = false;
+    _close();
+    return false;
+  }
+  act("encoder sink %s started", name);
+  return true;
+}
+
+void EncoderSink::close() {
+  chunk_t *c;
+  int waited;
+
+  if(!running) return;
+
+  // let the queue drain, for a while
+  for(waited = 0; queue.depth() > 0 && waited < 5000; waited++)
+    jsleep(0, 1000000);
+
+  quit = true;
+  queue.abort();
+  free_chunks.abort();
+  pthread_join(thread, NULL);
+  running = false;
+
+  queue.reset();
+  free_chunks.reset();
+  while((c = (chunk_t*)queue.try_pop())) {
+    drop(c->len);
+    free_chunks.push(c);
+  }
+  _close();
+
+  act("encoder sink %s closed, %llu bytes written, %llu dropped", name,
+      (unsigned long long)bytes_written, (unsigned long long)bytes_dropped);
+}
+
+void EncoderSink::set_headers(const char *buf, int len) {
+  headers = (char*)realloc(headers, len);
+  memcpy(headers, buf, len);
+  headers_len = len;
+}
+
+bool EncoderSink::push(const char *buf, int len) {
+  chunk_t *c;
+
+  if(!running || len <= 0) return false;
+
+  c = (chunk_t*)free_chunks.try_pop();
+  if(!c) {
+    if(policy == SINK_DROP_OLDEST) {
+      c = (chunk_t*)queue.try_pop();
+      if(c) drop(c->len);
+    } else if(policy == SINK_WAIT)
+      c = (chunk_t*)free_chunks.pop();
+  }
+  if(!c) {
+    drop(len);
+    return false;
+  }
+
+  // buffers only grow, to the size of the largest chunk
+  if(c->size < len) {
+    c->data = (char*)realloc(c->data, len);
+    c->size = len;
+  }
+  memcpy(c->data, buf, len);
+  c->len = len;
+  c->time = FPS::wall();
+
+  // as many chunks as room in the queue, never waits
+  queue.push(c);
+  return true;
+}
+
+bool EncoderSink::write_headers() {
+  if(!headers_len) return true;
+  return (_write(headers, headers_len) == headers_len);
+}
+
+bool EncoderSink::retry() {
+  int wait = 1, slept;
+
+  // whatever is queued meanwhile is dropped by latency or the policy
+  while(!quit) {
+    warning("sink %s reconnecting in %u seconds", name, wait);
+    for(slept = 0; slept < wait * 10 && !quit; slept++)
+      jsleep(0, 100000000);
+    if(quit) break;
+
+    if(_reopen() && write_headers()) {
+      reconnects++;
+      act("sink %s reconnected", name);
+      return true;
+    }
+    if(wait < SINK_RECONNECT_MAX) wait *= 2;
+  }
+  return false;
+}
+
+void *EncoderSink::_run(void *arg) {
+  ((EncoderSink*)arg)->run();
+  return NULL;
+}
+
+void EncoderSink::run() {
+  struct timeval now;
+  double elapsed;
+  chunk_t *c;
+  int res;
+
+  if(!write_headers() && reconnect)
+    retry();
+
+  while((c = (chunk_t*)queue.pop())) {
+
+    // late data is of no use to a live stream
+    if(latency && (FPS::wall() - c->time) / 1000000 > latency) {
+      drop(c->len);
+      free_chunks.push(c);
+      continue;
+    }
+
+    res = _write(c->data, c->len);
+    if(res < 0) {
+      // one message per burst of errors is enough
+      if(!(errors++ % 100))
+	error("sink %s failed writing %u bytes", name, c->len);
+      drop(c->len);
+      if(reconnect) retry();
+    } else {
+      bytes_written += res;
+      rate_bytes += res;
+    }
+    free_chunks.push(c);
+
+    // stream rate measured at least every 3 seconds
+    gettimeofday(&now, NULL);
+    elapsed = (now.tv_sec - rate_time.tv_sec)
+      + (now.tv_usec - rate_time.tv_usec) / 1000000.0;
+    if(elapsed >= 3.0) {
+      rate = (rate_bytes / elapsed) / 1000.0;
+      rate_bytes = 0;
+      rate_time = now;
+    }
+  }
+}
+
+double EncoderSink::get_rate() {
+  return rate;
+}
+
+//// file
+
+FileSink::FileSink(const char *p)
+  : EncoderSink() {
+  strncpy(path, p, sizeof(path) - 1);
+  path[sizeof(path) - 1] = 0;
+  fd = NULL;
+  set_name(path);
+}
+
+FileSink::~FileSink() {
+  close();
+}
+
+bool FileSink::_open() {
+  fd = fopen(path, "w");
+  if(!fd) {
+    error("can't record to file %s: %s", path, strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+int FileSink::_write(const char *buf, int len) {
+  size_t res = fwrite(buf, 1, len, fd);
+  return (res < (size_t)len && ferror(fd)) ? -1 : (int)res;
+}
+
+void FileSink::_close() {
+  if(fd) fclose(fd);
+  fd = NULL;
+}
+
+//// pipe
+
+PipeSink::PipeSink(const char *cmd)
+  : EncoderSink() {
+  strncpy(command, cmd, sizeof(command) - 1);
+  command[sizeof(command) - 1] = 0;
+  fd = NULL;
+  set_name(command);
+}
+
+PipeSink::~PipeSink() {
+  close();
+}
+
+bool PipeSink::_open() {
+  // a command quitting must not kill us writing to it
+  signal(SIGPIPE, SIG_IGN);
+  fd = popen(command, "w");
+  if(!fd) {
+    error("can't pipe to %s: %s", command, strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+int PipeSink::_write(const char *buf, int len) {
+  size_t res = fwrite(buf, 1, len, fd);
+  if(res < (size_t)len) return -1;
+  fflush(fd);
+  return (int)res;
+}
+
+void PipeSink::_close() {
+  if(fd) pclose(fd);
+  fd = NULL;
+}
+
+//// icecast
+
+ShoutSink::ShoutSink()
+  : EncoderSink() {
+  owned = true;
+  set_name("icecast");
+  // a live stream rather skips than lags behind
+  policy = SINK_DROP_OLDEST;
+  latency = 2000;
+  reconnect = true;
+
+  if ((ice = shout_new()) != NULL) {
+
+    if( shout_set_protocol(ice,SHOUT_PROTOCOL_HTTP) )
+      error("shout_set_protocol: %s", shout_get_error(ice));
+
+    if( shout_set_format(ice,SHOUT_FORMAT_OGG) )
+      error("shout_set_format: %s", shout_get_error(ice));
+
+    if( shout_set_agent(ice,"FreeJ - freej.dyne.org") )
+      error("shout_set_agent: %s", shout_get_error(ice));
+
+    if( shout_set_public(ice,1) )
+      error("shout_set_public: %s", shout_get_error(ice));
+  }
+}
+
+ShoutSink::ShoutSink(shout_t *shared)
+  : EncoderSink() {
+  owned = false;
+  ice = shared;
+  set_name("stream");
+  policy = SINK_DROP_OLDEST;
+  latency = 2000;
+  reconnect = true;
+}
+
+ShoutSink::~ShoutSink() {
+  // the thread must be done with the connection before it is freed
+  close();
+  if(owned && ice) shout_free(ice);
+}
+
+bool ShoutSink::_open() {
+  if(!ice) return false;
+
+  if(owned) {
+    if(shout_open(ice) != SHOUTERR_SUCCESS) {
+      error("error connecting to server %s: %s",
+	    shout_get_host(ice), shout_get_error(ice));
+      return false;
+    }
+    snprintf(name, sizeof(name), "icecast://%s:%u%s",
+	     shout_get_host(ice), shout_get_port(ice), shout_get_mount(ice));
+    notice("streaming on url: http://%s:%i%s",
+	   shout_get_host(ice), shout_get_port(ice), shout_get_mount(ice));
+  }
+  return true;
+}
+
+int ShoutSink::_write(const char *buf, int len) {
+  // paces the sending at the rate of the stream
+  shout_sync(ice);
+  if( shout_send(ice, (const unsigned char*)buf, len) != SHOUTERR_SUCCESS ) {
+    error("shout_send: %s", shout_get_error(ice));
+    return -1;
+  }
+  return len;
+}
+
+void ShoutSink::_close() {
+  if(owned && ice)
+    if(shout_close(ice))
+      error("shout_close: %s", shout_get_error(ice));
+}
+
+bool ShoutSink::_reopen() {
+  shout_close(ice);
+  if(shout_open(ice) != SHOUTERR_SUCCESS) {
+    error("error connecting to server %s: %s",
+	  shout_get_host(ice), shout_get_error(ice));
+    return false;
+  }
+  return true;
+}
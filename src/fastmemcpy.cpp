@@ -668,6 +668,21 @@ static inline unsigned long long int rdtsc()
 
 //void *(* jmemcpy)(void *to, const void *from, size_t len) = memcpy;
 
+const char *get_memcpy_method(int n, void *(**fun)( void *to, const void *from, size_t len )) {
+     __u32 config_flags = mm_accel();
+     int i;
+
+     for (i=1; memcpy_method[i].name; i++) {
+          if (memcpy_method[i].cpu_require & ~config_flags)
+               continue;
+          if (n-- == 0) {
+               if (fun) *fun = memcpy_method[i].function;
+               return memcpy_method[i].name;
+          }
+     }
+     return NULL;
+}
+
 #define BUFSIZE 1024
 
 void find_best_memcpy()
@@ -677,7 +692,7 @@ void find_best_memcpy()
      unsigned long long t;
      char *buf1, *buf2;
      int i, j, best = 0;
-     __u32 config_flags = detect_mm_accel();
+     __u32 config_flags = mm_accel();
 
      if (!(buf1 = (char*) malloc( BUFSIZE * 2000 * sizeof(char) )))
           return;
@@ -67,15 +67,7 @@ FilterInstance *Filter::new_instance() {
 bool Filter::apply(Layer *lay, FilterInstance *instance)
 {
     
-    errno=0;
-    instance->outframe = (uint32_t*) calloc(lay->geo.bytesize, 1);
-    if(errno != 0) {
-        error("calloc outframe failed (%i) applying filter %s",errno, name);
-        error("Filter %s cannot be instantiated", name);
-        delete instance;
-        return NULL;
-    }
-    
+    // no outframe here: the layer runs its chain in shared buffers
     bytesize = lay->geo.bytesize;
     
     lay->filters.append(instance);
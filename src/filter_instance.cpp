@@ -27,6 +27,8 @@ $Id:$
 #include <filter.h>
 
 #include <jutils.h>
+#include <buffer_pool.h>
+#include <automation.h>
 
 FACTORY_REGISTER_INSTANTIATOR(FilterInstance, FilterInstance, FilterInstance, core);
 
@@ -37,8 +39,10 @@ FilterInstance::FilterInstance()
   core = NULL;
   intcore = 0;
   outframe = NULL;
+  slices = NULL;
   active = false;
   layer = NULL;
+  process_stats.init(this, "process");
 }
 
 FilterInstance::FilterInstance(Filter *fr)
@@ -47,19 +51,22 @@ FilterInstance::FilterInstance(Filter *fr)
   core = NULL;
   intcore = 0;
   outframe = NULL;
+  slices = NULL;
   active = false;
   layer = NULL;
+  process_stats.init(this, "process");
   init(fr);
 }
 
 FilterInstance::~FilterInstance() {
   func("~FilterInstance");
 
+  Automation::drop(this);
+
   if(proto)
     proto->destruct(this);
 
-  if(outframe)
-    free(outframe);
+  BufferPool::put(outframe);
 
 }
 
@@ -77,10 +84,30 @@ uint32_t *FilterInstance::process(float fps, uint32_t *inframe) {
     error("void filter instance was called for process: %p", this);
     return inframe;
   }
+  // only callers not passing a buffer need an outframe of their own
+  if(!outframe && layer)
+    outframe = (uint32_t*) BufferPool::get_zero(layer->geo.bytesize);
+  if(!outframe) {
+    error("no outframe to process filter instance %p", this);
+    return inframe;
+  }
+  process_stats.start();
   proto->update(this, fps, inframe, outframe);
+  process_stats.stop();
   return outframe;
 }
 
+uint32_t *FilterInstance::process(float fps, uint32_t *inframe, uint32_t *out) {
+  if(!proto) {
+    error("void filter instance was called for process: %p", this);
+    return inframe;
+  }
+  process_stats.start();
+  proto->update(this, fps, inframe, out);
+  process_stats.stop();
+  return out;
+}
+
 bool FilterInstance::set_parameter(int idx) {
   Parameter *param;
   param = (Parameter*)parameters[idx];
@@ -136,6 +163,7 @@ bool FilterInstance::apply(Layer *lay)
 void FilterInstance::set_layer(Layer *lay)
 {
     layer = lay;
+    process_stats.set_parent((Entry*)lay);
 }
 
 Layer *FilterInstance::get_layer()
@@ -26,6 +26,7 @@ $Id: $
 #include <callbacks_js.h>
 #include <jsparser_data.h>
 #include <filter.h>
+#include <automation.h>
 
 
 DECLARE_CLASS("Filter",filter_class,filter_constructor);
@@ -33,6 +34,7 @@ DECLARE_CLASS("Filter",filter_class,filter_constructor);
 JSFunctionSpec filter_methods[] = {
   {"set_parameter",           filter_set_parameter,             4},
   {"activate",                filter_activate,                  1},
+  {"automate",                filter_automate,                  2},
   ENTRY_METHODS   ,
   {0}
 };
@@ -192,6 +194,46 @@ JS(filter_set_parameter) {
 
 }
 
+// same arguments as layer.automate()
+JS(filter_automate) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+  double times[256], values[256];
+  Parameter *param;
+  char *name;
+  int idx, n;
+  int curve = AUTOMATION_LINEAR, mode = ONCE, component = 0;
+
+  JS_CHECK_ARGC(2);
+  *rval = INT_TO_JSVAL(-1);
+
+  FilterInstance *filter_instance = (FilterInstance*)JS_GetPrivate(cx, obj);
+  if(!filter_instance) {
+    error("%u:%s:%s :: Filter core data is NULL",
+	  __LINE__,__FILE__,__FUNCTION__);
+    return JS_FALSE;
+  }
+
+  name = js_get_string(argv[0]);
+  if(!name) return JS_TRUE;
+  param = (Parameter*)filter_instance->parameters.search(name, &idx);
+  if(!param) {
+    error("parameter %s not found in filter %s", name, filter_instance->proto->name);
+    return JS_TRUE;
+  }
+
+  n = js_get_keyframes(cx, argv[1], times, values, 256);
+  if(!n) return JS_TRUE;
+  if(argc > 2) curve = js_get_int(argv[2]);
+  if(argc > 3) mode = js_get_int(argv[3]);
+  if(argc > 4) component = js_get_int(argv[4]);
+  if(curve < AUTOMATION_STEP || curve > AUTOMATION_SMOOTH) curve = AUTOMATION_LINEAR;
+  if(mode < ONCE || mode > PULSE) mode = ONCE;
+
+  *rval = INT_TO_JSVAL(Automation::add(filter_instance, param, idx, component, times, values, n,
+				       (automation_curve_t)curve, (iterator_mode_t)mode));
+  return JS_TRUE;
+}
+
 JSP(filter_list_parameters) {
   func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
   JSObject *arr, *otmp;
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <pthread.h>
 
 #include <config.h>
 
@@ -32,27 +33,110 @@
 #include <fps.h>
 #include <jutils.h>
 
+#if defined(CLOCK_MONOTONIC) && !defined(HAVE_DARWIN)
+#define USE_MONOTONIC 1
+#endif
+
+uint32_t FPS::total_late = 0;
+uint32_t FPS::total_missed = 0;
+
+static uint64_t clock_epoch = 0;
+static pthread_once_t clock_once = PTHREAD_ONCE_INIT;
+
+// virtual time of offline rendering
+static volatile bool clock_virtual = false;
+static volatile uint64_t clock_virtual_ns = 0;
+
+static uint64_t clock_ns() {
+#ifdef USE_MONOTONIC
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t)tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
+#endif
+}
+
+static void clock_init() {
+  clock_epoch = clock_ns();
+}
+
+uint64_t FPS::wall() {
+  pthread_once(&clock_once, clock_init);
+  return clock_ns() - clock_epoch;
+}
+
+uint64_t FPS::now() {
+  if(clock_virtual) return clock_virtual_ns;
+  return wall();
+}
+
+void FPS::set_virtual(bool on) {
+  if(on == clock_virtual) return;
+  // the clock goes on from where the other one was
+  if(on) clock_virtual_ns = wall();
+  clock_virtual = on;
+  func("shared clock is now %s", on ? "virtual" : "real");
+}
+
+bool FPS::is_virtual() {
+  return clock_virtual;
+}
+
+void FPS::advance(uint64_t ns) {
+  clock_virtual_ns = clock_virtual_ns + ns;
+}
+
+// sleep until an absolute time of the shared clock
+static void sleep_until(uint64_t t) {
+  struct timespec ts;
+  int res;
+#ifdef USE_MONOTONIC
+  t += clock_epoch;
+  ts.tv_sec  = t / 1000000000ULL;
+  ts.tv_nsec = t % 1000000000ULL;
+  do {
+    res = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+  } while(res == EINTR);
+  if(res)
+    error("clock_nanosleep returned an error, not performing delay: %s",
+	  strerror(res));
+#else
+  uint64_t n = FPS::now();
+  struct timespec rem;
+  if(t <= n) return;
+  t -= n;
+  ts.tv_sec  = t / 1000000000ULL;
+  ts.tv_nsec = t % 1000000000ULL;
+  while( (res = nanosleep(&ts, &rem)) == -1 && errno == EINTR )
+    ts = rem;
+  if(res)
+    error("nanosleep returned an error, not performing delay: %s",
+	  strerror(errno));
+#endif
+}
+
 
 FPS::FPS() {
-  _fps = 0;
-  _period = 0;
+  fps = fps_old = 0;
   fpsd.sum = 0;
   fpsd.i = 0;
   fpsd.n = 30;
-  _passes = 0.0;
-  _ratio = 1.0;
-  m_OrgSets = false;
   fpsd.data = new float[fpsd.n];
-  gettimeofday(&start_tv,NULL);
-  m_OldTime.tv_sec = start_tv.tv_sec;
-  m_OldTime.tv_usec = start_tv.tv_usec;
-  
-  wake_ts.tv_sec = wake_ts.tv_nsec = 0;
+  for (int i=0; i<fpsd.n; i++)
+    fpsd.data[i] = 0;
 
+  late = missed = 0;
+  period = 0;
+  last = 0;
+  tick = now();
+  done = false;
 }
 
 FPS::~FPS() {
-  free(fpsd.data);
+  delete[] fpsd.data;
 
 }
 void FPS::init(double rate) {
@@ -60,125 +144,83 @@ void FPS::init(double rate) {
 
   this->set(rate);
 
-  for (int i=0; i<30; i++) {
+  for (int i=0; i<fpsd.n; i++) {
     fpsd.data[i] = 0;
   }
+  fpsd.sum = 0;
 
 }
 
 void FPS::calc() {
-
-  timeval done, now_tv;
-  float curr_fps;  
-
-  gettimeofday(&now_tv, NULL);
-
-  if(now_tv.tv_usec == start_tv.tv_usec && now_tv.tv_sec == start_tv.tv_sec) {
-    // tight loop, take a minimum breath
-    wake_ts.tv_sec  = 0;
-    wake_ts.tv_nsec = 1000000; // set the delay
-    return;
+  uint64_t t = now();
+  float curr_fps;
+
+  // statistics on the period of the loop
+  if(last && t > last) {
+    curr_fps = 1000000000.0 / (t - last);
+    fpsd.sum = fpsd.sum - fpsd.data[fpsd.i] + curr_fps;
+    fpsd.data[fpsd.i] = curr_fps;
+    if (++fpsd.i >= fpsd.n) fpsd.i = 0;
   }
+  last = t;
 
-  timersub(&now_tv, &start_tv, &done);
-  _period = (1000000 / _fps) / _ratio;
-
-  if ( (done.tv_sec > 0)
-       || (done.tv_usec >= _period) ) {
-	 start_tv.tv_sec = now_tv.tv_sec;
-	 start_tv.tv_usec = now_tv.tv_usec;
-	 // FIXME: statistics here, too ?!
-	 return;
+  if(period && t > tick && !clock_virtual) {
+    late++;
+    __sync_fetch_and_add(&total_late, 1);
   }
-
-  wake_ts.tv_sec  = 0;
-  wake_ts.tv_nsec = (_period - done.tv_usec)*1000; // set the delay
-  if (wake_ts.tv_nsec >= 1000000000){
-    wake_ts.tv_sec = wake_ts.tv_nsec / 1000000000;
-    wake_ts.tv_nsec = wake_ts.tv_nsec - (wake_ts.tv_sec * 1000000000);
-  }
-
-  // statistic only
-/*  if (done.tv_usec)
-      curr_fps = 1000000 /  done.tv_usec;
-  else
-      curr_fps = 0;
-
-  fpsd.sum = fpsd.sum - fpsd.data[fpsd.i] + curr_fps;
-  fpsd.data[fpsd.i] = curr_fps;
-  if (++fpsd.i >= fpsd.n) fpsd.i = 0;*/
-  
+  done = true;
 }
 
 float FPS::get() {
-  return (_fps ? fpsd.sum / fpsd.n : 0 );
+  return (fps ? fpsd.sum / fpsd.n : 0 );
 }
 
 double FPS::set(double rate) {
+  uint64_t t;
   func("FPS set to %f",rate);
-  if (rate < 0) // invalid
+  if (rate <= 0) // invalid
     return fps_old;
   
-  if (rate != _fps)
-    fps_old = _fps;
-  _passes = 0.0;
+  if (rate != fps)
+    fps_old = fps;
   fps = rate; // public
-  _period = 1000000 / rate;	//_period in us
-  _fps = rate;
-  _ratio = 1.0;
-  m_OrgSets = false;	//tells to the next delay call to catch the new starting time
+  period = (uint64_t)(1000000000.0 / rate);
+
+  // align on the next tick of the shared clock
+  t = now();
+  tick = (t / period + 1) * period;
 
   return fps_old;
 }
 
-#if 1 // use nanosleep (otherwise select_sleep)
 void FPS::delay() {
-  struct timespec remaining = { 0, 0 };
-  timeval did;
-    if (wake_ts.tv_nsec > 100000) {	//if > to 100 us
-      wake_ts.tv_nsec = wake_ts.tv_nsec - 100000;	// - 100 us
-    }
-    do {
-      if (nanosleep(&wake_ts, &remaining) == -1) {
-	if (errno == EINTR) {
-        // we've been interrupted use remaining and then reset it
-	  wake_ts.tv_nsec = remaining.tv_nsec;
-	  remaining.tv_sec = remaining.tv_nsec = 0;
-	} else {
-	  error("nanosleep 2 returned an error, not performing delay!, remains :%lds %ldus: %s" \
-	      , remaining.tv_sec, remaining.tv_nsec, strerror (errno));
-	  wake_ts.tv_sec  = wake_ts.tv_nsec = 0;
-	}
-      } else {
-	// nanosleep successful, reset wake_ts
-	wake_ts.tv_sec  = wake_ts.tv_nsec = 0;
-      }
-    } while (wake_ts.tv_nsec > 0);
-    gettimeofday(&start_tv,NULL);
-    if (!m_OrgSets) {
-      m_OrgSets = true;
-      m_OrgTime.tv_sec = start_tv.tv_sec;
-      m_OrgTime.tv_usec = start_tv.tv_usec;
-    }
-    else {
-      _passes++;
-      _ratio = ((((start_tv.tv_sec - m_OrgTime.tv_sec) * 1000000) + (start_tv.tv_usec - m_OrgTime.tv_usec)) \
-      / _passes) / _period;
-      if (_ratio > 1.02)
-	_ratio = 1.02;
-      else if (_ratio < 0.98)
-	_ratio = 0.98;
+  uint64_t t, skipped;
+
+  if(!period) return;
+  if(!done) calc();
+  done = false;
+
+  // offline: the next frame is rendered right away
+  if(clock_virtual) {
+    tick = now() + period;
+    return;
+  }
+
+  t = now();
+  if(t >= tick) {
+    // late: whole ticks passed are lost, then the next frame starts
+    // right away for the last tick which passed
+    skipped = (t - tick) / period;
+    if(skipped) {
+      missed += skipped;
+      __sync_fetch_and_add(&total_missed, (uint32_t)skipped);
+      tick += skipped * period;
     }
-    timersub(&start_tv, &m_OldTime, &did);
-  m_OldTime.tv_sec = start_tv.tv_sec;
-  m_OldTime.tv_usec = start_tv.tv_usec;
-}
-#else 
+  } else
+    sleep_until(tick);
 
-void FPS::delay() {
-  select_sleep(wake_ts.tv_sec * 1000000 + wake_ts.tv_nsec/1000);
+  tick += period;
 }
-#endif
 
 void FPS::select_sleep (long usec) {
        fd_set fd;
@@ -0,0 +1,117 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <frame_stats.h>
+#include <jutils.h>
+#include <config.h>
+
+static int cmp_float(const void *a, const void *b) {
+  float fa = *(const float*)a;
+  float fb = *(const float*)b;
+  return (fa > fb) - (fa < fb);
+}
+
+Linklist<FrameStats> &FrameStats::stages() {
+  // built on first use, stages are created by objects anywhere
+  static Linklist<FrameStats> all;
+  return all;
+}
+
+FrameStats::FrameStats()
+  : Entry() {
+  owner = NULL;
+  parent = NULL;
+  stage = "";
+  begin = 0;
+  count = 0;
+}
+
+FrameStats::~FrameStats() {
+  // Entry::~Entry removes it from the list
+}
+
+void FrameStats::init(Entry *o, const char *s) {
+  owner = o;
+  stage = s;
+  set_name(s);
+  if(!list) stages().append(this);
+}
+
+void FrameStats::record(uint64_t ns) {
+  ring[count % FRAME_STATS_SIZE] = ns / 1000000.0;
+  // the duration must be in the ring before it is counted
+  __sync_synchronize();
+  count = count + 1;
+}
+
+bool FrameStats::summary(summary_t *s) {
+  float v[FRAME_STATS_SIZE];
+  uint32_t n, c;
+  float sum = 0.0;
+  int p;
+
+  n = count;
+  if(!n) return false;
+  if(n > FRAME_STATS_SIZE) n = FRAME_STATS_SIZE;
+
+  // copy the latest n durations, the oldest may be overwritten while
+  // copying, which only makes the summary include a newer one
+  for(c = 0; c < n; c++) {
+    v[c] = ring[c];
+    sum += v[c];
+  }
+  qsort(v, n, sizeof(float), cmp_float);
+
+  p = (int)ceil(n * 0.99) - 1;
+  s->frames = n;
+  s->min = v[0];
+  s->avg = sum / n;
+  s->p99 = v[p < 0 ? 0 : p];
+  s->max = v[n - 1];
+  return true;
+}
+
+void FrameStats::report() {
+  FrameStats *st;
+  summary_t sum;
+  char name[512];
+
+  stages().lock();
+  st = stages().begin();
+  while(st) {
+    if(st->summary(&sum)) {
+      st->get_name(name, sizeof(name));
+      act("%-32s %4u frames  min %7.3f  avg %7.3f  p99 %7.3f  max %7.3f ms",
+	  name, sum.frames, sum.min, sum.avg, sum.p99, sum.max);
+    }
+    st = (FrameStats*)st->next;
+  }
+  stages().unlock();
+}
+
+void FrameStats::get_name(char *dst, int len) {
+  if(parent)
+    snprintf(dst, len, "%s/%s/%s", parent->name, owner ? owner->name : "", stage);
+  else
+    snprintf(dst, len, "%s/%s", owner ? owner->name : "", stage);
+}
@@ -30,6 +30,7 @@
 #include <dlfcn.h>
 #include <stdlib.h>
 #include <stdio.h> // for snprintf()
+#include <string.h>
 
 #include <cstdlib>
 #include <string>
@@ -53,16 +54,10 @@ Freeframe::Freeframe()
 
   handle = NULL;
   opened = false;
+  info = NULL;
+  plugmain = NULL;
 
-
-  set_name((char*)info->pluginName);
-
-  // init freeframe filter
-  if(plugmain(FF_INITIALISE, NULL, 0).ivalue == FF_FAIL)
-    error("cannot initialise freeframe plugin %s",name);
-
-  if(get_debug()>2)
-    print_info();
+  set_name((char *)"Unknown");
 
 }
 
@@ -78,13 +73,8 @@ void Freeframe::init_parameters(Linklist<Parameter> &parameters) {
 
 }
 
-int Freeframe::open(char *file) {
-  plugMainType *plgMain;
-
-  if(opened) {
-    error("Freeframe object %p has already opened file %s",this, filename);
-    return 0;
-  }
+bool Freeframe::open_library(const char *file) {
+  plugMainType *plgMain = NULL;
 
   // clear up the errors if there were any
   dlerror();
@@ -104,13 +94,13 @@ int Freeframe::open(char *file) {
 #if 0
       if (!dlopen_preflight(file)) {
         warning("plugin '%s' failed: %s", file, dlerror());
-        return 0;
+        return false;
       }
 #endif
       handle = dlopen(file, RTLD_NOW);
       if(!handle) {
         warning("can't dlopen plugin: %s", file);
-        return 0;
+        return false;
       }
 
       // try the freeframe symbol
@@ -120,45 +110,122 @@ int Freeframe::open(char *file) {
         // don't forget to close
         dlclose(handle);
         handle = NULL;
-        return 0;
+        return false;
       }
 
   }
+  if(!plgMain) return false;
+
+  plugmain = plgMain;
+  return true;
+}
+
+void Freeframe::initialise() {
+  char tmp[17];
+
+  // the name is not null terminated
+  snprintf(tmp, 17, "%.16s", (char*)info->pluginName);
+  set_name(tmp);
+
+  // init freeframe filter
+  if(plugmain(FF_INITIALISE, NULL, 0).ivalue == FF_FAIL)
+    error("cannot initialise freeframe plugin %s",name);
+
+  if(get_debug()>2)
+    print_info();
+}
+
+int Freeframe::open(char *file) {
+
+  if(opened) {
+    error("Freeframe object %p has already opened file %s",this, filename);
+    return 0;
+  }
+
+  if(!open_library(file))
+    return 0;
   
   /// WARNING:  if  compiled  without  -freg-struct-return  this  will
   /// return an invalid address ...
-  PlugInfoStruct *pis = (plgMain(FF_GETINFO,NULL, 0)).PISvalue;
+  PlugInfoStruct *pis = (plugmain(FF_GETINFO,NULL, 0)).PISvalue;
 
   //  func("freeframe plugin: %s",pis->pluginName);
   // ... and here will segfault
-  if ((plgMain(FF_GETPLUGINCAPS,
+  if ((plugmain(FF_GETPLUGINCAPS,
 		(LPVOID) FF_CAP_32BITVIDEO, 0)).ivalue != FF_TRUE) {
     func("plugin %s: no 32 bit support", file);
-    dlclose(handle);
+    if(handle) dlclose(handle);
     handle = NULL;
+    plugmain = NULL;
     return 0;
   }
  
   if (pis->APIMajorVersion < 1) {
     error("plugin %s: old api version", file);
-    dlclose(handle);
+    if(handle) dlclose(handle);
     handle = NULL;
+    plugmain = NULL;
     return 0;
   }
 
-  // init is called by Filter class
-  //   (plgMain(FF_INITIALISE, NULL, 0)).ivalue {
-
   info = pis;
   //  extinfo = plgMain(FF_GETEXTENDEDINFO, NULL, 0)
-  plugmain = plgMain;
   opened = true;
   snprintf(filename,255,"%s",file);
 
+  initialise();
+
   return 1;
 
 }
 
+void Freeframe::defer(const char *file, plugin_entry_t *e) {
+  uint32_t id = (uint32_t)e->version[2];
+
+  cached_info.APIMajorVersion = e->version[0];
+  cached_info.APIMinorVersion = e->version[1];
+  cached_info.uniqueID[0] = id & 0xff;
+  cached_info.uniqueID[1] = (id >> 8) & 0xff;
+  cached_info.uniqueID[2] = (id >> 16) & 0xff;
+  cached_info.uniqueID[3] = (id >> 24) & 0xff;
+  memset(cached_info.pluginName, 0, 16);
+  strncpy((char*)cached_info.pluginName, e->name.c_str(), 16);
+  cached_info.pluginType = e->type;
+  info = &cached_info;
+
+  opened = true;
+  snprintf(filename,255,"%s",file);
+
+  set_name((char*)e->name.c_str());
+}
+
+bool Freeframe::load() {
+  if(plugmain) return true;
+  if(!opened) return false;
+
+  func("opening freeframe plugin %s on first use", filename);
+  if(!open_library(filename)) {
+    error("freeframe plugin %s can't be opened anymore", filename);
+    return false;
+  }
+  initialise();
+  return true;
+}
+
+void Freeframe::describe(plugin_entry_t *e) {
+  char tmp[17];
+
+  snprintf(tmp, 17, "%.16s", (char*)info->pluginName);
+  e->kind = PLUGIN_FREEFRAME;
+  e->type = info->pluginType;
+  e->name = tmp;
+  e->version[0] = info->APIMajorVersion;
+  e->version[1] = info->APIMinorVersion;
+  e->version[2] = info->uniqueID[0] | (info->uniqueID[1] << 8)
+    | (info->uniqueID[2] << 16) | (info->uniqueID[3] << 24);
+  e->params.clear();
+}
+
 void Freeframe::print_info() {
   notice("Name             : %s", info->pluginName);
   switch(info->pluginType) {    
@@ -166,12 +233,15 @@ void Freeframe::print_info() {
   case FF_SOURCE: act("Type             : Source"); break;
   default: error("Unrecognized plugin type");
   }
-  act("Parameters [%i total]", plugmain(FF_GETNUMPARAMETERS, NULL, 0).ivalue);
+  if(plugmain)
+    act("Parameters [%i total]", plugmain(FF_GETNUMPARAMETERS, NULL, 0).ivalue);
 }
 
 bool Freeframe::apply(Layer *lay, FilterInstance *instance) 
 {
     VideoInfoStruct vidinfo;
+    if(!load())
+        return false;
     vidinfo.frameWidth = lay->geo.w;
     vidinfo.frameHeight = lay->geo.h;
     vidinfo.orientation = 1;
@@ -190,7 +260,9 @@ void Freeframe::destruct(FilterInstance *inst) {
 
 void Freeframe::update(FilterInstance *inst, double time, uint32_t *inframe, uint32_t *outframe) {
     Filter::update(inst, time, inframe, outframe);
-    jmemcpy(outframe,inframe,bytesize);
+    // the layer runs freeframe in place, generators have no input
+    if(inframe && outframe != inframe)
+        jmemcpy(outframe,inframe,bytesize);
     plugmain(FF_PROCESSFRAME, (void*)outframe, inst->intcore);
 }
 
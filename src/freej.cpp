@@ -67,6 +67,11 @@ static const char *help =
 " .   -c   no interactive text console\n"
 " .   -f   <frame_per_second>  select global fps for freej\n"
 " .   -F   start in fullscreen\n"
+" .   -O   <frames>  render frames offline as fast as possible, then quit\n"
+#ifdef WITH_FFMPEG
+" .   -T   <threads>[:<clips>]  codec threads shared by movie layers,\n"
+" .        split evenly among clips playing together - default auto:4\n"
+#endif
 #ifdef WITH_OPENGL
 " .   -g   experimental opengl engine! (better pow(2) res as 256x256)\n"
 #endif
@@ -75,7 +80,7 @@ static const char *help =
 " .\n";
 
 // we use only getopt, no _long
-static const char *short_options = "-hvD:gas:S:nj:p:cgf:F";
+static const char *short_options = "-hvD:gas:S:nj:p:cgf:FO:T:";
 
 /* this is the global FreeJ context */
 Context *freej = NULL;
@@ -102,6 +107,7 @@ int audiomode = 0;
 bool noconsole = false;
 bool fullscreen = false;
 bool opengl = false;
+int offline = 0; // frames to render offline
 
 void cmdline(int argc, char **argv) {
   int res, optlen;
@@ -189,6 +195,16 @@ void cmdline(int argc, char **argv) {
 //      freej.screen->fullscreen();
       break;
 
+    case 'O':
+      sscanf (optarg, "%u", &offline);
+      break;
+
+#ifdef WITH_FFMPEG
+    case 'T':
+      sscanf (optarg, "%u:%u", &VideoLayer::decode_budget, &VideoLayer::decode_clips);
+      break;
+#endif
+
    case 'j':
       fd = fopen(optarg,"r");
       if(!fd) {
@@ -245,6 +261,14 @@ void cmdline(int argc, char **argv) {
     }
   } while (res != -1);
 
+  // offline rendering needs no window and no console
+  if(offline) {
+    if(strcmp(screen_name, "yuv") != 0)
+      snprintf(screen_name, 16, "soft");
+    noconsole = true;
+    fullscreen = false;
+  }
+
 #ifdef HAVE_DARWIN
   for(;optind<argc;optind++) {
 
@@ -423,6 +447,12 @@ int main (int argc, char **argv) {
     }
   }
 
+  /* render offline and quit */
+  if(offline) {
+    freej->render_offline(offline);
+    freej->quit = true;
+  }
+
   /* MAIN loop */
   while( !freej->quit )
   {
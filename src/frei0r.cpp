@@ -29,15 +29,106 @@
 #include <stdlib.h>
 #include <stdio.h> // for snprintf()
 
+#include <string.h>
+
 #include <cstdlib>
 #include <string>
 
 #include <frei0r_freej.h>
 #include <layer.h>
+#include <buffer_pool.h>
 #include <jutils.h>
 
 FACTORY_REGISTER_INSTANTIATOR(Filter, Freior, Frei0rFilter, core);
 
+bool Freior::slices = true;
+WorkerPool *Freior::slice_pool = NULL;
+Linklist<Filter> Freior::mixers;
+
+// frei0r doesn't tell which filters can work on a part of the frame:
+// these only look at the pixel they write, or at the rows around it.
+// Filters drawing overlays or using statistics of the frame are not.
+static const struct { const char *name; int halo; } sliceable[] = {
+  { "Brightness", 0 },
+  { "Contrast0r", 0 },
+  { "Saturat0r", 0 },
+  { "Invert0r", 0 },
+  { "Threshold0r", 0 },
+  { "Tint0r", 0 },
+  { "Gamma", 0 },
+  { "Hueshift0r", 0 },
+  { "Luminance", 0 },
+  { "R", 0 },
+  { "G", 0 },
+  { "B", 0 },
+  { "Transparency", 0 },
+  { "Primaries", 0 },
+  { "Coloradj_RGB", 0 },
+  { "White Balance", 0 },
+  { "Color Distance", 0 },
+  { "Posterize", 0 },
+  { "Baltan", 0 },
+  { "Sobel", 1 },
+  { "Edgeglow", 1 },
+  // mixers blending the pixels of two frames, run row by row
+  { "addition", 0 },
+  { "addition_alpha", 0 },
+  { "alphaatop", 0 },
+  { "alphain", 0 },
+  { "alphaout", 0 },
+  { "alphaover", 0 },
+  { "alphaxor", 0 },
+  { "blend", 0 },
+  { "burn", 0 },
+  { "color_only", 0 },
+  { "darken", 0 },
+  { "difference", 0 },
+  { "divide", 0 },
+  { "dodge", 0 },
+  { "grain_extract", 0 },
+  { "grain_merge", 0 },
+  { "hardlight", 0 },
+  { "hue", 0 },
+  { "lighten", 0 },
+  { "multiply", 0 },
+  { "overlay", 0 },
+  { "saturation", 0 },
+  { "screen", 0 },
+  { "softlight", 0 },
+  { "subtract", 0 },
+  { "value", 0 },
+  { "xfade0r", 0 },
+  { NULL, 0 }
+};
+
+/// the instances of a filter split in bands
+struct f0r_slices_t {
+  int count;
+  int width;
+  f0r_instance_t core[FREI0R_MAX_SLICES];
+  int first[FREI0R_MAX_SLICES]; ///< first row of the band in the frame
+  int rows[FREI0R_MAX_SLICES]; ///< rows of the band
+  int top[FREI0R_MAX_SLICES]; ///< rows above the band seen by its instance
+  uint32_t *scratch[FREI0R_MAX_SLICES]; ///< output of an instance seeing more rows
+
+  // frame being processed
+  Freior *filter;
+  double time;
+  const uint32_t *in;
+  uint32_t *out;
+};
+
+/// set a parameter on the instance and on those of its bands
+static void set_value(Freior *f, FilterInstance *filt, f0r_param_t value, int idx) {
+  f0r_slices_t *sl = (f0r_slices_t*)filt->slices;
+  int c;
+
+  (*f->f0r_set_param_value)(filt->core, value, idx);
+  if(sl)
+    for(c = 0; c < sl->count; c++)
+      (*f->f0r_set_param_value)(sl->core[c], value, idx);
+}
+
 /// frei0r parameter callbacks
 static void get_frei0r_parameter(FilterInstance *filt, Parameter *param, int idx) {
     Freior *f = (Freior *)filt->proto;
@@ -94,31 +185,29 @@ static void set_frei0r_parameter(FilterInstance *filt, Parameter *param, int idx
             
             func("bool value is %s",(*(bool*)param->value==true) ? "true" : "false");
             
-            (*f->f0r_set_param_value)
-            (filt->core, new f0r_param_bool(*(bool*)param->value), idx-1);
-            
-            break;
+        { f0r_param_bool b = *(bool*)param->value;
+            set_value(f, filt, &b, idx-1);
+        } break;
             
         case F0R_PARAM_DOUBLE:
             func("number value is %g",*(double*)param->value);
-            (*f->f0r_set_param_value)(filt->core, new f0r_param_double( *(double*)param->value), idx-1);
-            break;
+        { f0r_param_double d = *(double*)param->value;
+            set_value(f, filt, &d, idx-1);
+        } break;
             
         case F0R_PARAM_COLOR:
-        { f0r_param_color *color = new f0r_param_color;
-            color->r = val[0];
-            color->g = val[1];
-            color->b = val[2];
-            (*f->f0r_set_param_value)(filt->core, color, idx-1);
-            delete color;
-            // QUAAA: should we delete the new allocated object? -jrml
+        { f0r_param_color color;
+            color.r = val[0];
+            color.g = val[1];
+            color.b = val[2];
+            set_value(f, filt, &color, idx-1);
         } break;
             
         case F0R_PARAM_POSITION:
-        { f0r_param_position *position = new f0r_param_position;
-            position->x = val[0];
-            position->y = val[1];
-            (*f->f0r_set_param_value)(filt->core, position, idx-1);
+        { f0r_param_position position;
+            position.x = val[0];
+            position.y = val[1];
+            set_value(f, filt, &position, idx-1);
         } break;
             
         default:
@@ -136,6 +225,7 @@ Freior::Freior()
 { 
   handle = NULL;
   opened = false;
+  slice_halo = -1;
            
   set_name((char *)"Unknown");
 }
@@ -147,7 +237,7 @@ Freior::~Freior() {
 
 }
 
-int Freior::open(char *file) {
+bool Freior::open_library(const char *file) {
   void *sym;
 #ifdef HAVE_FREEBSD
   const char *err;
@@ -155,25 +245,20 @@ int Freior::open(char *file) {
   char *err;
 #endif
 
-  if(opened) {
-    error("Freior object %p has already opened file %s",this, filename);
-    return 0;
-  }
-
   // clear up the errors if there were any
   dlerror();
 
 #if 0
   if (!dlopen_preflight(file)) {
     warning("plugin '%s' failed: %s", file, dlerror());
-    return 0;
+    return false;
   }
 #endif
   // Create dynamic handle to the library file.
   handle = dlopen(file, RTLD_LAZY);
   if(!handle) {
     warning("can't dlopen plugin: %s", file);
-    return 0;
+    return false;
   }
 
   // try the frei0r symbol
@@ -185,7 +270,7 @@ int Freior::open(char *file) {
     // don't forget to close
     dlclose(handle);
     handle = NULL;
-    return 0;
+    return false;
   }
 
   // Get interface function pointers
@@ -218,16 +303,46 @@ int Freior::open(char *file) {
   // XXX - don't output an error since f0r_update() is exported only by generators
   //       and it won't be found when opening filters
   //err = dlerror(); if (err) warning("%s in frei0r plugin %s", err, file);
+  // and f0r_update2() only by mixers
+  *(void**) (&f0r_update2) = dlsym(handle, "f0r_update2");
+
+  f0r_init();
+
+  return true;
+}
+
+void Freior::named() {
+  set_name((char*)info.name);
+
+  for(int c = 0; sliceable[c].name; c++)
+    if(strcmp(info.name, sliceable[c].name) == 0) {
+      slice_halo = sliceable[c].halo;
+      break;
+    }
+}
+
+int Freior::open(char *file) {
+
+  if(opened) {
+    error("Freior object %p has already opened file %s",this, filename);
+    return 0;
+  }
+
+  if(!open_library(file))
+    return 0;
   
   // get the info on the plugin
   (*f0r_get_plugin_info)(&info);
 
+  // and on its parameters
+  param_infos.resize(info.num_params);
+  for (int i = 0; i < info.num_params; ++i)
+    (*f0r_get_param_info)(&param_infos[i], i);
+
   opened = true;
   snprintf(filename,255,"%s",file);
 
-  f0r_init();
-  
-  set_name((char*)info.name);
+  named();
   
   if(get_debug()>2)
       print_info();
@@ -236,13 +351,76 @@ int Freior::open(char *file) {
 
 }
 
+void Freior::defer(const char *file, plugin_entry_t *e) {
+  int c, n = e->params.size();
+
+  // the strings of the plugin are those of the registry entry
+  info_strings[0] = e->name;
+  info_strings[1] = e->author;
+  info_strings[2] = e->explanation;
+  info.name = info_strings[0].c_str();
+  info.author = info_strings[1].c_str();
+  info.explanation = info_strings[2].c_str();
+  info.plugin_type = e->type;
+  info.frei0r_version = e->version[0];
+  info.major_version = e->version[1];
+  info.minor_version = e->version[2];
+  info.color_model = e->version[3];
+  info.num_params = n;
+
+  param_strings.resize(n * 2);
+  param_infos.resize(n);
+  for(c = 0; c < n; c++) {
+    param_strings[c * 2] = e->params[c].name;
+    param_strings[c * 2 + 1] = e->params[c].explanation;
+    param_infos[c].name = param_strings[c * 2].c_str();
+    param_infos[c].explanation = param_strings[c * 2 + 1].c_str();
+    param_infos[c].type = e->params[c].type;
+  }
+
+  opened = true;
+  snprintf(filename,255,"%s",file);
+
+  named();
+}
+
+bool Freior::load() {
+  if(handle) return true;
+  if(!opened) return false;
+
+  func("opening frei0r plugin %s on first use", filename);
+  if(!open_library(filename)) {
+    error("frei0r plugin %s can't be opened anymore", filename);
+    return false;
+  }
+  return true;
+}
+
+void Freior::describe(plugin_entry_t *e) {
+  int c;
+
+  e->kind = PLUGIN_FREI0R;
+  e->type = info.plugin_type;
+  e->name = info.name ? info.name : "";
+  e->author = info.author ? info.author : "";
+  e->explanation = info.explanation ? info.explanation : "";
+  e->version[0] = info.frei0r_version;
+  e->version[1] = info.major_version;
+  e->version[2] = info.minor_version;
+  e->version[3] = info.color_model;
+
+  e->params.resize(param_infos.size());
+  for(c = 0; c < (int)param_infos.size(); c++) {
+    e->params[c].name = param_infos[c].name ? param_infos[c].name : "";
+    e->params[c].explanation = param_infos[c].explanation ? param_infos[c].explanation : "";
+    e->params[c].type = param_infos[c].type;
+  }
+}
+
 void Freior::init_parameters(Linklist<Parameter> &parameters) {
-	// Get the list of params.
-	param_infos.resize(info.num_params);
+	// the list of params was read with the plugin info
 	for (int i = 0; i < info.num_params; ++i) {
 		
-		(f0r_get_param_info)(&param_infos[i], i);
-		
 		Parameter *param = new Parameter((Parameter::Type)param_infos[i].type);
 		snprintf(param->name, 255, "%s", param_infos[i].name);
 		func("registering parameter %s for filter %s\n", param->name, info.name);
@@ -282,23 +460,141 @@ void Freior::print_info() {
 
 bool Freior::apply(Layer *lay, FilterInstance *instance) 
 {
+    if (!load())
+        return false;
     instance->core = (*f0r_construct)(lay->geo.w, lay->geo.h);
     if (!instance->core)
         return false;
-    return Filter::apply(lay, instance);
+    if (!Filter::apply(lay, instance))
+        return false;
+    // the whole frame instance is kept for the parameters
+    apply_slices(lay, instance);
+    return true;
+}
+
+bool Freior::apply_slices(Layer *lay, FilterInstance *instance) {
+    f0r_slices_t *sl;
+    double value[4]; // large enough for any parameter type
+    int w = lay->geo.w, h = lay->geo.h;
+    int c, p, n, bottom, step, halo;
+
+    if (!slices || slice_halo < 0 || info.plugin_type != F0R_PLUGIN_TYPE_FILTER)
+        return false;
+
+    if (!slice_pool) {
+        slice_pool = new WorkerPool();
+        slice_pool->init();
+    }
+    // a band per thread, of a few rows at least
+    n = slice_pool->threads() + 1;
+    if (n > FREI0R_MAX_SLICES) n = FREI0R_MAX_SLICES;
+    while (n > 1 && h / n < 16 + 2 * slice_halo) n--;
+    if (n < 2)
+        return false;
+
+    // frei0r wants frames aligned to 16 bytes: bands and the rows above
+    // them start on rows whose offset in the frame is a multiple of 16
+    step = (w % 4 == 0) ? 1 : (w % 2 == 0) ? 2 : 4;
+    halo = ((slice_halo + step - 1) / step) * step;
+
+    sl = (f0r_slices_t*)calloc(1, sizeof(f0r_slices_t));
+    sl->width = w;
+    for (c = 0; c < n; c++) {
+        sl->first[c] = (((c * h) / n) / step) * step;
+        sl->rows[c] = ((c + 1 < n) ? ((((c + 1) * h) / n) / step) * step : h)
+            - sl->first[c];
+        sl->top[c] = (sl->first[c] < halo) ? sl->first[c] : halo;
+        bottom = h - sl->first[c] - sl->rows[c];
+        if (bottom > slice_halo) bottom = slice_halo;
+
+        sl->core[c] = (*f0r_construct)(w, sl->top[c] + sl->rows[c] + bottom);
+        if (!sl->core[c]) break;
+        sl->count++;
+        if (slice_halo)
+            sl->scratch[c] = (uint32_t*)BufferPool::get
+                (w * (sl->top[c] + sl->rows[c] + bottom) * sizeof(uint32_t));
+
+        // same settings as the whole frame instance
+        for (p = 0; p < info.num_params; p++) {
+            (*f0r_get_param_value)(instance->core, value, p);
+            (*f0r_set_param_value)(sl->core[c], value, p);
+        }
+    }
+    instance->slices = sl;
+    if (sl->count < n) {
+        warning("filter %s can't be split in bands, runs on the whole frame", name);
+        destruct_slices(instance);
+        return false;
+    }
+    act("filter %s runs in %u bands on layer %s", name, n, lay->name);
+    return true;
+}
+
+void Freior::destruct_slices(FilterInstance *inst) {
+    f0r_slices_t *sl = (f0r_slices_t*)inst->slices;
+    int c;
+
+    if (!sl) return;
+    inst->slices = NULL;
+    for (c = 0; c < sl->count; c++) {
+        f0r_destruct(sl->core[c]);
+        BufferPool::put(sl->scratch[c]);
+    }
+    free(sl);
 }
 
 void Freior::destruct(FilterInstance *inst)
 {
+    destruct_slices(inst);
     if(inst->core) {
         f0r_destruct((f0r_instance_t*)inst->core);
         inst->core = NULL;
     }
 }
 
+void Freior::slice_job(void *arg, int idx) {
+    f0r_slices_t *sl = (f0r_slices_t*)arg;
+    const uint32_t *in = sl->in + (sl->first[idx] - sl->top[idx]) * sl->width;
+    uint32_t *out = sl->out + sl->first[idx] * sl->width;
+
+    if (!sl->scratch[idx]) {
+        // the band is written in place
+        (*sl->filter->f0r_update)(sl->core[idx], sl->time, in, out);
+        return;
+    }
+    // the rows around the band are dropped, the next band writes them
+    (*sl->filter->f0r_update)(sl->core[idx], sl->time, in, sl->scratch[idx]);
+    memcpy(out, sl->scratch[idx] + sl->top[idx] * sl->width,
+           sl->rows[idx] * sl->width * sizeof(uint32_t));
+}
+
 void Freior::update(FilterInstance *inst, double time, uint32_t *inframe, uint32_t *outframe) {
+    f0r_slices_t *sl = (f0r_slices_t*)inst->slices;
+
     Filter::update(inst, time, inframe, outframe);
-    f0r_update((f0r_instance_t*)inst->core, time, inframe, outframe);
+    if (!sl) {
+        f0r_update((f0r_instance_t*)inst->core, time, inframe, outframe);
+        return;
+    }
+    // all bands are done before the next filter of the chain
+    sl->filter = this;
+    sl->time = time;
+    sl->in = inframe;
+    sl->out = outframe;
+    slice_pool->run(&Freior::slice_job, sl, sl->count);
+}
+
+bool Freior::construct(FilterInstance *inst, unsigned int w, unsigned int h) {
+    if (!load())
+        return false;
+    destruct(inst);
+    inst->core = (*f0r_construct)(w, h);
+    return (inst->core != NULL);
+}
+
+void Freior::mix(FilterInstance *inst, double time,
+		 const uint32_t *in1, const uint32_t *in2, uint32_t *out) {
+    f0r_update2((f0r_instance_t)inst->core, time, in1, in2, NULL, out);
 }
 
 const char *Freior::description()
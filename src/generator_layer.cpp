@@ -42,13 +42,10 @@ GeneratorLayer::GeneratorLayer()
   set_name("GEN");
   //jsclass = &gen0r_layer_class;
   //  set_filename("/particle generator");
-  swap_buffer = NULL;
 }
 
 GeneratorLayer::~GeneratorLayer() {
   close();
-  if (swap_buffer)
-    free(swap_buffer);
 }
 
 /// set_parameter callback for generator layers
@@ -129,6 +126,11 @@ bool GeneratorLayer::open(const char *file) {
   
 #ifdef WITH_FREI0R
   if(proto->type() == Filter::FREIOR) {
+    if(!((Freior *)proto)->load()) {
+      delete generator;
+      generator = NULL;
+      return false;
+    }
     generator->core = (void*)(*((Freior *)proto)->f0r_construct)(geo.w, geo.h);
     if(!generator->core) {
       error("freior constructor returned NULL instantiating generator %s",file);
@@ -149,6 +151,11 @@ bool GeneratorLayer::open(const char *file) {
 
   if(proto->type() == Filter::FREEFRAME) {
     VideoInfoStruct vidinfo;
+    if(!((Freeframe *)proto)->load()) {
+      delete generator;
+      generator = NULL;
+      return false;
+    }
     vidinfo.frameWidth = geo.w;
     vidinfo.frameHeight = geo.h;
     vidinfo.orientation = 1;
@@ -170,10 +177,6 @@ bool GeneratorLayer::open(const char *file) {
     }
   }
 
-  // XXX - are we allocating memory for someone else? ... this is crap !!!
-  generator->outframe = (uint32_t*) calloc(geo.bytesize, 1);
-
-
   set_filename(file);
   opened = true;
   return true;
@@ -192,21 +195,17 @@ bool GeneratorLayer::_init() {
   //  open("lissajous0r");
   //  open("ising0r");
 
-  if (!swap_buffer)
-    swap_buffer = malloc(geo.bytesize);
-  else { // if changing context ensure we can handle its resolution
-    swap_buffer = realloc(swap_buffer, geo.bytesize);
-  }
   return(true);
 }
 
 void *GeneratorLayer::feed() {
-  void *res;
-  if (generator) {
-      res = generator->process(fps.get(), NULL);
-      jmemcpy(swap_buffer, res, geo.bytesize);
-  }
-  return swap_buffer;
+  uint32_t *res;
+  if (!generator) return NULL;
+
+  // render straight in the frame slot handed over to the screen
+  res = (uint32_t*)frame_slot();
+  // generators are animated by the time in seconds
+  return generator->process(FPS::now() / 1000000000.0, NULL, res);
 }
 
     
@@ -0,0 +1,227 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <config.h>
+
+#include <i420_convert.h>
+#include <worker_pool.h>
+#include <cpu_accel.h>
+#include <jutils.h>
+
+// scaling of RGB2YUV in convertvid.h
+#define Y_R  263
+#define Y_G  516
+#define Y_B  100
+#define U_R -152
+#define U_G -298
+#define U_B  450
+#define V_R  450
+#define V_G -377
+#define V_B  -73
+
+// convert the pixels from x to w of a pair of rows
+static void convert_pair_c(const uint8_t *s0, const uint8_t *s1, int x, int w,
+			   uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+			   int ri, int gi, int bi) {
+  const uint8_t *p[4];
+  int r, g, b, c, uu[4], vv[4];
+  uint8_t *yy[4];
+
+  for( ; x < w ; x += 2) {
+    p[0] = s0 + x * 4; p[1] = p[0] + 4;
+    p[2] = s1 + x * 4; p[3] = p[2] + 4;
+    yy[0] = y0 + x; yy[1] = yy[0] + 1;
+    yy[2] = y1 + x; yy[3] = yy[2] + 1;
+    for(c = 0; c < 4; c++) {
+      r = p[c][ri]; g = p[c][gi]; b = p[c][bi];
+      *yy[c] = ((Y_R * r + Y_G * g + Y_B * b) >> 10) + 16;
+      uu[c]  = ((U_R * r + U_G * g + U_B * b) >> 10) + 128;
+      vv[c]  = ((V_R * r + V_G * g + V_B * b) >> 10) + 128;
+    }
+    // average on the pixels of each row, then on the two rows
+    u[x >> 1] = (((uu[0] + uu[1]) >> 1) + ((uu[2] + uu[3]) >> 1)) >> 1;
+    v[x >> 1] = (((vv[0] + vv[1]) >> 1) + ((vv[2] + vv[3]) >> 1)) >> 1;
+  }
+}
+
+#if defined(ARCH_X86) && defined(__GNUC__)
+
+#include <emmintrin.h>
+
+#define TARGET __attribute__((target("sse2")))
+
+// weights of the channels for madd on two unpacked pixels
+static TARGET inline __m128i weights(int ri, int gi, int bi, int wr, int wg, int wb) {
+  short c[4] = { 0, 0, 0, 0 };
+  c[ri] = wr; c[gi] = wg; c[bi] = wb;
+  return _mm_setr_epi16(c[0], c[1], c[2], c[3], c[0], c[1], c[2], c[3]);
+}
+
+// weighted sum of the channels of four pixels unpacked in lo and hi
+static TARGET inline __m128i dot4(__m128i lo, __m128i hi, __m128i w) {
+  __m128 a = _mm_castsi128_ps(_mm_madd_epi16(lo, w));
+  __m128 b = _mm_castsi128_ps(_mm_madd_epi16(hi, w));
+  return _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0))),
+		       _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1))));
+}
+
+// average of the pairs of neighbour values in a and b
+static TARGET inline __m128i pairs(__m128i a, __m128i b) {
+  __m128 fa = _mm_castsi128_ps(a);
+  __m128 fb = _mm_castsi128_ps(b);
+  return _mm_srai_epi32(_mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(2,0,2,0))),
+				      _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(3,1,3,1)))), 1);
+}
+
+// convert 8 pixels of a row: luma is stored, chroma averaged on pairs
+static TARGET inline void convert_8(const uint8_t *s, uint8_t *y,
+				    __m128i wy, __m128i wu, __m128i wv,
+				    __m128i *u, __m128i *v) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i p0 = _mm_loadu_si128((const __m128i*)s);
+  __m128i p1 = _mm_loadu_si128((const __m128i*)(s + 16));
+  __m128i l0 = _mm_unpacklo_epi8(p0, zero), h0 = _mm_unpackhi_epi8(p0, zero);
+  __m128i l1 = _mm_unpacklo_epi8(p1, zero), h1 = _mm_unpackhi_epi8(p1, zero);
+  __m128i a, b;
+
+  a = _mm_add_epi32(_mm_srai_epi32(dot4(l0, h0, wy), 10), _mm_set1_epi32(16));
+  b = _mm_add_epi32(_mm_srai_epi32(dot4(l1, h1, wy), 10), _mm_set1_epi32(16));
+  a = _mm_packs_epi32(a, b);
+  _mm_storel_epi64((__m128i*)y, _mm_packus_epi16(a, a));
+
+  a = _mm_add_epi32(_mm_srai_epi32(dot4(l0, h0, wu), 10), _mm_set1_epi32(128));
+  b = _mm_add_epi32(_mm_srai_epi32(dot4(l1, h1, wu), 10), _mm_set1_epi32(128));
+  *u = pairs(a, b);
+
+  a = _mm_add_epi32(_mm_srai_epi32(dot4(l0, h0, wv), 10), _mm_set1_epi32(128));
+  b = _mm_add_epi32(_mm_srai_epi32(dot4(l1, h1, wv), 10), _mm_set1_epi32(128));
+  *v = pairs(a, b);
+}
+
+static TARGET int convert_pair_sse2(const uint8_t *s0, const uint8_t *s1, int w,
+				    uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+				    int ri, int gi, int bi) {
+  __m128i wy = weights(ri, gi, bi, Y_R, Y_G, Y_B);
+  __m128i wu = weights(ri, gi, bi, U_R, U_G, U_B);
+  __m128i wv = weights(ri, gi, bi, V_R, V_G, V_B);
+  __m128i ut, vt, ub, vb, c;
+  int x;
+
+  for(x = 0; x + 8 <= w; x += 8) {
+    convert_8(s0 + x * 4, y0 + x, wy, wu, wv, &ut, &vt);
+    convert_8(s1 + x * 4, y1 + x, wy, wu, wv, &ub, &vb);
+
+    c = _mm_srai_epi32(_mm_add_epi32(ut, ub), 1);
+    c = _mm_packs_epi32(c, c);
+    *(uint32_t*)(u + (x >> 1)) = _mm_cvtsi128_si32(_mm_packus_epi16(c, c));
+
+    c = _mm_srai_epi32(_mm_add_epi32(vt, vb), 1);
+    c = _mm_packs_epi32(c, c);
+    *(uint32_t*)(v + (x >> 1)) = _mm_cvtsi128_si32(_mm_packus_epi16(c, c));
+  }
+  return x; // the tail is left to the scalar code
+}
+
+#endif
+
+I420Convert::I420Convert() {
+  init(mm_accel());
+}
+
+I420Convert::I420Convert(uint32_t accel) {
+  init(accel);
+}
+
+void I420Convert::init(uint32_t accel) {
+  ri = 0; gi = 1; bi = 2;
+  sse2 = false;
+#if defined(ARCH_X86) && defined(__GNUC__)
+  sse2 = (accel & MM_ACCEL_X86_SSE2);
+#endif
+  job_src = NULL;
+  job_w = job_h = job_stride = 0;
+  job_y = job_u = job_v = NULL;
+  jobs = 1;
+}
+
+I420Convert::~I420Convert() { }
+
+bool I420Convert::set_format(ViewPort::fourcc format) {
+  switch(format) {
+  case ViewPort::RGBA32: ri = 0; gi = 1; bi = 2; break;
+  case ViewPort::BGRA32: ri = 2; gi = 1; bi = 0; break;
+  case ViewPort::ARGB32: ri = 1; gi = 2; bi = 3; break;
+  default:
+    return false;
+  }
+  return true;
+}
+
+void I420Convert::convert(const uint8_t *src, int w, int h, int stride,
+			  uint8_t *y, uint8_t *u, uint8_t *v, WorkerPool *pool) {
+
+  job_src = src;
+  job_w = w & ~1;
+  job_h = h & ~1;
+  job_stride = stride;
+  job_y = y;
+  job_u = u;
+  job_v = v;
+  if(job_w <= 0 || job_h <= 0) return;
+
+  // twice as many bands as threads, but at least a pair of rows each
+  jobs = pool ? (pool->threads() + 1) * 2 : 1;
+  if(jobs > job_h / 2) jobs = job_h / 2;
+
+  if(pool && jobs > 1)
+    pool->run(&I420Convert::convert_job, this, jobs);
+  else {
+    jobs = 1;
+    convert_job(this, 0);
+  }
+}
+
+void I420Convert::convert_job(void *arg, int idx) {
+  I420Convert *cv = (I420Convert*)arg;
+  const uint8_t *s0, *s1;
+  uint8_t *y0, *y1, *u, *v;
+  int pair, last, x, cw;
+
+  pair = (idx * (cv->job_h / 2)) / cv->jobs;
+  last = ((idx + 1) * (cv->job_h / 2)) / cv->jobs;
+  cw = cv->job_w / 2;
+
+  for( ; pair < last ; pair++) {
+    s0 = cv->job_src + (pair * 2) * cv->job_stride;
+    s1 = s0 + cv->job_stride;
+    y0 = cv->job_y + (pair * 2) * cv->job_w;
+    y1 = y0 + cv->job_w;
+    u = cv->job_u + pair * cw;
+    v = cv->job_v + pair * cw;
+
+    x = 0;
+#if defined(ARCH_X86) && defined(__GNUC__)
+    if(cv->sse2)
+      x = convert_pair_sse2(s0, s1, cv->job_w, y0, y1, u, v,
+			    cv->ri, cv->gi, cv->bi);
+#endif
+    convert_pair_c(s0, s1, x, cv->job_w, y0, y1, u, v,
+		   cv->ri, cv->gi, cv->bi);
+  }
+}
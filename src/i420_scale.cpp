@@ -0,0 +1,225 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <i420_scale.h>
+#include <worker_pool.h>
+#include <cpu_accel.h>
+#include <jutils.h>
+
+// weights are out of 128, so that a blend fits in 16 bits
+#define FRAC_BITS 7
+#define FRAC_ONE  (1 << FRAC_BITS)
+#define FRAC_HALF (1 << (FRAC_BITS - 1))
+
+// blend the samples from x to w of two rows
+static void blend_rows_c(const uint8_t *r0, const uint8_t *r1, int x, int w,
+			 int f, uint8_t *dst) {
+  int f0 = FRAC_ONE - f;
+  for( ; x < w ; x++)
+    dst[x] = (r0[x] * f0 + r1[x] * f + FRAC_HALF) >> FRAC_BITS;
+}
+
+#if defined(ARCH_X86) && defined(__GNUC__)
+
+#include <emmintrin.h>
+
+#define TARGET __attribute__((target("sse2")))
+
+static TARGET int blend_rows_sse2(const uint8_t *r0, const uint8_t *r1, int w,
+				  int f, uint8_t *dst) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i w0 = _mm_set1_epi16(FRAC_ONE - f);
+  __m128i w1 = _mm_set1_epi16(f);
+  __m128i half = _mm_set1_epi16(FRAC_HALF);
+  __m128i a, b, lo, hi;
+  int x;
+
+  for(x = 0; x + 16 <= w; x += 16) {
+    a = _mm_loadu_si128((const __m128i*)(r0 + x));
+    b = _mm_loadu_si128((const __m128i*)(r1 + x));
+    lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), w0),
+		       _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w1));
+    hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), w0),
+		       _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w1));
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, half), FRAC_BITS);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, half), FRAC_BITS);
+    _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(lo, hi));
+  }
+  return x; // the tail is left to the scalar code
+}
+
+#endif
+
+I420Scale::I420Scale() {
+  init(mm_accel());
+}
+
+I420Scale::I420Scale(uint32_t accel) {
+  init(accel);
+}
+
+void I420Scale::init(uint32_t accel) {
+  int c;
+  sse2 = false;
+#if defined(ARCH_X86) && defined(__GNUC__)
+  sse2 = (accel & MM_ACCEL_X86_SSE2);
+#endif
+  for(c = 0; c < 4; c++) {
+    axis[c].pos = NULL;
+    axis[c].frac = NULL;
+    axis[c].src = axis[c].dst = axis[c].size = 0;
+  }
+  rows = NULL;
+  row_size = rows_alloc = 0;
+  jobs = 1;
+}
+
+I420Scale::~I420Scale() {
+  int c;
+  for(c = 0; c < 4; c++) {
+    if(axis[c].pos) free(axis[c].pos);
+    if(axis[c].frac) free(axis[c].frac);
+  }
+  if(rows) free(rows);
+}
+
+void I420Scale::setup(axis_t *a, int src, int dst) {
+  int64_t p;
+  int c;
+
+  if(a->src == src && a->dst == dst) return;
+
+  if(a->size < dst) {
+    a->pos = (int*)realloc(a->pos, dst * sizeof(int));
+    a->frac = (uint8_t*)realloc(a->frac, dst);
+    a->size = dst;
+  }
+  // centers of the destination samples, in 16.16 source coordinates
+  for(c = 0; c < dst; c++) {
+    p = (((int64_t)(2 * c + 1) * src) << 16) / (2 * dst) - (1 << 15);
+    if(p < 0) p = 0;
+    a->pos[c] = (int)(p >> 16);
+    a->frac[c] = (uint8_t)((p & 0xffff) >> (16 - FRAC_BITS));
+    if(a->pos[c] >= src - 1) {
+      a->pos[c] = src - 1;
+      a->frac[c] = 0;
+    }
+  }
+  a->src = src;
+  a->dst = dst;
+}
+
+void I420Scale::scale(const uint8_t *sy, const uint8_t *su, const uint8_t *sv,
+		      int sw, int sh,
+		      uint8_t *dy, uint8_t *du, uint8_t *dv, int dw, int dh,
+		      WorkerPool *pool) {
+
+  if(sw < 2 || sh < 2 || dw < 2 || dh < 2) return;
+
+  job_src[0] = sy; job_src[1] = su; job_src[2] = sv;
+  job_dst[0] = dy; job_dst[1] = du; job_dst[2] = dv;
+  job_sw = sw; job_sh = sh;
+  job_dw = dw; job_dh = dh;
+
+  setup(&axis[0], sw, dw);
+  setup(&axis[1], sh, dh);
+  setup(&axis[2], sw >> 1, dw >> 1);
+  setup(&axis[3], sh >> 1, dh >> 1);
+
+  // twice as many bands as threads, but at least a pair of rows each
+  jobs = pool ? (pool->threads() + 1) * 2 : 1;
+  if(jobs > dh / 2) jobs = dh / 2;
+  if(!pool || jobs < 1) jobs = 1;
+
+  // room for a blended luma row per job, plus the sample repeated at its end
+  row_size = (sw + 16) & ~15;
+  if(rows_alloc < row_size * jobs) {
+    rows = (uint8_t*)realloc(rows, row_size * jobs);
+    rows_alloc = row_size * jobs;
+  }
+
+  if(jobs > 1)
+    pool->run(&I420Scale::scale_job, this, jobs);
+  else
+    scale_job(this, 0);
+}
+
+void I420Scale::scale_job(void *arg, int idx) {
+  I420Scale *sc = (I420Scale*)arg;
+  int p;
+  for(p = 0; p < 3; p++)
+    sc->scale_band(p, idx);
+}
+
+void I420Scale::scale_band(int p, int idx) {
+  const axis_t *ax, *ay;
+  const uint8_t *src, *r0, *r1;
+  uint8_t *dst, *row, *d;
+  int sw, dw, dh, first, last, x, y, f, y1;
+
+  sw = p ? job_sw >> 1 : job_sw;
+  dw = p ? job_dw >> 1 : job_dw;
+  dh = p ? job_dh >> 1 : job_dh;
+  ax = &axis[p ? 2 : 0];
+  ay = &axis[p ? 3 : 1];
+  src = job_src[p];
+  dst = job_dst[p];
+  row = rows + idx * row_size;
+
+  first = (idx * dh) / jobs;
+  last = ((idx + 1) * dh) / jobs;
+
+  for(y = first; y < last; y++) {
+    d = dst + y * dw;
+
+    // blend the two source rows around the destination one
+    r0 = src + ay->pos[y] * sw;
+    f = ay->frac[y];
+    if(!f)
+      memcpy(row, r0, sw);
+    else {
+      y1 = ay->pos[y] + 1;
+      r1 = src + y1 * sw;
+      x = 0;
+#if defined(ARCH_X86) && defined(__GNUC__)
+      if(sse2)
+	x = blend_rows_sse2(r0, r1, sw, f, row);
+#endif
+      blend_rows_c(r0, r1, x, sw, f, row);
+    }
+
+    if(sw == dw) {
+      memcpy(d, row, dw);
+      continue;
+    }
+
+    // then sample along the row, the last sample is read past its end
+    row[sw] = row[sw - 1];
+    for(x = 0; x < dw; x++) {
+      f = ax->frac[x];
+      r0 = row + ax->pos[x];
+      d[x] = (r0[0] * (FRAC_ONE - f) + r0[1] * f + FRAC_HALF) >> FRAC_BITS;
+    }
+  }
+}
@@ -0,0 +1,131 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+   @file automation.h
+   @brief Parameters animated by keyframes, evaluated once per frame
+*/
+
+#ifndef __AUTOMATION_H__
+#define __AUTOMATION_H__
+
+#include <inttypes.h>
+#include <iterator.h>
+
+class Layer;
+class FilterInstance;
+class Parameter;
+
+/// how values go from a keyframe to the next
+enum automation_curve_t {
+  AUTOMATION_STEP = 0,   ///< hold the value until the next keyframe
+  AUTOMATION_LINEAR = 1, ///< straight line
+  AUTOMATION_SMOOTH = 2  ///< half a cosine, easing in and out
+};
+
+/**
+   Automation animates parameters of layers and filters along
+   envelopes of keyframes, as Iterator did one value at a time.
+   The keyframes of all tracks lie in one flat array and the tracks
+   in another, so that a single pass per frame evaluates all of them
+   against the shared clock (FPS::now(), which is virtual when
+   rendering offline) and applies only the values that changed.
+
+   Values of layer parameters are applied through their layer_set_f
+   callback, in the thread running the pass. Values of filter
+   parameters are only stored and marked changed: the filter applies
+   them in the thread of its layer before processing the next frame.
+
+   Values are in the 0.0 - 1.0 range of Parameter::set(), the
+   multiplier of the parameter is applied to them. A track moves a
+   number, or one component of a position or a color.
+
+   A track ends with its last keyframe when it runs ONCE, or is
+   repeated if it runs in LOOP or back and forth if it BOUNCEs.
+
+   @brief Keyframe envelopes of parameters, evaluated in a batch
+*/
+class Automation {
+ public:
+
+  /**
+     Animate a parameter of a layer, starting now
+     @param times seconds from now of the keyframes, increasing
+     @param values value at each keyframe
+     @param n number of keyframes
+     @param component component of a position or color, 0 for numbers
+     @return id of the track, -1 on error
+  */
+  static int add(Layer *lay, Parameter *param, int idx, int component,
+		 const double *times, const double *values, int n,
+		 automation_curve_t curve, iterator_mode_t mode);
+
+  /** Animate a parameter of a filter, see the other add() */
+  static int add(FilterInstance *filt, Parameter *param, int idx, int component,
+		 const double *times, const double *values, int n,
+		 automation_curve_t curve, iterator_mode_t mode);
+
+  static bool remove(int id); ///< stop a track, the value stays where it is
+  static void drop(void *owner); ///< stop the tracks of a layer or filter being deleted
+
+  /**
+     Evaluate all tracks at the time given and apply the values changed,
+     called once per frame by the Context
+     @param now nanoseconds of the clock of FPS::now()
+     @return number of values applied
+  */
+  static int run(uint64_t now);
+
+  static int tracks(); ///< tracks running
+  static uint64_t evaluated; ///< values evaluated by run()
+  static uint64_t applied; ///< values changed and applied by run()
+
+ private:
+  struct key_t {
+    double time; ///< seconds from the start of the track
+    double value;
+  };
+  struct track_t {
+    int id;
+    Parameter *param;
+    void *owner; ///< layer or filter instance
+    bool layer; ///< owner is a layer, else a filter instance
+    int idx; ///< index of the parameter for its callbacks
+    int component;
+    int first, count; ///< keyframes of the track
+    int cursor; ///< keyframe where the last evaluation was
+    uint8_t curve, mode;
+    bool done; ///< a ONCE track past its last keyframe
+    double start; ///< clock when the track started, in seconds
+    double last; ///< value last applied
+  };
+
+  static int add_track(track_t *t, const double *times, const double *values, int n);
+  static void remove_track(int t);
+  static double eval(track_t *t, double now);
+  static void apply(track_t *t, double v);
+
+  static track_t *track;
+  static int ntracks, tracks_alloc;
+  static key_t *keys;
+  static int nkeys, keys_alloc;
+  static int next_id;
+};
+
+#endif
@@ -43,16 +43,46 @@ typedef void (blit_past_f)(void *src, void *past, void *dst, int len);
 ///////////////////////////////////////////////////////////////////////
 
 class Layer;
+class RotoZoom;
+class FilterInstance;
 
 
 template <class T> class Linklist;
 
+class Blit;
 class Blitter;
 class ViewPort;
 
 ////// blit setup functions to be used by the screen
 void setup_sdl_blits(Blitter *blitter);
-void setup_linear_blits(Blitter *blitter);
+/// accel is a mask of MM_ACCEL flags allowed for the kernels (0 = scalar only)
+void setup_linear_blits(Blitter *blitter, uint32_t accel = ~0U);
+
+/// SIMD kernel for the named linear blit, NULL if none for these MM_ACCEL flags
+blit_f *accel_linear_blit(const char *name, uint32_t accel);
+/// a MIXER blit for each frei0r mixer found by the plugger
+void setup_mixer_blits(Blitter *blitter);
+
+/**
+   Make the mixer of a MIXER blit fit the cropped layer and pass it
+   the parameters changed and the time of this frame, to be called
+   before its rows are blitted. Mixers running row by row have an
+   instance for each band of the screen, Blit::mixer_by_rows tells if
+   this frame can be split in bands; the others are a single instance.
+   @param play first pixel of the layer, already offset
+   @param pscr first pixel of the screen, already offset
+   @param bands bands the rows will be blitted in, 1 in a single pass
+   @return false if the mixer can't be run
+*/
+bool mixer_blit_prepare(Blit *b, uint32_t *play, uint32_t *pscr, int bands);
+/// mix rows of the layer frame on the screen, as prepared, in one of the bands
+void mixer_blit_rows(Blit *b, uint32_t *play, uint32_t *pscr, int rows, int band);
+
+/// value of the first blit parameter as a byte (parameters store doubles)
+static inline uint8_t blit_param_byte(Linklist<Parameter> *params) {
+  double v = *(double*)(params->begin()->value);
+  return (v < 0.0) ? 0 : (v > 255.0) ? 255 : (uint8_t)v;
+}
 
 
 class Blit: public Entry {
@@ -73,17 +103,30 @@ class Blit: public Entry {
   blit_sdl_f *sdl_fun; ///< pointer to sdl blit function
   blit_past_f *past_fun; ///< pointer to past blit function
 
+  FilterInstance *mixer; ///< frei0r mixer run by a MIXER blit, on the whole layer
+  bool mixer_rows; ///< the mixer looks only at the pixel it writes, runs row by row
+  uint32_t mixer_w, mixer_h; ///< size the whole layer mixer was constructed for
+  bool mixer_by_rows; ///< this frame is mixed row by row, in the instances of the bands
+  FilterInstance **mixer_band; ///< mixers one row wide, one for each band
+  int mixer_bands; ///< instances in mixer_band
+  uint32_t mixer_band_w; ///< width they were constructed for
+  bool mixer_defaults; ///< the defaults of the parameters were read
+  double mixer_time; ///< time of the frame being mixed, in seconds
+  uint32_t *mixer_stage; ///< aligned copies of rows for mixers of whole frames
+  size_t mixer_stage_size; ///< bytes of mixer_stage
+
   enum BlitType {
 	  NONE = 0,
 	  LINEAR = 1,
 	  SDL = 2,
-	  PAST = 3
+	  PAST = 3,
+	  MIXER = 4
   };
 
 //#define LINEAR_BLIT 1
 //#define SDL_BLIT 2
 //#define PAST_BLIT 3
-  BlitType type; ///< LINEAR|SDL|PAST type
+  BlitType type; ///< LINEAR|SDL|PAST|MIXER type
 
   //  char *get_name();
 
@@ -141,6 +184,8 @@ class Blitter {
   Blit *default_blit;
 
   Geometry *geo;
+
+  RotoZoom *rotozoom; ///< rotozoom engine, created by the screen when needed
   
  private:
   int16_t old_lay_x;
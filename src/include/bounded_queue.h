@@ -0,0 +1,72 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+   @file bounded_queue.h
+   @brief Blocking queue of pointers between pipeline threads
+*/
+
+#ifndef __BOUNDED_QUEUE_H__
+#define __BOUNDED_QUEUE_H__
+
+#include <pthread.h>
+
+/**
+   A BoundedQueue passes pointers from one stage of a pipeline to the
+   next one, in order. push() waits while the queue is full and pop()
+   waits while it is empty, so a fast stage runs ahead of a slow one
+   by at most the size of the queue.
+
+   abort() wakes up all threads waiting on the queue and makes them
+   fail, so that the stages can be stopped; reset() makes the queue
+   usable again.
+
+   @brief Bounded blocking FIFO of pointers
+*/
+class BoundedQueue {
+ public:
+  BoundedQueue();
+  ~BoundedQueue();
+
+  bool init(int size); ///< allocate room for size pointers
+
+  bool push(void *item); ///< wait for room, false if aborted
+  bool try_push(void *item); ///< false if full or aborted, never waits
+  void *pop(); ///< wait for an item, NULL if aborted
+  void *try_pop(); ///< NULL if empty, never waits
+
+  void abort(); ///< make waiting and later calls fail
+  void reset(); ///< accept calls again after abort()
+
+  int depth(); ///< items in the queue
+  int size() { return len; }; ///< maximum number of items
+
+ private:
+  void **items;
+  int len;
+  int head;
+  int count;
+  bool aborted;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+};
+
+#endif
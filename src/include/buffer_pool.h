@@ -0,0 +1,87 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+   @file buffer_pool.h
+   @brief Buffers of frames and packets reused instead of freed
+*/
+
+#ifndef __BUFFER_POOL_H__
+#define __BUFFER_POOL_H__
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/// sizes of buffers kept apart
+#define BUFFER_POOL_SLABS 32
+/// buffers kept by a slab when they are given back, the rest is freed
+#define BUFFER_POOL_KEEP 32
+/// bytes kept by all slabs, large frames past this are freed
+#define BUFFER_POOL_KEEP_BYTES (256 * 1048576)
+/// sizes of packets kept apart, powers of two from 64 bytes
+#define BUFFER_POOL_PACKET_SLABS 26
+
+/**
+   BufferPool hands out the buffers of frames and packets, and keeps
+   them when they are given back, so that the next buffer of the same
+   size comes from there instead of the heap. Buffers are grouped in
+   slabs by size: the frames of a geometry are all of one size, while
+   packets of any size come from get_packet(), which rounds them up to
+   a power of two in slabs of their own, so that they never take the
+   slabs of frames. Once a stream is running every buffer is reused
+   and nothing more is allocated.
+
+   The counters tell how many buffers came from the heap and how many
+   were reused, a steady stream only raises the second one.
+
+   Buffers are aligned to 16 bytes and must be given back with put(),
+   never with free().
+
+   @brief Slabs of reusable buffers
+*/
+class BufferPool {
+ public:
+  static void *get(size_t size); ///< a buffer of size bytes, its content is undefined
+  static void *get_zero(size_t size); ///< a buffer of size bytes set to zero
+  static void *get_packet(size_t size); ///< a buffer of at least size bytes, for data of varying size
+  static void put(void *buf); ///< give back a buffer, NULL is ignored
+
+  /** Free the buffers kept by the slabs, called by Context::reset() */
+  static void trim();
+
+  static uint64_t allocations; ///< buffers taken from the heap
+  static uint64_t reuses; ///< buffers taken from a slab
+  static size_t kept; ///< bytes held by the slabs, ready to be reused
+  static size_t used; ///< bytes of the buffers given out
+
+ private:
+  struct slab_t {
+    size_t size;
+    void *free[BUFFER_POOL_KEEP];
+    int count;
+  };
+  static slab_t slabs[BUFFER_POOL_SLABS];
+  static int nslabs;
+  static slab_t packets[BUFFER_POOL_PACKET_SLABS];
+  static slab_t *find(size_t size);
+  static slab_t *find_packet(size_t size);
+  static void *take(size_t size, int kind); ///< size already rounded
+};
+
+#endif
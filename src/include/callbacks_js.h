@@ -90,6 +90,8 @@ const JSErrorFormatString * JSFreej_GetErrorMessage(void *userRef, const char *l
 jsint js_get_int(jsval val);
 char *js_get_string(jsval val);
 jsdouble js_get_double(jsval val);
+// keyframes from a flat array [time, value, time, value...], returns how many
+int js_get_keyframes(JSContext *cx, jsval val, double *times, double *values, int max);
 
 
 
@@ -0,0 +1,116 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+   @file clip_cache.h
+   @brief Decoded clips kept in memory
+*/
+
+#ifndef __CLIP_CACHE_H__
+#define __CLIP_CACHE_H__
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include <linklist.h>
+
+/**
+   A CachedClip holds all the frames of a movie decoded to 32 bit
+   RGBA, with their presentation time, so that a layer can play it
+   again in any direction without decoding. It is named after the
+   full path of the file.
+
+   A clip is filled once by the layer decoding it, then it is shared
+   read only by all the layers opening the same file.
+
+   @brief Decoded frames of a movie
+*/
+class CachedClip : public Entry {
+  friend class ClipCache;
+ public:
+  CachedClip();
+  ~CachedClip();
+
+  int width;
+  int height;
+  int count; ///< frames stored
+  bool complete; ///< the whole clip is stored
+
+  uint8_t *frame(int n) { return frames[n]; }; ///< RGBA pixels of frame n
+  double pts(int n) { return times[n]; }; ///< presentation time of frame n
+  int find(double t); ///< last frame presented before or at time t
+
+ private:
+  uint8_t **frames;
+  double *times;
+  int capacity;
+  size_t frame_size;
+  size_t bytes;
+
+  int users; ///< layers playing or filling the clip
+  uint64_t last_use;
+};
+
+/**
+   ClipCache keeps the CachedClip of movies within a memory budget
+   shared by all layers. When a new frame does not fit, the clips
+   no layer is using are evicted, least recently used first; if that
+   is not enough the clip being filled is given up.
+
+   The cache is disabled while its budget is 0, which is the default.
+
+   @brief Memory budget of the cached clips
+*/
+class ClipCache {
+ public:
+  /** Set the budget in bytes, clips over it are evicted */
+  static void set_budget(size_t bytes);
+  static size_t get_budget() { return budget; };
+  static size_t get_used() { return used; }; ///< bytes of all the clips
+
+  /** A complete clip of the file at this size, NULL if not cached */
+  static CachedClip *find(const char *file, int w, int h);
+
+  /** A new empty clip to be filled with add_frame() */
+  static CachedClip *create(const char *file, int w, int h);
+
+  /** Copy a frame at the end of a clip, false if it doesn't fit */
+  static bool add_frame(CachedClip *clip, const uint8_t *rgba, double pts);
+
+  /** All frames are in, the clip can be shared */
+  static void finish(CachedClip *clip);
+
+  /**
+     Done with a clip given by find() or create(); a clip that is not
+     complete is dropped, the others stay cached for the next user
+  */
+  static void release(CachedClip *clip);
+
+ private:
+  static Linklist<CachedClip> &clips();
+  static bool reserve(size_t bytes, CachedClip *keep);
+  static void unreserve(CachedClip *clip, size_t bytes);
+  static void evict(CachedClip *clip);
+
+  static size_t budget;
+  static size_t used;
+  static uint64_t uses;
+};
+
+#endif
@@ -76,6 +76,7 @@ class Context {
   // parts of the cafudda process
   void handle_resize();
   void handle_controllers();
+  void render_screens();
 
   pthread_t cafudda_thread;
   bool running;
@@ -110,6 +111,18 @@ class Context {
   void start(); ///< start the engine and loop until quit is false
   void start_threaded(); ///< start the engine in a thread, looping until quit is false
 
+  /**
+     Render frames offline, as fast as possible: the shared clock turns
+     virtual and moves one frame period at a time, layers and encoders
+     are stepped in this thread instead of running their own, so that
+     the same script always renders the same frames. Throughput and the
+     timings of all stages are printed at the end, then the threads that
+     were running are started again on the live clock.
+     @param frames number of frames to render
+     @return number of frames rendered, less if quit was set meanwhile
+  */
+  int render_offline(int frames);
+
   bool register_controller(Controller *ctrl);
   bool rem_controller(Controller *ctrl);
 
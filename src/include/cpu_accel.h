@@ -66,6 +66,7 @@
 #define MM_ACCEL_X86_MMXEXT     0x20000000
 #define MM_ACCEL_X86_SSE        0x10000000
 #define MM_ACCEL_X86_SSE2       0x08000000
+#define MM_ACCEL_X86_AVX2       0x02000000
 /* powerpc accelerations */
 #define MM_ACCEL_PPC_ALTIVEC    0x04000000
 /* x86 compat defines */
@@ -74,11 +75,14 @@
 #define MM_MMXEXT               MM_ACCEL_X86_MMXEXT
 #define MM_SSE                  MM_ACCEL_X86_SSE
 #define MM_SSE2                 MM_ACCEL_X86_SSE2
+#define MM_AVX2                 MM_ACCEL_X86_AVX2
 #define __u32			uint32
 
 typedef uint32_t __u32;
 
 __u32 detect_mm_accel();
+/* accelerations of the cpu, probed the first time only */
+__u32 mm_accel();
 
 #endif
 
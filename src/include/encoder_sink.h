@@ -0,0 +1,181 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+   @file encoder_sink.h
+   @brief Destinations of the data of an encoder
+*/
+
+#ifndef __ENCODER_SINK_H__
+#define __ENCODER_SINK_H__
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include <linklist.h>
+#include <bounded_queue.h>
+
+#include <shout/shout.h>
+
+/// chunks of encoded data a sink can be late of
+#define SINK_QUEUE_SIZE 64
+/// longest wait between attempts to reconnect, in seconds
+#define SINK_RECONNECT_MAX 30
+
+/**
+   An EncoderSink delivers the data of an encoder to one destination:
+   a file, an Icecast mount or a command reading from a pipe. Each
+   sink writes from a thread of its own, taking the chunks pushed by
+   the encoder out of its queue, so that a slow destination never
+   holds back the encoder nor the other sinks.
+
+   The chunks are copied in buffers allocated once, which only grow
+   to fit the largest chunk. When the queue is full a chunk is dropped
+   following the policy, chunks older than the latency budget are
+   dropped as well instead of being sent late. Chunks hold whole ogg
+   pages, so a reader of a sink which dropped some can resync.
+
+   The headers of the stream are kept by each sink and written first
+   whenever it opens, so that a sink added late or reconnecting
+   delivers a stream which can be decoded from its start.
+
+   @brief Threaded destination of encoded data
+*/
+class EncoderSink : public Entry {
+ public:
+  EncoderSink();
+  virtual ~EncoderSink();
+
+  /**
+     Make a sink out of an url
+     @param url "file:path" or a path, "pipe:command",
+     "icecast://[user:password@]host[:port]/mount"
+     @return the sink, not open yet, NULL if the url is not understood
+  */
+  static EncoderSink *create(const char *url);
+
+  bool start(); ///< open the destination and start the thread
+  void close(); ///< deliver what is queued, stop the thread and close
+
+  bool push(const char *buf, int len); ///< queue a copy of buf, false if dropped
+  void set_headers(const char *buf, int len); ///< written first on every open
+
+  enum policy_t {
+    SINK_DROP, ///< drop the chunk which doesn't fit in the queue (default)
+    SINK_DROP_OLDEST, ///< drop the oldest chunk queued to make room
+    SINK_WAIT ///< the encoder waits for room in the queue
+  };
+  policy_t policy;
+  uint32_t latency; ///< milliseconds a chunk may wait to be sent, 0 is forever
+  bool reconnect; ///< open again when writing fails, instead of dropping all
+  uint32_t id; ///< given by the encoder, never reused while it lives
+
+  bool is_running() { return running; };
+  double get_rate(); ///< kilobytes per second written, like VideoEncoder::getStreamRate()
+  int queue_depth() { return queue.depth(); }; ///< chunks waiting
+  uint64_t bytes_written; ///< bytes delivered in total
+  uint64_t bytes_dropped; ///< bytes lost to a full queue or to latency
+  uint32_t errors; ///< failed writes
+  uint32_t reconnects; ///< times the destination was opened again
+
+ protected:
+  virtual bool _open() = 0; ///< open the destination
+  virtual int _write(const char *buf, int len) = 0; ///< bytes written, -1 on error
+  virtual void _close() = 0; ///< close the destination
+  virtual bool _reopen() { _close(); return _open(); }; ///< after a failed write
+
+ private:
+  struct chunk_t {
+    char *data;
+    int len;
+    int size; ///< allocated
+    uint64_t time; ///< when it was queued
+  };
+  chunk_t pool[SINK_QUEUE_SIZE];
+  BoundedQueue queue; ///< chunks to write
+  BoundedQueue free_chunks;
+
+  char *headers;
+  int headers_len;
+  bool write_headers();
+  bool retry(); ///< reopen until it works or the sink is closed
+  void drop(int bytes) { __sync_fetch_and_add(&bytes_dropped, bytes); };
+
+  pthread_t thread;
+  volatile bool running;
+  volatile bool quit;
+  static void *_run(void *arg);
+  void run();
+
+  struct timeval rate_time;
+  uint64_t rate_bytes;
+  double rate;
+};
+
+/// records to a file
+class FileSink : public EncoderSink {
+ public:
+  FileSink(const char *path);
+  ~FileSink();
+ protected:
+  bool _open();
+  int _write(const char *buf, int len);
+  void _close();
+ private:
+  char path[512];
+  FILE *fd;
+};
+
+/// feeds a command through a pipe to its standard input
+class PipeSink : public EncoderSink {
+ public:
+  PipeSink(const char *command);
+  ~PipeSink();
+ protected:
+  bool _open();
+  int _write(const char *buf, int len);
+  void _close();
+ private:
+  char command[512];
+  FILE *fd;
+};
+
+/**
+   Streams to an Icecast mount, either on a connection of its own or
+   on one opened and closed by someone else, as the one of the encoder
+*/
+class ShoutSink : public EncoderSink {
+ public:
+  ShoutSink(); ///< connection of its own, set up on ice before start()
+  ShoutSink(shout_t *shared); ///< connection opened by the caller
+  ~ShoutSink();
+
+  shout_t *ice;
+ protected:
+  bool _open();
+  int _write(const char *buf, int len);
+  void _close();
+  bool _reopen(); ///< also the connection of someone else
+ private:
+  bool owned;
+};
+
+#endif
@@ -34,6 +34,10 @@
 
 void find_best_memcpy();
 
+/// name and function of the nth memory copy method usable on this
+/// cpu, NULL when n is past the last one (used by benchmarks)
+const char *get_memcpy_method(int n, void *(**fun)( void *to, const void *from, size_t len ));
+
 extern void *(*jmemcpy)( void *to, const void *from, size_t len );
 
 static inline void *jmemmove( void *to, const void *from, size_t len )
@@ -65,6 +65,13 @@ class Filter : public Entry {
   virtual char *get_parameter_description(int i);
 
   virtual int type()=0;
+
+  /**
+     True if the filter processes a frame where it lies, then the
+     layer hands it the same buffer as input and output and spares
+     a copy.
+  */
+  virtual bool inplace() { return false; };
     
   bool initialized;
   bool active;
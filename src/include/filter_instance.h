@@ -27,6 +27,7 @@
 #include <linklist.h>
 #include <stdint.h>
 #include <factory.h>
+#include <frame_stats.h>
 
 class Filter;
 
@@ -40,6 +41,7 @@ class FilterInstance : public Entry {
 
   virtual void init(Filter *fr);
   virtual uint32_t *process(float fps, uint32_t *inframe);
+  uint32_t *process(float fps, uint32_t *inframe, uint32_t *out); ///< process into a buffer of the caller
 
   virtual bool set_parameter(int idx); ///< apply the parameter value
   virtual bool get_parameter(int idx); ///< get the parameter value
@@ -59,8 +61,12 @@ class FilterInstance : public Entry {
     
   uint32_t *outframe;
 
+  void *slices; ///< instances of the filter run in bands, if it is
+
   Linklist<Parameter> parameters;
 
+  FrameStats process_stats; ///< time spent in process()
+
  protected:
   void set_layer(Layer *lay);
 
@@ -24,6 +24,25 @@
 // #include <pthread.h>
 #include <inttypes.h>
 
+/**
+   FPS paces the loop of a thread on the ticks of a monotonic clock
+   shared by all threads: the ticks of a rate are the multiples of its
+   period counted from the same epoch, so threads running at the same
+   rate wake up together and never drift apart. Each thread sleeps
+   until the absolute time of its next tick, so that the time spent
+   working in the loop doesn't accumulate errors.
+
+   A frame ending after its tick is counted as late, and the ticks
+   which passed meanwhile are skipped and counted as missed, instead
+   of running the loop in a burst to catch up.
+
+   For offline rendering the shared clock can be turned into a
+   virtual one, which only moves forward by advance(): delay() then
+   returns at once, so frames are rendered as fast as possible while
+   every thread still sees the time of the frame being rendered.
+
+   @brief Frame rate scheduler on a shared monotonic clock
+*/
 class FPS {
  public:
   FPS();
@@ -31,14 +50,27 @@ class FPS {
 
   void init(double rate);
 
-  float get();
+  float get(); ///< measured frames per second, averaged
   double set(double rate);
-  void calc();
-  void delay();
+  void calc(); ///< account the end of a frame
+  void delay(); ///< sleep until the next tick
   void select_sleep(long usec);
 
   double fps, fps_old;
 
+  uint32_t late; ///< frames which ended after their tick
+  uint32_t missed; ///< ticks skipped because frames were late
+
+  static uint32_t total_late; ///< late frames of all threads
+  static uint32_t total_missed; ///< missed ticks of all threads
+
+  static uint64_t now(); ///< nanoseconds since the epoch of the shared clock
+  static uint64_t wall(); ///< nanoseconds since the epoch, never virtual
+
+  static void set_virtual(bool on); ///< switch the shared clock to virtual time
+  static bool is_virtual();
+  static void advance(uint64_t ns); ///< move the virtual clock forward
+
  private:
 
   struct fps_data_t {
@@ -48,12 +80,10 @@ class FPS {
     float *data;
   } fpsd;
 
-  struct timespec wake_ts;  
-  double _fps, _passes, _ratio;
-  struct timeval start_tv, m_OldTime, m_OrgTime;
-  long int _period;
-  bool m_OrgSets;
+  uint64_t period; ///< nanoseconds between ticks
+  uint64_t tick; ///< time of the next tick
+  uint64_t last; ///< end of the previous frame
+  bool done; ///< calc() was called for the current frame
 };
 
 #endif
-
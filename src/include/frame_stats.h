@@ -0,0 +1,89 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+   @file frame_stats.h
+   @brief Timing of the stages of the frame pipeline
+*/
+
+#ifndef __FRAME_STATS_H__
+#define __FRAME_STATS_H__
+
+#include <inttypes.h>
+
+#include <linklist.h>
+#include <fps.h>
+
+/// number of durations kept for each stage
+#define FRAME_STATS_SIZE 128
+
+/**
+   FrameStats records how long a stage of the frame pipeline takes on
+   each frame, for instance the feed() of a layer, the process() of a
+   filter or the show() of a screen.
+
+   Each stage is timed by one thread only, which writes the durations
+   in a ring without locking; summaries can be read at any time from
+   another thread, all stages are listed in FrameStats::stages().
+
+   @brief Per-stage frame timing
+*/
+class FrameStats : public Entry {
+ public:
+  FrameStats();
+  ~FrameStats();
+
+  /**
+     Register the stage for an object
+     @param owner object timed, its name is used in the stage name
+     @param stage name of the stage, a static string
+  */
+  void init(Entry *owner, const char *stage);
+  void set_parent(Entry *p) { parent = p; }; ///< prefix the stage name with p
+
+  void start() { begin = FPS::wall(); }; ///< the stage begins
+  void stop() { record(FPS::wall() - begin); }; ///< the stage ends
+  void record(uint64_t ns); ///< add a duration
+
+  /// summary of the durations in the ring, in milliseconds
+  struct summary_t {
+    uint32_t frames; ///< durations summarized
+    float min;
+    float avg;
+    float p99;
+    float max;
+  };
+  bool summary(summary_t *s); ///< false if nothing was recorded yet
+
+  void get_name(char *dst, int len); ///< full name as parent/owner/stage
+
+  static Linklist<FrameStats> &stages(); ///< all registered stages
+  static void report(); ///< print the summaries of all stages
+
+ private:
+  Entry *owner;
+  Entry *parent;
+  const char *stage;
+
+  uint64_t begin;
+  float ring[FRAME_STATS_SIZE];
+  volatile uint32_t count; ///< durations ever recorded
+};
+
+#endif
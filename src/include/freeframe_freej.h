@@ -24,6 +24,7 @@
 #include <freeframe.h>
 #include <filter.h>
 #include <factory.h>
+#include <plugin_cache.h>
 
 class Filter;
 
@@ -42,6 +43,14 @@ class Freeframe: public Filter {
 
   int open(char *file);
 
+  /**
+     Take the plugin from an entry of the registry instead of opening
+     it: its library is opened by load() when the plugin is used.
+  */
+  void defer(const char *file, plugin_entry_t *e);
+  bool load(); ///< open the library of a deferred plugin, false if it can't
+  void describe(plugin_entry_t *e); ///< fill the registry entry of the plugin
+
   const char *description();
   const char *author();
 
@@ -55,16 +64,22 @@ class Freeframe: public Filter {
 
   VideoInfoStruct vidinfo;
 
-  bool opened;
+  bool opened; ///< the plugin is known, its library may not be open yet
 
  protected:
   void destruct(FilterInstance *inst);
   void update(FilterInstance *inst, double time, uint32_t *inframe, uint32_t *outframe);
+  bool inplace() { return true; }; ///< FF_PROCESSFRAME works on the frame it gets
   void init_parameters(Linklist<Parameter> &parameters);
   // Interface function pointers.
   plugMainType *plugmain;
 
   private:
+    bool open_library(const char *file);
+    void initialise(); ///< FF_INITIALISE the plugin opened
+
+    PlugInfoStruct cached_info; ///< info taken from the registry
+
     // dlopen handle
     void *handle;
     // full .so file path
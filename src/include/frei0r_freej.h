@@ -26,10 +26,28 @@
 #include <vector>
 
 #include <linklist.h>
+#include <worker_pool.h>
 #include <frei0r.h>
 #include <filter.h>
 #include <factory.h>
+#include <plugin_cache.h>
 
+/// bands a filter is split in at most
+#define FREI0R_MAX_SLICES 16
+
+/**
+   Frei0r filters run with f0r_update() on the whole frame, in the
+   thread of their layer. Filters which only look at the pixel they
+   write, or at a few rows around it, are instead split in horizontal
+   bands with an instance of the plugin each, run in parallel on a
+   pool shared by all layers. Frei0r doesn't tell which filters can be
+   split: known ones are listed in frei0r.cpp, the others stay whole.
+
+   Mixers of two frames are not filters: they are offered by the
+   screens as blits of the layer on what lies below it.
+
+   @brief Frei0r plugin
+*/
 class Freior: public Filter {
   friend class GenF0rLayer;
 #ifdef WITH_COCOA
@@ -42,6 +60,14 @@ class Freior: public Filter {
 
   int type();
   int open(char *file);
+
+  /**
+     Take the plugin from an entry of the registry instead of opening
+     it: its library is opened by load() when the plugin is used.
+  */
+  void defer(const char *file, plugin_entry_t *e);
+  bool load(); ///< open the library of a deferred plugin, false if it can't
+  void describe(plugin_entry_t *e); ///< fill the registry entry of the plugin
   bool apply(Layer *lay, FilterInstance *instance);
   const char *description();
   const char *author();
@@ -51,7 +77,7 @@ class Freior: public Filter {
 
   f0r_plugin_info_t info;
 
-  bool opened;
+  bool opened; ///< the plugin is known, its library may not be open yet
 
   // parameter map
   std::vector<f0r_param_info_t> param_infos;
@@ -60,6 +86,18 @@ class Freior: public Filter {
 
   f0r_instance_t (*f0r_construct)(unsigned int width, unsigned int height);
 
+  /// rows around a band the filter looks at, -1 if it needs the whole frame
+  int slice_halo;
+  static bool slices; ///< split filters in bands when possible, default true
+
+  static Linklist<Filter> mixers; ///< MIXER2 plugins found, made blits by the screens
+
+  /// (re)construct the instance of a mixer for frames of w x h pixels
+  bool construct(FilterInstance *inst, unsigned int w, unsigned int h);
+  /// mix in2 over in1 with a MIXER2 plugin, out can be in1
+  void mix(FilterInstance *inst, double time,
+	   const uint32_t *in1, const uint32_t *in2, uint32_t *out);
+
  protected:
   void destruct(FilterInstance *inst);
   void update(FilterInstance *inst, double time, uint32_t *inframe, uint32_t *outframe);
@@ -77,6 +115,18 @@ class Freior: public Filter {
   
   void init_parameters(Linklist<Parameter> &parameters);  
   private:
+
+    bool open_library(const char *file);
+    void named(); ///< name the filter after the plugin info
+
+    // strings of the info and parameters taken from the registry
+    std::string info_strings[3];
+    std::vector<std::string> param_strings;
+
+    static WorkerPool *slice_pool;
+    static void slice_job(void *arg, int idx);
+    bool apply_slices(Layer *lay, FilterInstance *instance);
+    void destruct_slices(FilterInstance *inst);
     
     // dlopen handle
     void *handle;
@@ -34,7 +34,6 @@ class GeneratorLayer: public Layer {
 
   void register_generators(Linklist<Filter> *gens);
 
-  void *swap_buffer;
   FilterInstance *generator;
 
  protected:
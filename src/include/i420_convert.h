@@ -0,0 +1,80 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+   @file i420_convert.h
+   @brief Single pass conversion of screen frames to planar yuv 4:2:0
+*/
+
+#ifndef __I420_CONVERT_H__
+#define __I420_CONVERT_H__
+
+#include <inttypes.h>
+
+#include <screen.h>
+
+class WorkerPool;
+
+/**
+   I420Convert turns a 32 bit RGBA, BGRA or ARGB frame straight into
+   the three planes of yuv 4:2:0, reading each pixel once. It gives
+   the same values as mlt_convert_*_to_yuv422() followed by
+   ccvt_yuyv_420p(): the RGB2YUV scaling of convertvid.h, chroma
+   averaged on pairs of pixels and then on pairs of rows.
+
+   Pairs of rows are split in bands among the threads of a WorkerPool,
+   rows are converted with SSE2 when the cpu has it.
+
+   @brief RGB to I420 converter
+*/
+class I420Convert {
+ public:
+  I420Convert();
+  I420Convert(uint32_t accel); ///< using only the MM_ACCEL_* given, 0 for plain C
+  ~I420Convert();
+
+  /** Select the pixel format of the source, false if unsupported */
+  bool set_format(ViewPort::fourcc format);
+
+  /**
+     Convert a frame, the width and height are rounded down to even
+     @param src frame of w * h pixels, rows are stride bytes apart
+     @param y luma plane of w * h bytes
+     @param u chroma plane of w/2 * h/2 bytes
+     @param v chroma plane of w/2 * h/2 bytes
+     @param pool threads to share the work with, NULL to run here
+  */
+  void convert(const uint8_t *src, int w, int h, int stride,
+	       uint8_t *y, uint8_t *u, uint8_t *v, WorkerPool *pool);
+
+ private:
+  // byte offset of each channel in a pixel
+  int ri, gi, bi;
+  bool sse2;
+  void init(uint32_t accel);
+
+  // state of the current threaded run
+  const uint8_t *job_src;
+  int job_w, job_h, job_stride;
+  uint8_t *job_y, *job_u, *job_v;
+  int jobs;
+  static void convert_job(void *arg, int idx);
+};
+
+#endif
@@ -0,0 +1,92 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+   @file i420_scale.h
+   @brief Downscaling of planar yuv 4:2:0 frames
+*/
+
+#ifndef __I420_SCALE_H__
+#define __I420_SCALE_H__
+
+#include <inttypes.h>
+
+class WorkerPool;
+
+/**
+   I420Scale resizes the three planes of a yuv 4:2:0 frame with a
+   bilinear filter in fixed point: each destination row is first
+   blended from the two source rows around it, then sampled along
+   the row. The blending of rows is done with SSE2 when the cpu has
+   it, sixteen samples at a time.
+
+   Bilinear filtering only looks at two rows and two columns, so it
+   is meant to shrink at most by half: smaller sizes are made from
+   an intermediate one, as the renditions of a VideoEncoder do.
+
+   Rows are split in bands among the threads of a WorkerPool, one
+   scaler can be shared by frames of different sizes but not by two
+   threads at once.
+
+   @brief Bilinear I420 scaler
+*/
+class I420Scale {
+ public:
+  I420Scale();
+  I420Scale(uint32_t accel); ///< using only the MM_ACCEL_* given, 0 for plain C
+  ~I420Scale();
+
+  /**
+     Scale a frame, all sizes are even and planes are packed
+     @param sy luma plane of sw * sh bytes, su and sv of sw/2 * sh/2
+     @param dy luma plane of dw * dh bytes, du and dv of dw/2 * dh/2
+     @param pool threads to share the work with, NULL to run here
+  */
+  void scale(const uint8_t *sy, const uint8_t *su, const uint8_t *sv, int sw, int sh,
+	     uint8_t *dy, uint8_t *du, uint8_t *dv, int dw, int dh,
+	     WorkerPool *pool);
+
+ private:
+  bool sse2;
+  void init(uint32_t accel);
+
+  /// where each destination sample is taken from, along one axis
+  struct axis_t {
+    int *pos; ///< first source sample
+    uint8_t *frac; ///< weight of the next one, out of 128
+    int src, dst; ///< sizes the table is made for
+    int size; ///< allocated
+  };
+  axis_t axis[4]; ///< luma x, luma y, chroma x, chroma y
+  void setup(axis_t *a, int src, int dst);
+
+  uint8_t *rows; ///< a blended row for each job
+  int row_size;
+  int rows_alloc;
+
+  // state of the current threaded run
+  const uint8_t *job_src[3];
+  uint8_t *job_dst[3];
+  int job_sw, job_sh, job_dw, job_dh;
+  int jobs;
+  static void scale_job(void *arg, int idx);
+  void scale_band(int p, int idx);
+};
+
+#endif
@@ -24,6 +24,7 @@
 
 #include <sdl_screen.h>
 #include <soft_screen.h>
+#include <yuv_screen.h>
 
 #ifdef WITH_OPENGL
 #include <sdlgl_screen.h>
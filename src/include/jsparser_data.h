@@ -286,6 +286,17 @@ JS(execute_javascript_command);
 JS(ExecScript); // for the use() objects
 JS(system_exec);
 JS(list_filters);
+JS(frame_stats);
+JS(frame_deadlines);
+JS(render_offline);
+JS(clip_cache);
+JS(buffer_stats);
+JS(automation_stop);
+JS(automation_stats);
+#ifdef WITH_FFMPEG
+JS(decode_budget);
+JS(keyframe_index);
+#endif
 JS(js_gc);
 JS(reset_js);
 
@@ -312,6 +323,8 @@ JS(screen_init);
 JS(screen_add_layer);
 JS(screen_rem_layer);
 JS(screen_save_frame);
+JS(screen_set_compositor);
+JSP(screen_band_times);
 JSP(screen_get_width);
 JSP(screen_get_height);
 JSP(screen_initialized);
@@ -327,6 +340,7 @@ JSP(parameter_get_type);
 // Filter methods
 //JS(filter_apply);
 JS(filter_set_parameter);
+JS(filter_automate);
 JS(filter_activate);
 JSP(filter_list_parameters);
 JSP(filter_get_description);
@@ -361,6 +375,8 @@ JS(layer_rem_filter);
 JS(layer_rotate);
 JS(layer_zoom);
 JS(layer_fit);
+JS(layer_chain_stats);
+JS(layer_automate);
 /// layer properties
 JSP(layer_get_x);
 JSP(layer_set_x);
@@ -491,6 +507,11 @@ JS(video_layer_rewind);
 JS(video_layer_mark_in);
 JS(video_layer_mark_out);
 JS(video_layer_pause);
+JS(video_layer_queue_stats);
+JS(video_layer_decode_threads);
+JS(video_layer_cache);
+JS(video_layer_speed);
+JS(video_layer_fast_seek);
 #endif
 
 #if defined WITH_TEXTLAYER
@@ -516,6 +537,18 @@ JS(txt_layer_calculate_size);
 JS(vid_enc_start_filesave);
 JS(vid_enc_stop_filesave);
 JS(vid_enc_add_audio);
+JS(vid_enc_drop_policy);
+JS(vid_enc_duplicate_frames);
+JS(vid_enc_dropped_frames);
+JS(vid_enc_add_sink);
+JS(vid_enc_remove_sink);
+JS(vid_enc_sink_rate);
+JS(vid_enc_sink_queue);
+JS(vid_enc_sink_dropped);
+JS(vid_enc_sink_policy);
+JS(vid_enc_sink_latency);
+JS(vid_enc_stream_rate);
+JS(vid_enc_add_rendition);
 // Shouter methods
 JS(start_stream);
 JS(stop_stream);
@@ -51,6 +51,7 @@ class JSyncThread {
 
   int start();
   void stop();
+  void step(); ///< run one pass of the loop in the caller, when not running
   virtual void thread_setup() {};
   virtual void thread_loop() {};
   virtual void thread_teardown() {};
@@ -0,0 +1,99 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+   @file keyframe_index.h
+   @brief Index of the keyframes of a movie for fast seeking
+*/
+
+#ifndef __KEYFRAME_INDEX_H__
+#define __KEYFRAME_INDEX_H__
+
+#include <inttypes.h>
+#include <pthread.h>
+
+/// suffix of the index saved next to the movie
+#define KEYFRAME_INDEX_SUFFIX ".fjidx"
+
+/**
+   KeyframeIndex lists the keyframes of the video stream of a movie
+   with their timestamp and byte position, so that a seek can jump
+   straight to the keyframe preceding any time.
+
+   The index is built by a thread reading the packets of the movie
+   on its own, without decoding; it can be used while it grows. It
+   is loaded from and saved next to the movie when persist is set.
+   Only local files are worth indexing: on a network stream the
+   second reader doubles the traffic, and a live one never ends.
+
+   @brief Keyframe index of a movie
+*/
+class KeyframeIndex {
+ public:
+  KeyframeIndex();
+  ~KeyframeIndex();
+
+  struct keyframe_t {
+    int64_t ts; ///< timestamp in the time base of the stream
+    int64_t pos; ///< byte position in the file, -1 if unknown
+    double time; ///< seconds from the start of the stream
+  };
+
+  /**
+     Index the video stream of a movie in the background
+     @param file path of the movie, loaded from its index if saved
+     @param stream number of the video stream in the movie
+     @param start first timestamp of the stream, time 0
+     @param time_base seconds per timestamp unit
+  */
+  void build(const char *file, int stream, int64_t start, double time_base);
+  void close(); ///< stop building and forget the index
+
+  /** The last keyframe at or before time t, false if not indexed yet */
+  bool find(double t, keyframe_t *k);
+
+  int count() { return length; }; ///< keyframes indexed
+  bool is_complete() { return complete; }; ///< the whole movie is indexed
+
+  static bool persist; ///< load and save indexes next to the movies
+
+ private:
+  char filename[512];
+  int stream;
+  int64_t start;
+  double time_base;
+
+  keyframe_t *keys;
+  int length;
+  int capacity;
+  bool add(int64_t ts, int64_t pos, double time); ///< false if out of memory
+
+  bool load();
+  bool save();
+
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  volatile bool running;
+  volatile bool quit;
+  volatile bool complete;
+  static void *_run(void *arg);
+  void scan();
+};
+
+#endif
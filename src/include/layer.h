@@ -30,6 +30,8 @@
 #include <filter.h>
 #include <screen.h>
 #include <jsync.h>
+#include <triple_buffer.h>
+#include <frame_stats.h>
 
 
 class Context;
@@ -206,6 +208,26 @@ class Layer: public Entry, public JSyncThread {
 
   /** physical buffers */
   void *buffer; ///< RGBA pixel buffer returned by the layer
+  bool buffer_yuv420; ///< buffer holds planar yuv 4:2:0 instead of RGBA
+
+  /**
+     Ask the layer to feed planar yuv 4:2:0 frames (see
+     ViewPort::YUV420) rather than RGBA, called when it is added to a
+     screen compositing in yuv. False if the layer can't, then its
+     RGBA frames are converted by the screen. Frames are told apart
+     by their size, so a layer can switch in its own time.
+  */
+  virtual bool set_yuv420(bool on) { return !on; };
+  uint32_t yuv420_size() { return geo.w * geo.h + (geo.w >> 1) * (geo.h >> 1) * 2; };
+
+  TripleBuffer frames; ///< frames handed over from the layer thread to the screen
+
+  FrameStats feed_stats; ///< time spent in feed()
+  FrameStats blit_stats; ///< time spent blitting the layer on the screen
+
+  int chain_buffers; ///< ping-pong buffers allocated for the filter chain
+  uint32_t chain_copied; ///< bytes copied between buffers on the last frame
+  void *acquire_frame(); ///< point buffer to the newest frame, called by the screen
 
 
   void *js_constructor(Context *env, JSContext *cx,
@@ -228,6 +250,9 @@ class Layer: public Entry, public JSyncThread {
   void set_filename(const char *f);
   char filename[256];
 
+  void *frame_slot(); ///< buffer where feed() can render the next frame without copies, sized before feed()
+  bool feed_yuv420; ///< set by feed() when it returns a yuv 4:2:0 frame
+
 
   bool is_native_sdl_surface;
   void *priv_data; // pointer to private data eventually associated to this layer
@@ -241,6 +266,15 @@ class Layer: public Entry, public JSyncThread {
 
   char alphastr[5];
 
+  /** filters write in turn to these, the last one to the frame slot */
+  void *pingpong[2];
+  uint32_t pingpong_size;
+  void *chain_buffer(void *cur); ///< the ping-pong buffer not holding cur
+
+  /** back slot of the frames, resized only before feed() */
+  void *feed_slot;
+  uint32_t feed_slot_size;
+
   void thread_setup();
   void thread_loop();
   void thread_teardown();
@@ -79,6 +79,13 @@ private:
   int encode_video(int end_of_stream);
   int encode_audio(int end_of_stream, size_t sizeInBuff);
 
+  // audio is encoded by a thread of its own into the same muxer
+  pthread_t audio_thread;
+  volatile bool audio_running;
+  volatile bool audio_quit;
+  static void *audio_run(void *arg);
+  bool encode_audio_chunk(); ///< false if not enough audio was collected
+
   // void *enc_rgb24;
 
   /* video size */
@@ -87,6 +94,7 @@ private:
   /* offsets for theora size constraints */
   int frame_x_offset; 
   int frame_y_offset;
+  uint8_t *padded; ///< frame of the theora size, when it differs
 
 
   unsigned char *yuvframe[2]; /* yuv 420 */
@@ -58,6 +58,8 @@ class OscController: public Controller {
   bool start(int port);
   void stop();
 
+  int send_stats(const char *prefix); ///< send frame timings to the send_to address
+
   Context *freej;
 
   lo_server_thread srv;
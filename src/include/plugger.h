@@ -27,10 +27,13 @@
 
 #include <jutils.h>
 #include <filter.h>
+#include <plugin_cache.h>
 
 template <class T> class Linklist;
 
 class Context;
+class Freior;
+class Freeframe;
 
 /**
    This class implements the object storing all available filter
@@ -40,6 +43,10 @@ class Context;
    valid plugins and creates instances of them which are ready to be
    returned upon request to the host application of FreeJ controllers.
 
+   What is found is kept in ~/.freej/plugins.cache (see PluginCache):
+   plugins unchanged since are registered from there, and their
+   libraries are opened only when they are used.
+
    @brief Collects DLO plugins that can be used as Effect or Layer
 */
 class Plugger {
@@ -62,6 +69,13 @@ class Plugger {
 
   bool open(Context *env, char *file);
 
+  /// register a plugin known by the registry, without opening it
+  void place(Context *env, const char *file, plugin_entry_t *e);
+  bool place_frei0r(Context *env, Freior *fr);
+  bool place_freeframe(Context *env, Freeframe *fr);
+
+  PluginCache cache;
+
   /* checks if file/directory exist */
   void addsearchdir(const char *dir);
   void _setsearchpath(const char *path) {
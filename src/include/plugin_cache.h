@@ -0,0 +1,107 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+   @file plugin_cache.h
+   @brief Registry of the plugins found, kept on disk between runs
+*/
+
+#ifndef __PLUGIN_CACHE_H__
+#define __PLUGIN_CACHE_H__
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/// bumped when the format of the registry changes, older ones are discarded
+#define PLUGIN_CACHE_VERSION 1
+
+/// what a file was found to be
+enum plugin_kind_t {
+  PLUGIN_NONE = 0, ///< not a plugin, not to be opened again
+  PLUGIN_FREI0R = 1,
+  PLUGIN_FREEFRAME = 2
+};
+
+/// a parameter of a plugin
+struct plugin_param_t {
+  std::string name;
+  std::string explanation;
+  int type;
+};
+
+/// what is known of a plugin file without opening it
+struct plugin_entry_t {
+  time_t mtime; ///< the entry is valid while the file keeps
+  off_t size;   ///< its modification time and size
+  int kind; ///< a plugin_kind_t
+  int type; ///< type of plugin as told by it (filter, source, mixer...)
+  std::string name;
+  std::string author;
+  std::string explanation;
+  int version[4]; ///< api version, major and minor version, color model
+  std::vector<plugin_param_t> params;
+  bool seen; ///< found in the search path on the last refresh
+};
+
+/**
+   The plugger opens every library found in the search path to know
+   whether it is a plugin, of which kind and with which parameters:
+   with hundreds of plugins installed that is seconds of startup and
+   every library mapped in memory. This registry keeps what was found
+   for each file, keyed by its path, modification time and size, so
+   that the next starts read it instead of opening the libraries: the
+   plugins are then opened only when they are used.
+
+   The registry is a text file, one line per plugin followed by one
+   per parameter, written back only when something changed.
+
+   @brief Plugin metadata kept on disk
+*/
+class PluginCache {
+ public:
+  PluginCache();
+  ~PluginCache();
+
+  /** Read the registry, entries of unchanged files are then found by find()
+      @return false if there is none or it is of an older version */
+  bool load(const char *file);
+
+  /** Write back the registry if entries were added or files are gone */
+  bool save();
+
+  /** @return the entry of the file if it didn't change since, else NULL */
+  plugin_entry_t *find(const char *path, struct stat *st);
+
+  /** @return a new entry of kind PLUGIN_NONE for the file, replacing the old one */
+  plugin_entry_t *add(const char *path, struct stat *st);
+
+  int hits; ///< files found in the registry on the last refresh
+  int misses; ///< files opened to know what they are
+
+ private:
+  std::map<std::string, plugin_entry_t> entries;
+  std::string filename;
+  bool changed;
+};
+
+#endif
@@ -0,0 +1,101 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+   @file rotozoom.h
+   @brief Threaded rotation and zoom of layer frames
+*/
+
+#ifndef __ROTOZOOM_H__
+#define __ROTOZOOM_H__
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+class Layer;
+class Blit;
+class WorkerPool;
+
+/**
+   RotoZoom samples a layer frame rotated by Layer::rotate degrees and
+   zoomed by Layer::zoom_x and Layer::zoom_y, with the same orientation
+   and bounds of sdl_gfx rotozoomSurface(). Sampling is done in 16.16
+   fixed point, nearest or bilinear when Layer::antialias is set.
+
+   Linear blits are folded in the sampling: each row of the rotated
+   frame is sampled in a small scratch line and blitted on the screen
+   right away, so no intermediate frame is written. Blits needing a
+   whole surface (SDL) are rendered in a buffer which is kept and
+   reused as long as the bounds do not grow.
+
+   Rows are split among the threads of a WorkerPool.
+
+   @brief Rotozoom engine for a layer
+*/
+class RotoZoom {
+ public:
+  RotoZoom();
+  ~RotoZoom();
+
+  /**
+     Prepare the transform for the current frame of the layer and set
+     Layer::geo_rotozoom to the rotated bounds
+     @return true if the bounds changed since the last frame
+  */
+  bool setup(Layer *lay);
+
+  /** Sample len pixels of the rotated row y starting at column x */
+  void sample_row(uint32_t *dst, int x, int y, int len);
+
+  /** Render the whole rotated frame, returns a buffer of w * h pixels */
+  void *render(WorkerPool *pool);
+
+  /** Blit the rotated frame on a surface with a cropped LINEAR blit */
+  void blit(Blit *b, void *surface, WorkerPool *pool);
+
+  int w; ///< width of the rotated bounds
+  int h; ///< height of the rotated bounds
+
+ private:
+  uint32_t *src; ///< source frame
+  int src_w;
+  int src_h;
+  bool smooth;
+
+  // source position in 16.16 fixed point: (u0,v0) for the first
+  // pixel, moving by (du_x,dv_x) on each column and (du_y,dv_y) on each row
+  int32_t u0, v0;
+  int32_t du_x, dv_x;
+  int32_t du_y, dv_y;
+
+  uint32_t *buffer; ///< rendered frame for SDL blits
+  size_t buffer_size;
+  uint32_t *scratch; ///< one line per job for folded blits
+  size_t scratch_size;
+
+  // state of the current threaded run
+  int jobs;
+  Blit *job_blit;
+  uint32_t *job_surface;
+  int prepare_jobs(WorkerPool *pool, int line);
+  static void render_job(void *arg, int idx);
+  static void blit_job(void *arg, int idx);
+};
+
+#endif
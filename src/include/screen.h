@@ -36,6 +36,7 @@
 
 #include <layer.h>
 #include <blitter.h>
+#include <frame_stats.h>
 
 
 template <class T> class Linklist;
@@ -80,6 +81,7 @@ class JackClient;
 class Layer;
 class Geometry;
 class VideoEncoder;
+class WorkerPool;
 
 /**
    This class provides a generic interface common to all different
@@ -99,7 +101,12 @@ class ViewPort : public Entry {
 
   bool initialized;
 
-  enum fourcc { RGBA32, BGRA32, ARGB32 }; ///< pixel formats understood
+  /**
+     Pixel formats understood: 32 bit packed RGB, or YUV420 as planar
+     yuv 4:2:0 in a single buffer, the Y plane followed by the U and V
+     planes at half width and height
+  */
+  enum fourcc { RGBA32, BGRA32, ARGB32, YUV420 };
   virtual fourcc get_pixel_format() =0; ///< return the pixel format
 
   virtual void *get_surface() =0; ///< returns direct pointer to video memory
@@ -113,6 +120,30 @@ class ViewPort : public Entry {
 
   void blit_layers();
 
+  /**
+     Compositing modes: SERIAL blits one layer after the other on the
+     whole surface, FUSED walks all the layers on a tile of rows at a
+     time so that the screen tile stays in cache while it is blended,
+     BANDS splits the surface in horizontal bands composited in
+     parallel by a pool of threads, each band fused in tiles as well.
+  */
+  enum compositor_t { SERIAL, FUSED, BANDS };
+
+  /**
+     Select how layers are composited on this screen
+     @param mode SERIAL, FUSED or BANDS
+     @param threads number of threads for BANDS (0 = one per cpu)
+  */
+  bool set_compositor(compositor_t mode, int threads = 0);
+  compositor_t get_compositor() { return compositor; };
+
+  int bands; ///< number of horizontal bands (1 for FUSED)
+  float *band_ms; ///< milliseconds spent on each band during last frame
+  int tile_bytes; ///< size of the screen tile blended by FUSED and BANDS
+
+  FrameStats show_stats; ///< time spent in show()
+  FrameStats composite_stats; ///< time spent compositing layers in FUSED and BANDS
+
   virtual bool add_layer(Layer *lay); ///< add a new layer to the screen
 #ifdef WITH_AUDIO
   virtual bool add_audio(JackClient *jcl); ///< connect layer to audio output
@@ -159,6 +190,22 @@ class ViewPort : public Entry {
  protected:
   virtual bool _init() = 0; ///< implemented initialization
 
+  virtual bool band_blittable(Layer *lay); ///< true if the layer can be split in bands
+  void blit_band(Layer *lay, int y0, int y1, int band); ///< blit restricted to screen rows y0-y1
+
+  WorkerPool *pool; ///< compositor threads, NULL when compositing serially
+
+ private:
+  compositor_t compositor;
+
+  Layer **run_layers; ///< layers composited in the current parallel run
+  int run_len;
+  int run_size;
+  void flush_run(); ///< composite all layers queued in the run
+  void blit_rows(int y0, int y1, int band); ///< composite the queued run on rows y0-y1, tile by tile
+  bool band_mixer(Layer *lay); ///< prepare a mixer for the bands, false if it runs in one pass
+  static void band_job(void *arg, int band);
+
 };
 
 #endif
@@ -67,8 +67,7 @@ class SdlScreen : public ViewPort {
 
   SDL_Surface *sdl_dest;
 
-  SDL_Surface *pre_rotozoom;
-  SDL_Surface *rotozoom; ///< pointer to blittable surface (rotated and zoomed if necessary)
+  WorkerPool *roto_pool; ///< threads sampling rotated and zoomed layers, if no compositor pool
 
   // small vars used in blits
   int chan, c, cc;
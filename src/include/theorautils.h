@@ -33,6 +33,7 @@
 
 #include <ringbuffer.h>
 #include <time.h>
+#include <pthread.h>
 
 //#define OGGMUX_DEBUG 1
 
@@ -140,6 +141,14 @@ typedef struct
 
     int n_kate_streams;
     oggmux_kate_stream *kate_streams;
+
+    /* video and audio can be encoded by different threads: packets
+     * are added to the streams and pages taken out under this lock */
+    pthread_mutex_t lock;
+
+    /* resampled audio, grows to the largest chunk added */
+    float *resampled;
+    size_t resampled_size;
 }
 oggmux_info;
 
@@ -150,7 +159,7 @@ extern void oggmux_add_video (oggmux_info *info, yuv_buffer *yuv, int e_o_s);
 extern void oggmux_add_audio (oggmux_info *info, float * readbuffer, int bytesread, int samplesread,int e_o_s);
 extern void oggmux_add_kate_text (oggmux_info *info, int idx, double t0, double t1, const char *text, size_t len);
 extern void oggmux_add_kate_end_packet (oggmux_info *info, int idx, double t);
-extern void oggmux_flush (oggmux_info *info, int e_o_s);
+extern int oggmux_flush (oggmux_info *info, int e_o_s);
 extern void oggmux_close (oggmux_info *info);
 
 
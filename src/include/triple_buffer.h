@@ -0,0 +1,89 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+   @file triple_buffer.h
+   @brief Lock-free frame handoff between one producer and one consumer
+*/
+
+#ifndef __TRIPLE_BUFFER_H__
+#define __TRIPLE_BUFFER_H__
+
+#include <stdlib.h>
+#include <inttypes.h>
+
+/**
+   A TripleBuffer holds three frame slots: the producer owns the back
+   slot, the consumer owns the front slot and the third one is the
+   latest frame published and not yet taken. Publishing and taking a
+   frame are a single atomic exchange of slot indexes, so neither side
+   ever waits for the other: the producer can overwrite a frame which
+   was never displayed, while the consumer keeps reading its frame
+   until it asks for a newer one.
+
+   There must be only one producer thread and one consumer thread.
+
+   @brief Lock-free triple buffer for frames
+*/
+class TripleBuffer {
+ public:
+  TripleBuffer();
+  ~TripleBuffer();
+
+  /////// producer side
+
+  /**
+     Slot where the producer can render the next frame, resized to
+     the given bytes if needed. Rendering there and passing it to
+     publish() saves the copy.
+  */
+  void *back(size_t bytes);
+
+  /**
+     Publish a frame as the newest one: the frame is copied in the
+     back slot unless it is already the back slot. A frame rendered in
+     the back slot must fit the size it was given by back(), the slot
+     is never resized under it.
+  */
+  void publish(void *frame, size_t bytes);
+
+  /////// consumer side
+
+  /**
+     Newest complete frame: swaps in the last published one if there
+     is any, else returns the same frame as the previous call.
+     @param bytes size of the frame, set only if the pointer is not NULL
+     @return frame pointer, valid until the next call, or NULL
+  */
+  void *front(size_t *bytes = NULL);
+
+  uint32_t published; ///< frames published by the producer
+  uint32_t dropped; ///< frames overwritten before the consumer took them
+
+ private:
+  void *slot[3];
+  size_t slot_size[3]; ///< bytes used by the frame in each slot
+  size_t slot_alloc[3]; ///< bytes allocated for each slot
+
+  int back_idx; ///< owned by the producer
+  int front_idx; ///< owned by the consumer
+  volatile int middle; ///< published slot index, ored with FRESH when not yet taken
+};
+
+#endif
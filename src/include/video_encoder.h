@@ -34,6 +34,12 @@
 #include <screen.h>
 
 #include <ringbuffer.h>
+#include <frame_stats.h>
+#include <i420_convert.h>
+#include <i420_scale.h>
+#include <worker_pool.h>
+#include <bounded_queue.h>
+#include <encoder_sink.h>
 
 #include <shout/shout.h>
 
@@ -44,9 +50,27 @@ class AudioCollector;
 class FPS;
 class ViewPort;
 
+/// frames captured from the screen waiting to be encoded
+#define ENCODER_QUEUE_SIZE 8
+/// smaller encodings an encoder can make of its frames
+#define ENCODER_MAX_RENDITIONS 4
+
 /**
  * Abstract class describing the general interface of a VideoEncoder
  *
+ * The thread of the encoder captures the screen on the ticks of its
+ * FPS and queues the frames converted to yuv; a second thread takes
+ * them out of the queue, calls encode_frame() and writes out what was
+ * encoded, so that a slow encoding never holds back the capture.
+ * When the queue is full the frames are dropped following
+ * drop_policy, ticks missed by the capture can be filled repeating
+ * the last frame to keep the stream at its rate.
+ *
+ * An encoder can also feed renditions, other encoders making smaller
+ * versions of the same frames (see add_rendition()): the screen is
+ * captured once, scaled down and queued to each of them, all frames
+ * or none, so that every rendition encodes the same frames.
+ *
  * 
  * Method implemented are:
  *   - VideoEncoder::set_output_name()
@@ -75,13 +99,54 @@ class VideoEncoder: public Entry, public JSyncThread {
   virtual int encode_frame ()       = 0;  ///< pure virtual function to implement
 
   void thread_setup(); ///< setup data needed in encoding thread
-  void thread_loop(); ///< encoding thread main loop
+  void thread_loop(); ///< capture of the screen, main loop of the thread
   void thread_teardown(); ///< ending phase of encoding thread
 
+  /// what the capture does with a frame when the queue is full
+  enum drop_policy_t {
+    DROP_NEWEST, ///< skip the frame just captured (default)
+    DROP_OLDEST, ///< replace the oldest frame waiting in the queue
+    DROP_NONE ///< wait for the encoder, slowing down the capture
+  };
+  drop_policy_t drop_policy;
+  bool duplicate; ///< repeat the last frame for each tick the capture missed
+
+  uint32_t frames_captured; ///< frames queued by the capture
+  uint32_t frames_encoded; ///< frames passed to encode_frame()
+  uint32_t frames_dropped; ///< frames lost because the queue was full
+  uint32_t frames_duplicated; ///< frames repeated for missed ticks
+
   bool set_filedump(const char *filename); ///< start to dump to filename, call with NULL to stop
   bool filedump_close(); ///stops to dump in the file and close it
   char filedump[512]; ////< filename to which encoder is writing dump
 
+  bool start_stream(); ///< deliver to ice, opened by the caller
+  void stop_stream(); ///< stop delivering to ice, before closing it
+
+  /**
+     Deliver the encoded data also to sink, from now on: a frame is
+     encoded once for all the sinks, each writing on its own thread.
+     The sink is started here, and deleted by the encoder.
+  */
+  bool add_sink(EncoderSink *sink);
+  void rem_sink(EncoderSink *sink); ///< stop, close and delete sink
+  EncoderSink *get_sink(uint32_t id); ///< the sink with that id, NULL if removed
+  Linklist<EncoderSink> sinks; ///< files and streams written
+
+  /**
+     Make enc encode the frames of this encoder scaled to w x h, on
+     its own encoding thread and with its own settings and sinks.
+     The frames are scaled from the smallest larger one, the screen
+     is captured only by this encoder. This encoder must be added to
+     a screen first, enc is initialized here and deleted by this one.
+  */
+  bool add_rendition(VideoEncoder *enc, int w, int h);
+  VideoEncoder *master; ///< the encoder feeding this rendition, NULL if none
+  int num_renditions;
+
+  int enc_w; ///< size of the frames encoded, the screen one unless a rendition
+  int enc_h;
+
   char *status; ///< string updated with encoder status
 
   int video_quality; ///< quality of video encoding: range 0-100
@@ -112,20 +177,64 @@ class VideoEncoder: public Entry, public JSyncThread {
 
   FPS *fps;
 
-  shout_t *ice;
+  FrameStats convert_stats; ///< time spent converting the screen to yuv
+  FrameStats encode_stats; ///< time spent in encode_frame()
+
+  shout_t *ice; ///< stream set up by start_stream() and the shout calls
 
   ViewPort *screen;
 
-  void *enc_y;
+  void *enc_y; ///< planes of the frame encode_frame() is called on
   void *enc_u;
   void *enc_v;
-  void *enc_yuyv;
+
+  I420Convert converter; ///< screen to enc_y, enc_u and enc_v
+  WorkerPool convert_pool; ///< threads of the conversion and scaling
+  I420Scale scaler; ///< frames to the size of the renditions
+
+ protected:
+  void stop_encoding(); ///< encode the queued frames and end the thread
+  void keep_headers(); ///< what is encoded so far are the stream headers, for the sinks
+  void write_encoded(); ///< from the ringbuffer to file and stream, or discarded without sinks
 
  private:
-  FILE *filedump_fd;
+  struct enc_frame_t {
+    uint8_t *y, *u, *v;
+  };
+  enc_frame_t *frame_pool;
+  enc_frame_t *last; ///< queued last, repeated for the missed ticks
+  BoundedQueue frames; ///< captured, waiting to be encoded
+  BoundedQueue free_frames;
+  bool start_encoding();
+  enc_frame_t *get_frame();
+  bool capture(enc_frame_t *f);
+  VideoEncoder *renditions[ENCODER_MAX_RENDITIONS]; ///< from the largest
+  bool get_ladder(enc_frame_t **f, bool wait); ///< a free frame of each rendition, or none
+  void put_ladder(enc_frame_t **f, int n); ///< give the frames back unused
+  void drop_ladder(int n); ///< count n frames dropped by all
+  void scale_ladder(enc_frame_t **f); ///< the captured frame to the renditions
+  void queue_ladder(enc_frame_t **f, bool repeat); ///< to the encoding threads
+  uint32_t last_missed;
+
+  pthread_t encode_thread;
+  volatile bool encoding;
+  static void *encode_run(void *arg);
+  void encode_loop();
+
+  FileSink *file_sink; ///< the one of set_filedump()
+  ShoutSink *stream_sink; ///< the one of start_stream()
+  uint32_t last_sink_id;
+  void push_sinks(const char *buf, int len);
 //   char encbuf[1024*128];
 //   char encbuf[1024*2096];
   char *encbuf;
+  int encbuf_size;
+  int read_encoded(char **data); ///< whole pages from the ringbuffer, headers left out
+  char *headers; ///< stream headers, written first by every sink
+  int headers_len;
+  int headers_skip; ///< headers still to leave out from the ringbuffer
+  void *snapshot; ///< copy of the screen taken under its lock
+  size_t snapshot_size;
   struct timeval m_ActualTime, m_OldTime, m_lastTime;
   double m_StreamRate;
   int 	 m_Streamed;
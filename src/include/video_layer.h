@@ -51,9 +51,18 @@ extern "C" {
 #endif
 }
 #include <layer.h>
+#include <bounded_queue.h>
+#include <clip_cache.h>
+#include <keyframe_index.h>
 #define INBUF_SIZE 4096
 #define NO_MARK -1
-#define FIFO_SIZE 2
+
+/// demuxed video packets waiting for the decoder
+#define PACKET_QUEUE_SIZE 64
+/// converted frames ready ahead of presentation
+#define FRAME_QUEUE_SIZE 4
+/// frames queued, plus the one shown and the one being converted
+#define FIFO_SIZE (FRAME_QUEUE_SIZE + 2)
 
 #include <callback.h>
 
@@ -72,7 +81,14 @@ class VideoLayer: public Layer {
 	void *feed();
 	void close();
 
-	int64_t to_seek;
+	/** seek to microseconds from the start, done by the demux thread */
+	void seek_to(int64_t ts) { __sync_lock_test_and_set(&to_seek, ts); };
+
+	/**
+	 * seek to the keyframe before the target and show it, instead
+	 * of decoding up to the frame at the target: good for scrubbing
+	 */
+	bool fast_seek;
 
 	bool relative_seek(double increment);
 
@@ -89,6 +105,45 @@ class VideoLayer: public Layer {
 	int audio_channels;
 	int audio_samplerate;
 
+	/// state of the decoding pipeline
+	struct queue_stats_t {
+	  int packets; ///< packets waiting for the decoder
+	  int frames; ///< frames ready to be shown
+	  unsigned int underruns; ///< feeds finding no frame ready
+	};
+	void get_queue_stats(queue_stats_t *st);
+
+	/// decode to yuv 4:2:0 frames, copied as they are when the codec is yuv 4:2:0
+	bool set_yuv420(bool on);
+
+	/**
+	 * threads used by the video codec, with frame and slice
+	 * threading where libavcodec supports them; 0 takes a share
+	 * of decode_budget. It is applied when the codec is opened,
+	 * so it must be set before open()
+	 */
+	int decode_threads;
+	int get_codec_threads() { return codec_threads; }; ///< threads of the open codec
+
+	/**
+	 * codec threads shared by all the video layers opened next;
+	 * 0 gives them the cpus left free by the compositor and the
+	 * encoders worker pools
+	 */
+	static int decode_budget;
+	/// clips expected to decode at the same time, each gets an equal share of decode_budget
+	static int decode_clips;
+
+	/**
+	 * keep the decoded clip in the ClipCache: after a whole pass
+	 * the layer plays it from memory, silent and without decoding,
+	 * as do other layers opening the same file. Set before open()
+	 */
+	bool use_cache;
+	bool is_cached() { return clip_ready; }; ///< playing from the cache
+	/// frames stepped on each feed() of a cached clip, negative plays backwards
+	double cache_speed;
+
  protected:
 	bool _init();
 
@@ -100,7 +155,6 @@ class VideoLayer: public Layer {
 	AVInputFormat *fmt;
 	AVFormatContext *avformat_context;
 	AVStream *avformat_stream;
-	AVPicture *rgba_picture;
 	AVPacket pkt;
 
 
@@ -140,14 +194,55 @@ class VideoLayer: public Layer {
 	int picture_number;
 
 	/**
-	 * application variables
+	 * decoding pipeline: the demux thread reads packets in the
+	 * packets queue, the decode thread decodes them and converts
+	 * each picture in a free frame of the fifo, queued in frames
+	 * until feed() shows it
 	 */
-	struct frame_fifo_t { // I want it hard, I want it raw
-		AVPicture *picture[FIFO_SIZE];
-		int picture_type[FIFO_SIZE];
-		int length;
-	} frame_fifo;
-	int fifo_position;
+	struct video_frame_t {
+		AVPicture picture; ///< RGB32 frame
+		double pts; ///< presentation time in seconds
+	} frame_fifo[FIFO_SIZE];
+	int fifo_length;
+	BoundedQueue packets; ///< demux to decode
+	BoundedQueue frames; ///< decode to feed
+	BoundedQueue free_frames; ///< feed back to decode
+	video_frame_t *shown; ///< frame returned by the last feed()
+	unsigned int underruns;
+
+	pthread_t demux_thread;
+	pthread_t decode_thread;
+	volatile bool pipeline_running;
+	volatile bool reopen; ///< the stream ended and can't seek back
+	void start_pipeline();
+	void stop_pipeline();
+	static void *demux_run(void *arg);
+	static void *decode_run(void *arg);
+	void demux_loop();
+	void decode_loop();
+	void flush_frames(bool drop);
+
+	volatile int64_t to_seek; ///< asked by any thread, -1 when none
+	int64_t take_seek() { return __sync_lock_test_and_set(&to_seek, -1); };
+
+	KeyframeIndex keyframes;
+	int64_t stream_start; ///< timestamp of time 0 in the video stream
+	double skip_to; ///< decode thread drops frames before this time
+	bool mark_looping; ///< seeking back to mark_in
+
+	CachedClip *clip; ///< filled by the decode thread until clip_ready
+	volatile bool clip_ready;
+	double clip_pos; ///< frame shown from the cached clip
+	void *feed_cached();
+
+	volatile bool want_yuv420; ///< asked by the screen, done by feed()
+	bool yuv420_out; ///< the frames in the fifo are yuv 4:2:0
+	enum PixelFormat out_pix_fmt() { return yuv420_out ? PIX_FMT_YUV420P : PIX_FMT_RGB32; };
+	void switch_format();
+
+	int codec_threads;
+	static int share_decode_budget();
+
 	bool deinterlaced;
 	bool backward_control;
 	bool paused;
@@ -169,10 +264,10 @@ class VideoLayer: public Layer {
 	FILE *fp;
 
 	/** private methods */
-	int seek(int64_t timestamp);
-	int decode_video_packet( int *got_picture);
-	int decode_audio_packet( int *data_size);
-	int decode_audio_packet();
+	int seek(int64_t timestamp, bool drop); ///< drop the frames decoded ahead
+	int decode_video_packet(AVPacket *packet, int *got_picture);
+	int decode_audio_packet(AVPacket *packet, int *data_size);
+	void decode_audio(AVPacket *packet);
 
 	void set_speed(int speed);
 	double get_master_clock();
@@ -180,7 +275,6 @@ class VideoLayer: public Layer {
 	int new_fifo();
 	void free_fifo();
 	int new_picture(AVPicture *p);
-	void free_picture(AVPicture *p);
 
 	// quick hack for EOS callback
 	DumbCallback *eos;
@@ -0,0 +1,85 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+   @file worker_pool.h
+   @brief Persistent pool of worker threads running indexed jobs
+*/
+
+#ifndef __WORKER_POOL_H__
+#define __WORKER_POOL_H__
+
+#include <pthread.h>
+
+/// job executed by the pool: arg is shared, idx goes from 0 to count-1
+typedef void (worker_job_f)(void *arg, int idx);
+
+/**
+   A WorkerPool keeps a number of threads sleeping until a batch of
+   jobs is submitted with WorkerPool::run, then each job index is
+   handed to the first free thread. The calling thread takes part in
+   the work and run() returns only when all jobs of the batch are
+   done, so that the caller can treat it as a parallel for loop.
+
+   If the pool has no threads then run() executes all jobs inline.
+   Several threads may share a pool, their batches run one after the
+   other.
+
+   @brief Persistent pool of threads for parallel loops
+*/
+class WorkerPool {
+ public:
+  WorkerPool();
+  ~WorkerPool();
+
+  bool init(int nthreads = 0); ///< start nthreads workers (0 = one less than online cpus)
+  void close(); ///< stop and join all workers
+
+  void run(worker_job_f *fun, void *arg, int count); ///< run count jobs and wait for completion
+
+  int threads() { return nthreads; }; ///< number of worker threads (caller excluded)
+
+  static int running() { return total; }; ///< worker threads started by all pools
+
+ private:
+  static void *_run(void *arg);
+  void work(); ///< claim and execute jobs until the batch is exhausted
+
+  pthread_t *workers;
+  int nthreads;
+  static volatile int total;
+
+  pthread_mutex_t mutex;
+  pthread_mutex_t run_mutex; ///< held by the caller of the batch running
+  pthread_cond_t wake_cond;
+  pthread_cond_t done_cond;
+
+  worker_job_f *job_fun;
+  void *job_arg;
+  int job_count;
+  int job_next;
+  int job_done;
+
+  unsigned int batch; ///< incremented on every run() to wake up the workers
+  bool quit;
+};
+
+int online_cpus(); ///< number of processors currently online
+
+#endif
@@ -0,0 +1,70 @@
+/*  FreeJ
+ *  (c) Copyright 2009 Denis Roio aka jaromil <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef __YUV_SCREEN_H__
+#define __YUV_SCREEN_H__
+
+#include <screen.h>
+#include <i420_convert.h>
+
+#include <factory.h>
+
+/**
+   Headless screen compositing in planar yuv 4:2:0, meant to feed
+   encoders: layers able to decode in yuv hand their frames over as
+   they are, so that a movie streamed out is never turned into RGB.
+   The frames of the other layers are converted once when blitted.
+
+   Only the blits which make sense on yuv samples are available, RGB
+   (copy) and ALPHA (constant opacity); layers are placed on even
+   coordinates and are not zoomed nor rotated.
+
+   @brief Screen compositing in yuv 4:2:0 for encoders
+*/
+class YuvScreen : public ViewPort {
+
+ public:
+  YuvScreen();
+  ~YuvScreen();
+
+  fourcc get_pixel_format() { return YUV420; };
+
+  void *get_surface();
+  void *coords(int x, int y); ///< pointer in the Y plane
+
+  void setup_blits(Layer *lay);
+  void blit(Layer *src);
+  void clear();
+
+  // allow to use Factory on this class
+  FACTORY_ALLOWED;
+
+ protected:
+  bool _init();
+  bool band_blittable(Layer *lay) { return false; };
+
+ private:
+  uint8_t *yuv_buffer;
+
+  I420Convert converter; ///< RGBA layers to yuv
+  uint8_t *rgb_frame; ///< yuv of the RGBA layer blitted
+  uint32_t rgb_frame_size;
+};
+
+#endif
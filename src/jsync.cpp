@@ -61,6 +61,15 @@ void JSyncThread::stop() {
   }
 }
 
+void JSyncThread::step() {
+  if (_running) {
+    error("%s called while the thread is running", __PRETTY_FUNCTION__);
+    return;
+  }
+  deferred_calls->do_jobs();
+  thread_loop();
+}
+
 void* JSyncThread::_run(void *arg) {
   JSyncThread *me = (JSyncThread *)arg;
   //me->_running = true;	// _running is set inside and outside the thread (see start & stop)
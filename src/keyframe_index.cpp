@@ -0,0 +1,236 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <config.h>
+
+#ifdef WITH_FFMPEG
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <keyframe_index.h>
+#include <video_layer.h>
+#include <jutils.h>
+#include <fps.h>
+
+#define INDEX_HEADER "FreeJ keyframe index 1"
+
+bool KeyframeIndex::persist = false;
+
+KeyframeIndex::KeyframeIndex() {
+  filename[0] = 0;
+  stream = -1;
+  start = 0;
+  time_base = 0;
+  keys = NULL;
+  length = capacity = 0;
+  running = false;
+  quit = false;
+  complete = false;
+  pthread_mutex_init(&mutex, NULL);
+}
+
+KeyframeIndex::~KeyframeIndex() {
+  close();
+  pthread_mutex_destroy(&mutex);
+}
+
+void KeyframeIndex::build(const char *file, int s, int64_t st, double tb) {
+  close();
+
+  snprintf(filename, sizeof(filename), "%s", file);
+  stream = s;
+  start = st;
+  time_base = tb;
+
+  quit = false;
+  running = true;
+  if(pthread_create(&thread, NULL, &KeyframeIndex::_run, this) != 0) {
+    error("KeyframeIndex :: can't create thread for %s", file);
+    running = false;
+  }
+}
+
+void KeyframeIndex::close() {
+  if(running) {
+    quit = true;
+    pthread_join(thread, NULL);
+    running = false;
+  }
+  pthread_mutex_lock(&mutex);
+  if(keys) free(keys);
+  keys = NULL;
+  length = capacity = 0;
+  complete = false;
+  pthread_mutex_unlock(&mutex);
+}
+
+void *KeyframeIndex::_run(void *arg) {
+  KeyframeIndex *idx = (KeyframeIndex*)arg;
+
+  if(!persist || !idx->load())
+    idx->scan();
+  return NULL;
+}
+
+bool KeyframeIndex::add(int64_t ts, int64_t pos, double time) {
+  keyframe_t *grown;
+  int cap;
+
+  pthread_mutex_lock(&mutex);
+  // keyframes are searched by time, which only grows
+  if(length && time <= keys[length - 1].time) {
+    pthread_mutex_unlock(&mutex);
+    return true;
+  }
+  if(length == capacity) {
+    cap = capacity ? capacity * 2 : 256;
+    grown = (keyframe_t*)realloc(keys, cap * sizeof(keyframe_t));
+    if(!grown) { // the keyframes indexed so far are kept
+      pthread_mutex_unlock(&mutex);
+      error("KeyframeIndex :: out of memory after %u keyframes of %s",
+	    length, filename);
+      return false;
+    }
+    keys = grown;
+    capacity = cap;
+  }
+  keys[length].ts = ts;
+  keys[length].pos = pos;
+  keys[length].time = time;
+  length++;
+  pthread_mutex_unlock(&mutex);
+  return true;
+}
+
+bool KeyframeIndex::find(double t, keyframe_t *k) {
+  int lo, hi, mid;
+
+  pthread_mutex_lock(&mutex);
+  // past the last keyframe of a partial index a closer one may follow
+  if(!length || (!complete && t >= keys[length - 1].time)) {
+    pthread_mutex_unlock(&mutex);
+    return false;
+  }
+  lo = 0;
+  hi = length - 1;
+  while(lo < hi) {
+    mid = (lo + hi + 1) / 2;
+    if(keys[mid].time <= t) lo = mid;
+    else hi = mid - 1;
+  }
+  *k = keys[lo];
+  pthread_mutex_unlock(&mutex);
+  return true;
+}
+
+void KeyframeIndex::scan() {
+  AVFormatContext *ctx = NULL;
+  AVPacket pkt;
+  int64_t ts;
+  bool ok = true;
+  uint64_t began = FPS::wall();
+
+  // a context of our own, the layer keeps reading from its one
+  if(av_open_input_file(&ctx, filename, NULL, 0, NULL) < 0) {
+    warning("KeyframeIndex :: can't open %s", filename);
+    return;
+  }
+  if(stream < 0 || stream >= (int)ctx->nb_streams) {
+    av_close_input_file(ctx);
+    return;
+  }
+
+  while(ok && !quit && av_read_frame(ctx, &pkt) == 0) {
+    if(pkt.stream_index == stream && (pkt.flags & PKT_FLAG_KEY)) {
+      ts = (pkt.pts != (int64_t)AV_NOPTS_VALUE) ? pkt.pts : pkt.dts;
+      if(ts != (int64_t)AV_NOPTS_VALUE)
+	ok = add(ts, pkt.pos, (ts - start) * time_base);
+    }
+    av_free_packet(&pkt);
+  }
+  av_close_input_file(ctx);
+  if(quit || !ok) return;
+
+  complete = true;
+  act("KeyframeIndex :: %u keyframes in %s indexed in %.1f s",
+      length, filename, (FPS::wall() - began) / 1000000000.0);
+  if(persist) save();
+}
+
+bool KeyframeIndex::load() {
+  char path[576], line[256];
+  struct stat movie, index;
+  long long ts, pos;
+  double time;
+  int s, n;
+  FILE *fd;
+
+  snprintf(path, sizeof(path), "%s%s", filename, KEYFRAME_INDEX_SUFFIX);
+  // an index older than the movie is stale
+  if(stat(filename, &movie) < 0 || stat(path, &index) < 0) return false;
+  if(index.st_mtime < movie.st_mtime) return false;
+
+  fd = fopen(path, "r");
+  if(!fd) return false;
+
+  if(!fgets(line, sizeof(line), fd) || strncmp(line, INDEX_HEADER, strlen(INDEX_HEADER))
+     || fscanf(fd, "stream %d keys %d\n", &s, &n) != 2 || s != stream) {
+    ::fclose(fd);
+    return false;
+  }
+  while(!quit && fscanf(fd, "%lld %lld %lf\n", &ts, &pos, &time) == 3)
+    if(!add(ts, pos, time)) break;
+  ::fclose(fd);
+
+  if(length != n) {
+    warning("KeyframeIndex :: %s is truncated, indexing again", path);
+    pthread_mutex_lock(&mutex);
+    length = 0;
+    pthread_mutex_unlock(&mutex);
+    return false;
+  }
+  complete = true;
+  func("KeyframeIndex :: %u keyframes loaded from %s", length, path);
+  return true;
+}
+
+bool KeyframeIndex::save() {
+  char path[576];
+  FILE *fd;
+  int c;
+
+  snprintf(path, sizeof(path), "%s%s", filename, KEYFRAME_INDEX_SUFFIX);
+  fd = fopen(path, "w");
+  if(!fd) {
+    warning("KeyframeIndex :: can't save %s", path);
+    return false;
+  }
+  fprintf(fd, "%s\nstream %d keys %d\n", INDEX_HEADER, stream, length);
+  for(c = 0; c < length; c++)
+    fprintf(fd, "%lld %lld %f\n", (long long)keys[c].ts,
+	    (long long)keys[c].pos, keys[c].time);
+  ::fclose(fd);
+  func("KeyframeIndex :: saved %s", path);
+  return true;
+}
+
+#endif
@@ -31,6 +31,8 @@
 
 #include <context.h>
 #include <jutils.h>
+#include <buffer_pool.h>
+#include <automation.h>
 #include <config.h>
 
 #include <jsparser_data.h>
@@ -51,6 +53,14 @@ Layer::Layer()
   set_name("???");
   filename[0] = 0;
   buffer = NULL;
+  buffer_yuv420 = false;
+  feed_yuv420 = false;
+  pingpong[0] = pingpong[1] = NULL;
+  pingpong_size = 0;
+  feed_slot = NULL;
+  feed_slot_size = 0;
+  chain_buffers = 0;
+  chain_copied = 0;
   screen = NULL;
   is_native_sdl_surface = false;
   jsclass = &layer_class;
@@ -72,6 +82,9 @@ Layer::Layer()
   parameters = NULL;
 
   priv_data = NULL;
+
+  feed_stats.init(this, "feed");
+  blit_stats.init(this, "blit");
       
   fps.set(25);
 
@@ -81,6 +94,7 @@ Layer::~Layer() {
   func("%s this=%p",__PRETTY_FUNCTION__, this);
 
   active = false;
+  Automation::drop(this);
   FilterInstance *f = (FilterInstance*)filters.begin();
   while(f) {
     f->rem(); // rem is contained in delete for Entry
@@ -100,6 +114,9 @@ Layer::~Layer() {
   }
   
   if(blitter) delete blitter;
+
+  BufferPool::put(pingpong[0]);
+  BufferPool::put(pingpong[1]);
 }
 
 void *Layer::get_data() {
@@ -148,24 +165,64 @@ void Layer::thread_loop() {
   // and signal to the synchronous waiting feed()
   // includes parameter changes for layer
 
+  // the slot can't move while a frame is rendered or filtered in it
+  feed_slot_size = geo.bytesize;
+  feed_slot = frames.back(feed_slot_size);
+
+  feed_stats.start();
   tmp_buf = feed();
+  feed_stats.stop();
+
+  // the geometry grew in feed(): the slot is too small for this
+  // frame, it grows before the next one
+  if(geo.bytesize > feed_slot_size) tmp_buf = NULL;
 
   // check if feed returned a NULL buffer
   if(tmp_buf) {
-    // process filters on the feed buffer
-    tmp_buf = do_filters(tmp_buf);
-  }
 
-  // we add  a memcpy at the end  of the layer pipeline  this is not
-  // that  expensive as leaving  the lock  around the  feed(), which
-  // slows down the whole engine in case the layer is slow. -jrml
+    if(feed_yuv420) // filters work on RGBA only
+      frames.publish(tmp_buf, yuv420_size());
+
+    else {
+      // process filters on the feed buffer
+      tmp_buf = do_filters(tmp_buf);
+
+      // we add  a memcpy at the end  of the layer pipeline  this is not
+      // that  expensive as leaving  the lock  around the  feed(), which
+      // slows down the whole engine in case the layer is slow. -jrml
+      // the copy is skipped when feed() or the last filter rendered in
+      // the frame_slot()
+      if(tmp_buf != feed_slot)
+	chain_copied += geo.bytesize;
+      frames.publish(tmp_buf, geo.bytesize);
+    }
+  }
 
-  buffer = tmp_buf;
-  //  unlock();
   fps.calc();
   fps.delay();
 }
 
+void *Layer::frame_slot() {
+  return feed_slot;
+}
+
+void *Layer::acquire_frame() {
+  size_t bytes = 0;
+  void *frame;
+
+  frame = frames.front(&bytes);
+  // the size tells yuv frames from RGBA ones, skip frames published
+  // before the geometry grew
+  if(frame) {
+    if(bytes == yuv420_size()) buffer_yuv420 = true;
+    else if(bytes >= geo.bytesize) buffer_yuv420 = false;
+    else frame = NULL;
+  }
+
+  buffer = frame;
+  return buffer;
+}
+
 void Layer::thread_teardown() {
   func("%s this=%p thread end: %p %s",__PRETTY_FUNCTION__, this, pthread_self(), name);
 }
@@ -195,7 +252,9 @@ bool Layer::set_blit(const char *bname) {
 
 	  current_blit = b; // start using
 	  need_crop = true;
+	  lock();
 	  blitter->crop(this, screen);
+	  unlock();
 	  blitter->blitlist.sel(0);
 	  b->sel(true);
 	  act("blit %s set for layer %s", current_blit->name, name);
@@ -244,18 +303,69 @@ bool Layer::cafudda() {
   return(true);
 }
 
+void *Layer::chain_buffer(void *cur) {
+  int c = (cur == pingpong[0]) ? 1 : 0;
+
+  if(pingpong_size != geo.bytesize) { // the geometry changed
+    BufferPool::put(pingpong[0]);
+    BufferPool::put(pingpong[1]);
+    pingpong[0] = pingpong[1] = NULL;
+    pingpong_size = geo.bytesize;
+    chain_buffers = 0;
+  }
+  if(!pingpong[c]) {
+    pingpong[c] = BufferPool::get(geo.bytesize);
+    if(pingpong[c]) chain_buffers++;
+  }
+  return pingpong[c];
+}
+
 void *Layer::do_filters(void *tmp_buf) {
-  if( filters.len() ) {
-    FilterInstance *filt;
-    filters.lock();
-    filt = (FilterInstance *)filters.begin();
-    while(filt) {
-      if(filt->active)
-	tmp_buf = (void*) filt->process(fps.fps, (uint32_t*)tmp_buf);
-      filt = (FilterInstance *)filt->next;
+  FilterInstance *filt, *last;
+  void *slot, *dst;
+  bool owned;
+
+  chain_copied = 0;
+  if( ! filters.len() ) return tmp_buf;
+
+  filters.lock();
+
+  last = NULL;
+  for(filt = (FilterInstance *)filters.begin(); filt;
+      filt = (FilterInstance *)filt->next)
+    if(filt->active) last = filt;
+
+  // the last filter renders in the frame slot, so that publishing it
+  // copies nothing, the others go back and forth between two buffers
+  slot = frame_slot();
+  for(filt = (FilterInstance *)filters.begin(); filt;
+      filt = (FilterInstance *)filt->next) {
+    if(!filt->active) continue;
+
+    // the frame of feed() belongs to the layer implementation
+    owned = (tmp_buf == slot || tmp_buf == pingpong[0] || tmp_buf == pingpong[1]);
+
+    if(filt->proto->inplace()) {
+      if(owned && (filt != last || tmp_buf == slot))
+	dst = tmp_buf;
+      else {
+	dst = (filt == last) ? slot : chain_buffer(tmp_buf);
+	if(!dst) break;
+	jmemcpy(dst, tmp_buf, geo.bytesize);
+	chain_copied += geo.bytesize;
+      }
+      filt->process(fps.fps, (uint32_t*)dst, (uint32_t*)dst);
+
+    } else {
+      // input and output must differ
+      dst = (filt == last && tmp_buf != slot) ? slot : chain_buffer(tmp_buf);
+      if(!dst) break;
+      filt->process(fps.fps, (uint32_t*)tmp_buf, (uint32_t*)dst);
     }
-    filters.unlock();
+    tmp_buf = dst;
   }
+
+  filters.unlock();
   return tmp_buf;
 }
 
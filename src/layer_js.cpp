@@ -25,6 +25,7 @@
 #include <layer.h>
 //#include <fps.h>
 #include <blitter.h>
+#include <automation.h>
 
 void js_layer_gc (JSContext *cx, JSObject *obj);
 
@@ -47,6 +48,8 @@ JSFunctionSpec layer_methods[] = {
     {"rotate",          layer_rotate,           1},
     {"zoom",            layer_zoom,             2},
     {"fit",             layer_fit,              0},
+    {"chain_stats",     layer_chain_stats,      0},
+    {"automate",        layer_automate,         2},
     {0}
 };
 
@@ -430,6 +433,59 @@ JS(layer_fit) {
   return JS_TRUE;
 }
 
+JS(layer_chain_stats) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+  JSObject *objtmp;
+  jsval val;
+
+  GET_LAYER(Layer);
+
+  objtmp = JS_NewObject(cx, NULL, NULL, NULL);
+  if(!objtmp) return JS_FALSE;
+  val = INT_TO_JSVAL(lay->chain_buffers);
+  JS_SetProperty(cx, objtmp, "buffers", &val);
+  JS_NewNumberValue(cx, lay->chain_copied, &val);
+  JS_SetProperty(cx, objtmp, "copied", &val);
+
+  *rval = OBJECT_TO_JSVAL( objtmp );
+  return JS_TRUE;
+}
+
+// automate(parameter, [time, value, ...], curve, mode, component)
+// curve is 0 step, 1 linear (default), 2 smooth; mode 0 once (default),
+// 1 loop, 2 bounce, 3 pulse; component of a position or color
+JS(layer_automate) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+  double times[256], values[256];
+  Parameter *param;
+  char *name;
+  int idx, n;
+  int curve = AUTOMATION_LINEAR, mode = ONCE, component = 0;
+
+  JS_CHECK_ARGC(2);
+  GET_LAYER(Layer);
+
+  *rval = INT_TO_JSVAL(-1);
+  name = js_get_string(argv[0]);
+  if(!name) return JS_TRUE;
+  param = (Parameter*)lay->parameters->search(name, &idx);
+  if(!param) {
+    error("parameter %s not found in layer %s", name, lay->name);
+    return JS_TRUE;
+  }
+
+  n = js_get_keyframes(cx, argv[1], times, values, 256);
+  if(!n) return JS_TRUE;
+  if(argc > 2) curve = js_get_int(argv[2]);
+  if(argc > 3) mode = js_get_int(argv[3]);
+  if(argc > 4) component = js_get_int(argv[4]);
+  if(curve < AUTOMATION_STEP || curve > AUTOMATION_SMOOTH) curve = AUTOMATION_LINEAR;
+  if(mode < ONCE || mode > PULSE) mode = ONCE;
+
+  *rval = INT_TO_JSVAL(Automation::add(lay, param, idx, component, times, values, n,
+				       (automation_curve_t)curve, (iterator_mode_t)mode));
+  return JS_TRUE;
+}
 
 /////////////////////////////////////////
 //// Layer Properties
@@ -5,6 +5,7 @@
 
 #include <jutils.h>
 #include <blitter.h>
+#include <cpu_accel.h>
 
 #include <SDL_imageFilter.h>
 
@@ -57,7 +58,7 @@ BLIT red_mask(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
   for(c=bytes>>2;c>0;c--,s++,d++)
     *d |= *s & red_bitmask;
 
-  unsigned char v = (unsigned int) *(float*)(params->begin()->value); // only one value
+  unsigned char v = blit_param_byte(params); // only one value
 
   SDL_imageFilterBinarizeUsingThreshold
     ((unsigned char*)dst,(unsigned char*)dst,bytes, v);
@@ -71,7 +72,7 @@ BLIT green_mask(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
   for(c=bytes>>2;c>0;c--,s++,d++)
     *d |= *s & green_bitmask;
 
-  unsigned char v = (unsigned int) *(float*)(params->begin()->value); // only one value
+  unsigned char v = blit_param_byte(params); // only one value
 
   SDL_imageFilterBinarizeUsingThreshold
     ((unsigned char*)dst,(unsigned char*)dst,bytes, v);
@@ -85,13 +86,25 @@ BLIT blue_mask(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
   for(c=bytes>>2;c>0;c--,s++,d++)
     *d |= *s & blue_bitmask;
 
-  unsigned char v = (unsigned int) *(float*)(params->begin()->value); // only one value
+  unsigned char v = blit_param_byte(params); // only one value
   
     SDL_imageFilterBinarizeUsingThreshold
       ((unsigned char*)dst,(unsigned char*)dst,bytes,v);
 }
 
 
+BLIT blit_alpha(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  register int c;
+  register uint8_t *s = (uint8_t*)src;
+  register uint8_t *d = (uint8_t*)dst;
+  register unsigned int a = blit_param_byte(params);
+
+  a += a >> 7; // 255 becomes 256 so that full opacity is a plain copy
+  for(c=bytes;c>0;c--,s++,d++)
+    *d = (*s * a + *d * (256 - a)) >> 8;
+}
+
+
 BLIT schiffler_add(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
   SDL_imageFilterAdd((unsigned char*)src,(unsigned char*)dst,(unsigned char*)dst,bytes);
 }
@@ -112,8 +125,11 @@ BLIT schiffler_mult(void *src, void *dst, int bytes, Linklist<Parameter> *params
   SDL_imageFilterMult((unsigned char*)src,(unsigned char*)dst,(unsigned char*)dst,bytes);
 }
 
+// sdl_gfx has only an asm body for MultNor and BitAnd, empty on x86_64
 BLIT schiffler_multnor(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
-  SDL_imageFilterMultNor((unsigned char*)src,(unsigned char*)dst,(unsigned char*)dst,bytes);
+  register uint8_t *s = (uint8_t*)src;
+  register uint8_t *d = (uint8_t*)dst;
+  for( ; bytes > 0 ; bytes--, s++, d++) *d = (uint8_t)(*s * *d);
 }
 
 BLIT schiffler_div(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
@@ -125,11 +141,13 @@ BLIT schiffler_multdiv2(void *src, void *dst, int bytes, Linklist<Parameter> *pa
 }
 
 BLIT schiffler_multdiv4(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
-  SDL_imageFilterMultDivby2((unsigned char*)src,(unsigned char*)dst,(unsigned char*)dst,bytes);
+  SDL_imageFilterMultDivby4((unsigned char*)src,(unsigned char*)dst,(unsigned char*)dst,bytes);
 }
 
 BLIT schiffler_and(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
-  SDL_imageFilterBitAnd((unsigned char*)src,(unsigned char*)dst,(unsigned char*)dst,bytes);
+  register uint8_t *s = (uint8_t*)src;
+  register uint8_t *d = (uint8_t*)dst;
+  for( ; bytes > 0 ; bytes--, s++, d++) *d &= *s;
 }
 
 BLIT schiffler_or(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
@@ -147,49 +165,49 @@ BLIT schiffler_neg(void *src, void *dst, int bytes, Linklist<Parameter> *params)
 }
 
 BLIT schiffler_addbyte(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
-  unsigned char v = (unsigned int) *(float*)(params->begin()->value); // only one value
+  unsigned char v = blit_param_byte(params); // only one value
 
   SDL_imageFilterAddByte((unsigned char*)src,(unsigned char*)dst,bytes, v);
 }
 
 BLIT schiffler_addbytetohalf(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
-  unsigned char v = (unsigned int) *(float*)(params->begin()->value); // only one value
+  unsigned char v = blit_param_byte(params); // only one value
 
   SDL_imageFilterAddByteToHalf((unsigned char*)src,(unsigned char*)dst,bytes, v);
 }
 
 BLIT schiffler_subbyte(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
-  unsigned char v = (unsigned int) *(float*)(params->begin()->value); // only one value
+  unsigned char v = blit_param_byte(params); // only one value
 
   SDL_imageFilterSubByte((unsigned char*)src,(unsigned char*)dst,bytes, v);
 }
 
 BLIT schiffler_shl(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
-  unsigned char v = (unsigned int) *(float*)(params->begin()->value); // only one value
+  unsigned char v = blit_param_byte(params); // only one value
 
   SDL_imageFilterShiftLeft((unsigned char*)src,(unsigned char*)dst,bytes, v);
 }
 
 BLIT schiffler_shlb(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
-  unsigned char v = (unsigned int) *(float*)(params->begin()->value); // only one value
+  unsigned char v = blit_param_byte(params); // only one value
 
   SDL_imageFilterShiftLeftByte((unsigned char*)src,(unsigned char*)dst,bytes,v);
 }
 
 BLIT schiffler_shr(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
-  unsigned char v = (unsigned int) *(float*)(params->begin()->value); // only one value
+  unsigned char v = blit_param_byte(params); // only one value
 
   SDL_imageFilterShiftRight((unsigned char*)src,(unsigned char*)dst,bytes,v);
 }
 
 BLIT schiffler_mulbyte(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
-  unsigned char v = (unsigned int) *(float*)(params->begin()->value); // only one value
+  unsigned char v = blit_param_byte(params); // only one value
 
   SDL_imageFilterMultByByte((unsigned char*)src,(unsigned char*)dst,bytes,v);
 }
 
 BLIT schiffler_binarize(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
-  unsigned char v = (unsigned int) *(float*)(params->begin()->value); // only one value
+  unsigned char v = blit_param_byte(params); // only one value
   SDL_imageFilterBinarizeUsingThreshold
     ((unsigned char*)src,(unsigned char*)dst,bytes, v);
 }
@@ -197,9 +215,10 @@ BLIT schiffler_binarize(void *src, void *dst, int bytes, Linklist<Parameter> *pa
 
 
 
-void setup_linear_blits(Blitter *blitter) {
+void setup_linear_blits(Blitter *blitter, uint32_t accel) {
   Blit *b;
   Parameter *p;
+  blit_f *f;
 
   b = new Blit(); b->set_name("RGB");
   sprintf(b->desc, "RGB blit (jmemcpy)");
@@ -221,7 +240,7 @@ void setup_linear_blits(Blitter *blitter) {
   b = new Blit(); b->set_name("MEAN");
   sprintf(b->desc,"bytewise mean");
   b->type = Blit::LINEAR;
-  b->fun = schiffler_add; blitter->blitlist.prepend(b);
+  b->fun = schiffler_mean; blitter->blitlist.prepend(b);
 
   b = new Blit(); b->set_name("ABSDIFF");
   sprintf(b->desc,"absolute difference");
@@ -268,6 +287,17 @@ void setup_linear_blits(Blitter *blitter) {
   b->type = Blit::LINEAR;
   b->fun = blit_xor; blitter->blitlist.prepend(b);
 
+  b = new Blit(); b->set_name("ALPHA");
+  sprintf(b->desc,"alpha blit");
+  b->type = Blit::LINEAR;
+  b->fun = blit_alpha; blitter->blitlist.prepend(b);
+
+  p = new Parameter(Parameter::NUMBER);
+  strcpy(p->name, "alpha");
+  strcpy(p->description, "level of transparency of alpha channel (0.0 - 1.0)");
+  p->multiplier = 255.0;
+  b->parameters.append(p);
+
   b = new Blit(); b->set_name("RED");
   sprintf(b->desc,"red channel only blit");
   b->type = Blit::LINEAR;
@@ -431,5 +461,15 @@ void setup_linear_blits(Blitter *blitter) {
   p->multiplier = 255.0;
   b->parameters.append(p);
 
+  /////////
+
+  // swap the reference kernels above with the SIMD ones this cpu can run
+  accel &= mm_accel();
+  b = blitter->blitlist.begin();
+  while(b) {
+    f = accel_linear_blit(b->name, accel);
+    if(f) b->fun = f;
+    b = (Blit*)b->next;
+  }
 
 }
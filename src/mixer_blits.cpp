@@ -0,0 +1,230 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <jutils.h>
+#include <blitter.h>
+#include <filter_instance.h>
+#include <frei0r_freej.h>
+#include <buffer_pool.h>
+#include <fps.h>
+
+/*
+  Mixer blits run a frei0r MIXER2 plugin with the screen as first
+  input and the layer as second one, writing the result back on the
+  screen, so that the layer is mixed on what lies below it in the
+  same pass that blits it, without intermediate frames.
+
+  Mixers blending pixel by pixel get an instance one row wide and are
+  run row by row, so that the rows of the layer and of the screen don't
+  need to be contiguous. The other mixers, like wipes, need to see the
+  whole frame: they are run once on the layer. frei0r wants the frames
+  aligned to 16 bytes, when rows aren't a mixer runs on the whole layer
+  too. A whole layer whose rows are not those of the screen, or not
+  aligned, is mixed on aligned copies of its rows and of the screen.
+
+  The instance of a mixer is not shared by threads: mixers run row by
+  row have an instance for each band of the screen, built once for the
+  width of the layer and kept, as is the one of the whole layer, when
+  the rows go in and out of alignment. Mixers of whole frames are run
+  serially, never in the bands of the screen.
+*/
+
+void setup_mixer_blits(Blitter *blitter) {
+#ifdef WITH_FREI0R
+  Freior *fr;
+  Blit *b;
+  Parameter *p;
+
+  fr = (Freior*)Freior::mixers.begin();
+  while(fr) {
+
+    b = new Blit(); b->set_name(fr->name);
+    snprintf(b->desc, 512, "frei0r mixer: %s", fr->description());
+    b->type = Blit::MIXER;
+
+    b->mixer = fr->new_instance();
+    if(!b->mixer) {
+      error("can't instantiate mixer %s", fr->name);
+      delete b;
+      fr = (Freior*)fr->next;
+      continue;
+    }
+    // the parameters of the mixer are those of the blit
+    while( (p = b->mixer->parameters.begin()) ) {
+      p->rem();
+      b->parameters.append(p);
+    }
+
+    b->mixer_rows = (fr->slice_halo == 0);
+    blitter->blitlist.append(b);
+
+    fr = (Freior*)fr->next;
+  }
+#endif
+}
+
+// every row of the layer and of the screen starts on 16 bytes
+static bool aligned_rows(Blit *b, uint32_t *play, uint32_t *pscr) {
+  if(((uintptr_t)play | (uintptr_t)pscr) & 15) return false;
+  if(b->lay_height > 1
+     && ((b->lay_stride + b->lay_pitch) | (b->scr_stride + b->lay_pitch)) & 3)
+    return false;
+  return true;
+}
+
+#ifdef WITH_FREI0R
+// construct an instance of the mixer and give it the values of the
+// parameters: the first one tells the defaults of those not set yet
+static bool mixer_construct(Blit *b, FilterInstance *inst, uint32_t w, uint32_t h) {
+  Freior *fr = (Freior*)b->mixer->proto;
+  Parameter *p;
+  int idx;
+
+  if(!fr->construct(inst, w, h)) {
+    error("can't construct mixer %s of %ux%u pixels", b->name, w, h);
+    return false;
+  }
+  func("mixer %s constructed for %ux%u pixels", b->name, w, h);
+
+  idx = 1; // frei0r callbacks count from 1
+  for(p = b->parameters.begin(); p; p = (Parameter*)p->next, idx++)
+    if(!b->mixer_defaults && !p->changed) (*p->filter_get_f)(inst, p, idx);
+    else (*p->filter_set_f)(inst, p, idx);
+  b->mixer_defaults = true;
+  return true;
+}
+#endif
+
+bool mixer_blit_prepare(Blit *b, uint32_t *play, uint32_t *pscr, int bands) {
+#ifdef WITH_FREI0R
+  FilterInstance *inst;
+  Parameter *p;
+  uint32_t w, h;
+  int idx, c;
+
+  if(!b->mixer) return false;
+
+  w = b->lay_pitch;
+  h = b->lay_height;
+  if(!w || !h) return false;
+  b->mixer_by_rows = b->mixer_rows && aligned_rows(b, play, pscr);
+
+  if(b->mixer_by_rows) {
+    // the instances of the bands are made again only for another width
+    if(w != b->mixer_band_w) {
+      while(b->mixer_bands) delete b->mixer_band[--b->mixer_bands];
+      b->mixer_band_w = w;
+    }
+    if(b->mixer_bands < bands) {
+      b->mixer_band = (FilterInstance**)
+	realloc(b->mixer_band, bands * sizeof(FilterInstance*));
+      while(b->mixer_bands < bands) {
+	inst = b->mixer->proto->new_instance();
+	if(!inst || !mixer_construct(b, inst, w, 1)) {
+	  if(inst) delete inst;
+	  return false;
+	}
+	b->mixer_band[b->mixer_bands++] = inst;
+      }
+    }
+
+  } else if(!b->mixer->core || w != b->mixer_w || h != b->mixer_h) {
+    // the whole layer, constructed the first time and if it changed size
+    if(!mixer_construct(b, b->mixer, w, h)) {
+      b->mixer_w = b->mixer_h = 0;
+      return false;
+    }
+    b->mixer_w = w;
+    b->mixer_h = h;
+  }
+
+  idx = 1;
+  for(p = b->parameters.begin(); p; p = (Parameter*)p->next, idx++)
+    if(p->changed) {
+      if(b->mixer->core) (*p->filter_set_f)(b->mixer, p, idx);
+      for(c = 0; c < b->mixer_bands; c++)
+	(*p->filter_set_f)(b->mixer_band[c], p, idx);
+      p->changed = false;
+    }
+
+  // all rows of the frame are mixed at the same time
+  b->mixer_time = FPS::now() / 1000000000.0;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void mixer_blit_rows(Blit *b, uint32_t *play, uint32_t *pscr, int rows, int band) {
+#ifdef WITH_FREI0R
+  Freior *fr = (Freior*)b->mixer->proto;
+  FilterInstance *inst;
+  uint32_t *scr, *lay, *s, *l;
+  size_t row_bytes, size;
+  int c;
+
+  if(b->mixer_by_rows) { // row by row, all aligned
+    inst = b->mixer_band[band];
+    for( ; rows > 0 ; rows-- ) {
+      fr->mix(inst, b->mixer_time, pscr, play, pscr);
+      pscr += b->scr_stride + b->lay_pitch;
+      play += b->lay_stride + b->lay_pitch;
+    }
+    return;
+  }
+
+  if(rows > (int)b->mixer_h) rows = b->mixer_h;
+
+  // the whole layer at once, in place if its rows are those of the screen
+  if(!b->scr_stride && !b->lay_stride && !(((uintptr_t)play | (uintptr_t)pscr) & 15)) {
+    fr->mix(b->mixer, b->mixer_time, pscr, play, pscr);
+    return;
+  }
+
+  // else on copies of the rows, kept for the next frames
+  row_bytes = b->lay_pitch * sizeof(uint32_t);
+  size = 2 * row_bytes * b->mixer_h;
+  if(b->mixer_stage_size < size) {
+    BufferPool::put(b->mixer_stage);
+    b->mixer_stage = (uint32_t*)BufferPool::get(size);
+    b->mixer_stage_size = b->mixer_stage ? size : 0;
+    if(!b->mixer_stage) return;
+  }
+  scr = b->mixer_stage;
+  lay = b->mixer_stage + b->lay_pitch * b->mixer_h;
+
+  for(c = 0, s = pscr, l = play; c < rows; c++) {
+    memcpy(scr + c * b->lay_pitch, s, row_bytes);
+    memcpy(lay + c * b->lay_pitch, l, row_bytes);
+    s += b->scr_stride + b->lay_pitch;
+    l += b->lay_stride + b->lay_pitch;
+  }
+
+  fr->mix(b->mixer, b->mixer_time, scr, lay, scr);
+
+  for(c = 0, s = pscr; c < rows; c++) {
+    memcpy(s, scr + c * b->lay_pitch, row_bytes);
+    s += b->scr_stride + b->lay_pitch;
+  }
+#endif
+}
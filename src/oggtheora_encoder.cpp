@@ -56,6 +56,9 @@ OggTheoraEncoder::OggTheoraEncoder()
   m_MixBuffer = NULL;
   m_MixBufferOperation = NULL;
   m_MixedRing = NULL;
+  audio_running = false;
+  audio_quit = false;
+  padded = NULL;
   init_info(&oggmux);
   theora_comment_init(&oggmux.tc);
 
@@ -66,8 +69,20 @@ OggTheoraEncoder::OggTheoraEncoder()
 
 OggTheoraEncoder::~OggTheoraEncoder() { // XXX TODO clear the memory !!
   func("OggTheoraEncoder:::~OggTheoraEncoder");
+
+  // no thread may be encoding while the muxer is closed
+  stop();
+  stop_encoding();
+  if(audio_running) {
+    audio_quit = true;
+    pthread_join(audio_thread, NULL);
+    audio_running = false;
+  }
   
-  oggmux_flush(&oggmux, 1);
+  // the last pages go out as the ringbuffer is emptied
+  while(oggmux_flush(&oggmux, 1))
+    write_encoded();
+  write_encoded();
   oggmux_close(&oggmux);
   
   //  if(enc_rgb24) free(enc_rgb24);
@@ -77,6 +92,7 @@ OggTheoraEncoder::~OggTheoraEncoder() { // XXX TODO clear the memory !!
   if(m_MixBufferOperation) free(m_MixBufferOperation);
   if (m_buffStream) free(m_buffStream);
   if (m_MixedRing) ringbuffer_free(m_MixedRing);
+  if (padded) free(padded);
 }
 
 
@@ -124,8 +140,13 @@ bool OggTheoraEncoder::init (ViewPort *scr) {
   /* Set up Theora encoder */
 
   int theora_quality = (int) ( (video_quality * 63) / 100);
-  int w                   = screen->geo.w;
-  int h                   = screen->geo.h;
+  // renditions are given their size, the others encode the screen
+  if(!master) {
+    enc_w = screen->geo.w;
+    enc_h = screen->geo.h;
+  }
+  int w                   = enc_w;
+  int h                   = enc_h;
   func("VideoEncoder: encoding theora to quality %u", theora_quality);
   /* Theora has a divisible-by-sixteen restriction for the encoded video size */
   /* scale the frame size up to the nearest /16 and calculate offsets */
@@ -137,14 +158,21 @@ bool OggTheoraEncoder::init (ViewPort *scr) {
   frame_x_offset = ( (video_x - w ) / 2) &~ 1;
   frame_y_offset = ( (video_y - h ) / 2) &~ 1;
 
+  // frames not filling the blocks are placed inside a black one
+  if(video_x != w || video_y != h) {
+    padded = (uint8_t*)malloc(video_x * video_y * 3 / 2);
+    memset(padded, 16, video_x * video_y);
+    memset(padded + video_x * video_y, 128, video_x * video_y / 2);
+  }
+
 
   /* video settings here */
   theora_info_init (&oggmux.ti);
 
   oggmux.ti.width                        = video_x;
   oggmux.ti.height                       = video_y;
-  oggmux.ti.frame_width                  = screen->geo.w;
-  oggmux.ti.frame_height                 = screen->geo.h;
+  oggmux.ti.frame_width                  = w;
+  oggmux.ti.frame_height                 = h;
   oggmux.ti.offset_x                     = frame_x_offset;
   oggmux.ti.offset_y                     = frame_y_offset;
   oggmux.ti.fps_numerator                = 25; // env->fps.fps;
@@ -171,11 +199,16 @@ bool OggTheoraEncoder::init (ViewPort *scr) {
   oggmux.ti.sharpness                    = 1;
 
   oggmux_init(&oggmux);
-  
-  enc_y     = malloc( screen->geo.w * screen->geo.h);
-  enc_u     = malloc((screen->geo.w * screen->geo.h) /2);
-  enc_v     = malloc((screen->geo.w * screen->geo.h) /2);
-  enc_yuyv   = (uint8_t*)malloc(  screen->geo.bytesize );
+  keep_headers();
+
+  // audio is encoded at its own pace, along with the video frames
+  if(use_audio) {
+    audio_running = true;
+    if(pthread_create(&audio_thread, NULL, &OggTheoraEncoder::audio_run, this) != 0) {
+      error("OggTheoraEncoder :: can't create the audio encoding thread");
+      audio_running = false;
+    }
+  }
   
   act("initialization successful");
   initialized = true;
@@ -291,15 +324,35 @@ int OggTheoraEncoder::Mux(int nfr)
 }
 
 int OggTheoraEncoder::encode_frame() {
-  static int written = 0;
   encode_video ( 0);
-  if (use_audio)
-  {
-	float *ptr = m_buffStream;
-	int sizeFilled = 0;
+  
+  oggmux_flush(&oggmux, 0);
+
+  bytes_encoded = oggmux.video_bytesout + oggmux.audio_bytesout;	//total from the beginning
+
+  audio_kbps = oggmux.akbps;
+  video_kbps = oggmux.vkbps;
+
+  // just pass the reference for the status
+  status = &oggmux.status[0];
+  return bytes_encoded;
+}
+
+void *OggTheoraEncoder::audio_run(void *arg) {
+  OggTheoraEncoder *enc = (OggTheoraEncoder*)arg;
+
+  while(!enc->audio_quit) {
+    // wait for more audio when less than a chunk was collected
+    if(!enc->encode_audio_chunk())
+      jsleep(0, 10000000);
+  }
+  return NULL;
+}
+
+bool OggTheoraEncoder::encode_audio_chunk() {
 	size_t rv = 0;
-	sizeFilled = Mux(1024);
-// 	std::cerr << "--sizeFilled :" << sizeFilled << std::endl;
+	bool done = false;
+	Mux(1024);
 	if (int rf = ringbuffer_read_space (m_MixedRing))
 	{
 // 	  std::cerr << "--rf :" << rf << std::endl;
@@ -325,20 +378,11 @@ int OggTheoraEncoder::encode_frame() {
 		    << " rff:" << rff << " rv:" << rv << std::endl << std::flush;
 	    }
  	    encode_audio ( 0, rv);
+	    oggmux_flush(&oggmux, 0);
+	    done = true;
 	  }
 	}
-  }
-  
-  oggmux_flush(&oggmux, 0);
-
-  bytes_encoded = oggmux.video_bytesout + oggmux.audio_bytesout;	//total from the beginning
-
-  audio_kbps = oggmux.akbps;
-  video_kbps = oggmux.vkbps;
-
-  // just pass the reference for the status
-  status = &oggmux.status[0];
-  return bytes_encoded;
+	return done;
 }
 
 
@@ -365,6 +409,23 @@ int OggTheoraEncoder::encode_video( int end_of_stream) {
    yuv.y = (uint8_t *) enc_y;
    yuv.u = (uint8_t *) enc_u;
    yuv.v = (uint8_t *) enc_v;
+
+   if(padded) {
+     uint8_t *planes[3] = { (uint8_t*)enc_y, (uint8_t*)enc_u, (uint8_t*)enc_v };
+     uint8_t *dst = padded;
+     int p, row, shift;
+     for(p = 0; p < 3; p++) {
+       shift = p ? 1 : 0;
+       for(row = 0; row < (enc_h >> shift); row++)
+	 memcpy(dst + ((frame_y_offset >> shift) + row) * (video_x >> shift)
+		+ (frame_x_offset >> shift),
+		planes[p] + row * (enc_w >> shift), enc_w >> shift);
+       dst += (video_x >> shift) * (video_y >> shift);
+     }
+     yuv.y = padded;
+     yuv.u = padded + video_x * video_y;
+     yuv.v = yuv.u + (video_x >> 1) * (video_y >> 1);
+   }
   
   /* encode image */
   oggmux_add_video (&oggmux, &yuv, end_of_stream);
@@ -31,6 +31,7 @@
 #include <jutils.h>
 
 #include <callbacks_js.h>
+#include <frame_stats.h>
 
 FACTORY_REGISTER_INSTANTIATOR(Controller, OscController, OscController, core);
 
@@ -196,6 +197,7 @@ JS(js_osc_ctrl_stop);
 JS(js_osc_ctrl_add_method);
 JS(js_osc_ctrl_send_to);
 JS(js_osc_ctrl_send);
+JS(js_osc_ctrl_send_stats);
 //JS(js_osc_ctrl_rem_method);
 
 JSFunctionSpec js_osc_ctrl_methods[] = {
@@ -204,6 +206,7 @@ JSFunctionSpec js_osc_ctrl_methods[] = {
   {"add_method", js_osc_ctrl_add_method, 3},
   {"send_to",    js_osc_ctrl_send_to,    2},
   {"send",       js_osc_ctrl_send,       8},
+  {"send_stats", js_osc_ctrl_send_stats, 1},
   //  {"rem_method", js_osc_ctrl_rem_method, 2},
   {0}
 };
@@ -412,6 +415,66 @@ JS(js_osc_ctrl_send) {
 
 }
 
+int OscController::send_stats(const char *prefix) {
+  FrameStats *st;
+  FrameStats::summary_t sum;
+  char path[512];
+  char name[256];
+  int c = 0;
+
+  if(!sendto) {
+    error("OSC controller has no destination, use send_to first");
+    return 0;
+  }
+
+  // one message per stage: frames, min, avg, p99 and max milliseconds
+  FrameStats::stages().lock();
+  st = FrameStats::stages().begin();
+  while(st) {
+    if(st->summary(&sum)) {
+      st->get_name(name, sizeof(name));
+      snprintf(path, sizeof(path), "%s/%s", prefix, name);
+      outmsg = lo_message_new();
+      lo_message_add_int32(outmsg, sum.frames);
+      lo_message_add_float(outmsg, sum.min);
+      lo_message_add_float(outmsg, sum.avg);
+      lo_message_add_float(outmsg, sum.p99);
+      lo_message_add_float(outmsg, sum.max);
+      lo_send_message_from(sendto, srv, path, outmsg);
+      lo_message_free(outmsg);
+      c++;
+    }
+    st = (FrameStats*)st->next;
+  }
+  FrameStats::stages().unlock();
+
+  // deadlines of the frame scheduler
+  snprintf(path, sizeof(path), "%s/deadlines", prefix);
+  outmsg = lo_message_new();
+  lo_message_add_int32(outmsg, FPS::total_late);
+  lo_message_add_int32(outmsg, FPS::total_missed);
+  lo_send_message_from(sendto, srv, path, outmsg);
+  lo_message_free(outmsg);
+
+  return c;
+}
+
+JS(js_osc_ctrl_send_stats) {
+  func("%u:%s:%s argc: %u",__LINE__,__FILE__,__FUNCTION__, argc);
+  JS_BeginRequest(cx);
+  JS_CHECK_ARGC(1);
+
+  OscController *osc = (OscController *)JS_GetPrivate(cx, obj);
+  if(!osc)
+      JS_ERROR("OSC core data is NULL");
+  JS_EndRequest(cx);
+
+  char *prefix = js_get_string(argv[0]);
+
+  *rval = INT_TO_JSVAL(osc->send_stats(prefix));
+  return JS_TRUE;
+}
+
 //JS(js_osc_ctrl_rem_method) {
 
   // remove methods from commands_pending linklist
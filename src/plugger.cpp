@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <dirent.h>
 
 #ifdef WITH_FREI0R
@@ -115,6 +116,15 @@ int Plugger::refresh(Context *env) {
 #endif
   if(path) {
 
+      // what is known of the plugins found in the previous runs
+      if(getenv("HOME")) {
+        char temp[512];
+        snprintf(temp,511,"%s/.freej",getenv("HOME"));
+        mkdir(temp, 0755); // where the registry is written, if missing
+        snprintf(temp,511,"%s/.freej/plugins.cache",getenv("HOME"));
+        cache.load(temp);
+      }
+
       notice("serching available plugins in %s", path);
 
       dir = strtok(path,":");
@@ -131,66 +141,45 @@ int Plugger::refresh(Context *env) {
           while(found--) {
         
         char temp[256];
+        struct stat st;
+        plugin_entry_t *e;
         
         snprintf(temp,255,"%s/%s",dir,filelist[found]->d_name);
         free(filelist[found]);
 
+        if(stat(temp, &st) < 0) continue;
+
+        // known and unchanged since: registered without opening it
+        e = cache.find(temp, &st);
+        if(e) {
+          place(env, temp, e);
+          continue;
+        }
+
+        // else open it to know what it is, then remember it
+        e = cache.add(temp, &st);
+
 #ifdef WITH_FREI0R
         {
               Freior *fr = (Freior *)Factory<Filter>::new_instance("Frei0rFilter");
           if( !fr || !fr->open(temp) ) {
             delete fr;
           } else { // freior effect found
-            // check what kind of plugin is and place it
-            if(fr->info.plugin_type == F0R_PLUGIN_TYPE_FILTER) {
-                  env->filters.append(fr);
-              
-              func("found frei0r filter: %s (%p)", fr->name, fr);
-              continue;
-
-            } else if(fr->info.plugin_type == F0R_PLUGIN_TYPE_SOURCE) {	      
-              env->generators.append(fr);
-              func("found frei0r generator: %s (%p)", fr->name, fr);
-              continue;
-
-            } else if(fr->info.plugin_type == F0R_PLUGIN_TYPE_MIXER2) {
-              func("frei0r plugin of type MIXER2 not supported (yet)",
-               fr->info.plugin_type);
-              delete fr;
-              continue;
-            } else if(fr->info.plugin_type == F0R_PLUGIN_TYPE_MIXER3) {
-              func("frei0r plugin of type MIXER3 not supported (yet)",
-               fr->info.plugin_type);
-              delete fr;
-              continue;
-            }
+            fr->describe(e);
+            place_frei0r(env, fr);
+            continue;
           }
         }
 #endif
 #ifdef WITH_FREEFRAME
         {
               Freeframe *fr = (Freeframe *)Factory<Filter>::new_instance("FreeframeFilter");
-          if( ! fr->open(temp) ) {
+          if( !fr || !fr->open(temp) ) {
             delete fr;
           } else { // freeframe effect found
-            // check what kind of plugin is and place it
-            if(fr->info->pluginType == FF_EFFECT) {
-              
-              env->filters.append(fr);
-              
-              func("found freeframe filter: %s (%p)",
-               fr->info->pluginName, fr);
-              continue;
-
-            } else if(fr->info->pluginType == FF_SOURCE) {
-              
-              env->generators.append(fr);
-              
-              func("found freeframe generator: %s (%p)",
-               fr->info->pluginName, fr);
-              continue;
-
-            }
+            fr->describe(e);
+            place_freeframe(env, fr);
+            continue;
           }
         }
 #endif
@@ -204,13 +193,92 @@ int Plugger::refresh(Context *env) {
       warning("can't find any valid plugger directory");
       return(-1);
   }
+  act("plugins found: %u in the registry, %u opened", cache.hits, cache.misses);
+  cache.save();
+
   act("filters found: %u", env->filters.len());
   act("generators found: %u", env->generators.len());
+#ifdef WITH_FREI0R
+  act("mixers found: %u", Freior::mixers.len());
+#endif
 
   return 0;
 }
 
 
+void Plugger::place(Context *env, const char *file, plugin_entry_t *e) {
+  switch(e->kind) {
+#ifdef WITH_FREI0R
+  case PLUGIN_FREI0R:
+    {
+      Freior *fr = (Freior *)Factory<Filter>::new_instance("Frei0rFilter");
+      if(!fr) return;
+      fr->defer(file, e);
+      place_frei0r(env, fr);
+    }
+    break;
+#endif
+#ifdef WITH_FREEFRAME
+  case PLUGIN_FREEFRAME:
+    {
+      Freeframe *fr = (Freeframe *)Factory<Filter>::new_instance("FreeframeFilter");
+      if(!fr) return;
+      fr->defer(file, e);
+      place_freeframe(env, fr);
+    }
+    break;
+#endif
+  default: // not a plugin
+    break;
+  }
+}
+
+#ifdef WITH_FREI0R
+bool Plugger::place_frei0r(Context *env, Freior *fr) {
+  // check what kind of plugin is and place it
+  if(fr->info.plugin_type == F0R_PLUGIN_TYPE_FILTER) {
+    env->filters.append(fr);
+    func("found frei0r filter: %s (%p)", fr->name, fr);
+    return true;
+
+  } else if(fr->info.plugin_type == F0R_PLUGIN_TYPE_SOURCE) {	      
+    env->generators.append(fr);
+    func("found frei0r generator: %s (%p)", fr->name, fr);
+    return true;
+
+  } else if(fr->info.plugin_type == F0R_PLUGIN_TYPE_MIXER2) {
+    // screens offer mixers as blits of a layer on those below
+    Freior::mixers.append(fr);
+    func("found frei0r mixer: %s (%p)", fr->name, fr);
+    return true;
+
+  } else if(fr->info.plugin_type == F0R_PLUGIN_TYPE_MIXER3) {
+    func("frei0r plugin of type MIXER3 not supported (yet)",
+         fr->info.plugin_type);
+  }
+  delete fr;
+  return false;
+}
+#endif
+
+#ifdef WITH_FREEFRAME
+bool Plugger::place_freeframe(Context *env, Freeframe *fr) {
+  // check what kind of plugin is and place it
+  if(fr->info->pluginType == FF_EFFECT) {
+    env->filters.append(fr);
+    func("found freeframe filter: %s (%p)", fr->name, fr);
+    return true;
+
+  } else if(fr->info->pluginType == FF_SOURCE) {
+    env->generators.append(fr);
+    func("found freeframe generator: %s (%p)", fr->name, fr);
+    return true;
+  }
+  delete fr;
+  return false;
+}
+#endif
+
 void Plugger::addsearchdir(const char *dir) {
   char temp[1024];
   if(!dircheck(dir))
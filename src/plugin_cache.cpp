@@ -0,0 +1,235 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <plugin_cache.h>
+#include <jutils.h>
+
+#define HEADER "FreeJ plugin registry"
+
+/*
+  The registry has a header line with its version, then for each file
+
+    P <path> <mtime> <size> <kind> <type> <v0> <v1> <v2> <v3> <params> <name> <author> <explanation>
+
+  followed by a line for each of its parameters
+
+    A <type> <name> <explanation>
+
+  fields are separated by tabs, which are replaced in the strings
+*/
+
+// split a line on tabs, returns the fields found
+static int split(char *line, char **field, int max) {
+  int n = 0;
+  char *p;
+
+  p = strchr(line, '\n');
+  if(p) *p = '\0';
+
+  field[n++] = line;
+  for(p = line; *p && n < max; p++)
+    if(*p == '\t') {
+      *p = '\0';
+      field[n++] = p + 1;
+    }
+  return n;
+}
+
+// a whole line, however long the explanations in it are
+static bool read_line(FILE *fd, std::string &line) {
+  char buf[1024];
+
+  line.clear();
+  while(fgets(buf, sizeof(buf), fd)) {
+    line += buf;
+    if(line[line.size() - 1] == '\n') return true;
+  }
+  return !line.empty();
+}
+
+// a string as a field: no tabs or newlines in it
+static void put_field(FILE *fd, const std::string &s) {
+  const char *p;
+  fputc('\t', fd);
+  for(p = s.c_str(); *p; p++)
+    fputc((*p == '\t' || *p == '\n' || *p == '\r') ? ' ' : *p, fd);
+}
+
+PluginCache::PluginCache() {
+  hits = 0;
+  misses = 0;
+  changed = false;
+}
+
+PluginCache::~PluginCache() { }
+
+bool PluginCache::load(const char *file) {
+  FILE *fd;
+  std::string line;
+  char *field[16];
+  plugin_entry_t *e = NULL;
+  plugin_param_t param;
+  int n, version = 0;
+
+  filename = file;
+  entries.clear();
+  hits = misses = 0;
+  changed = false;
+
+  fd = fopen(file, "r");
+  if(!fd) {
+    func("no plugin registry in %s", file);
+    return false;
+  }
+
+  if(!read_line(fd, line)
+     || sscanf(line.c_str(), HEADER " %d", &version) != 1
+     || version != PLUGIN_CACHE_VERSION) {
+    notice("plugin registry %s is of another version, plugins are scanned again", file);
+    fclose(fd);
+    changed = true;
+    return false;
+  }
+
+  while(read_line(fd, line)) {
+    n = split(&line[0], field, 16);
+
+    if(line[0] == 'P' && n >= 14) {
+      e = &entries[field[1]];
+      e->mtime = (time_t)strtol(field[2], NULL, 10);
+      e->size = (off_t)strtoll(field[3], NULL, 10);
+      e->kind = atoi(field[4]);
+      e->type = atoi(field[5]);
+      e->version[0] = atoi(field[6]);
+      e->version[1] = atoi(field[7]);
+      e->version[2] = atoi(field[8]);
+      e->version[3] = atoi(field[9]);
+      // field[10] is the count of parameters, they follow
+      e->name = field[11];
+      e->author = field[12];
+      e->explanation = field[13];
+      e->params.clear();
+      e->seen = false;
+
+    } else if(line[0] == 'A' && n >= 4 && e) {
+      param.type = atoi(field[1]);
+      param.name = field[2];
+      param.explanation = field[3];
+      e->params.push_back(param);
+
+    } else {
+      warning("plugin registry %s is corrupted, plugins are scanned again", file);
+      entries.clear();
+      changed = true;
+      fclose(fd);
+      return false;
+    }
+  }
+
+  fclose(fd);
+  act("plugin registry holds %u files", (unsigned int)entries.size());
+  return true;
+}
+
+bool PluginCache::save() {
+  std::map<std::string, plugin_entry_t>::iterator it, gone;
+  std::vector<plugin_param_t>::iterator p;
+  FILE *fd;
+
+  // files not found in the search path anymore are forgotten
+  for(it = entries.begin(); it != entries.end(); ) {
+    gone = it++;
+    if(!gone->second.seen) {
+      entries.erase(gone);
+      changed = true;
+    }
+  }
+
+  if(!changed || filename.empty()) return true;
+
+  fd = fopen(filename.c_str(), "w");
+  if(!fd) {
+    warning("can't write the plugin registry %s", filename.c_str());
+    return false;
+  }
+
+  fprintf(fd, HEADER " %d\n", PLUGIN_CACHE_VERSION);
+  for(it = entries.begin(); it != entries.end(); it++) {
+    plugin_entry_t &e = it->second;
+    fputc('P', fd);
+    put_field(fd, it->first);
+    fprintf(fd, "\t%ld\t%lld\t%d\t%d\t%d\t%d\t%d\t%d\t%u",
+	    (long)e.mtime, (long long)e.size, e.kind, e.type,
+	    e.version[0], e.version[1], e.version[2], e.version[3],
+	    (unsigned int)e.params.size());
+    put_field(fd, e.name);
+    put_field(fd, e.author);
+    put_field(fd, e.explanation);
+    fputc('\n', fd);
+    for(p = e.params.begin(); p != e.params.end(); p++) {
+      fprintf(fd, "A\t%d", p->type);
+      put_field(fd, p->name);
+      put_field(fd, p->explanation);
+      fputc('\n', fd);
+    }
+  }
+  fclose(fd);
+
+  func("plugin registry %s written with %u files",
+       filename.c_str(), (unsigned int)entries.size());
+  changed = false;
+  return true;
+}
+
+plugin_entry_t *PluginCache::find(const char *path, struct stat *st) {
+  std::map<std::string, plugin_entry_t>::iterator it;
+
+  it = entries.find(path);
+  if(it == entries.end()
+     || it->second.mtime != st->st_mtime
+     || it->second.size != st->st_size)
+    return NULL;
+
+  it->second.seen = true;
+  hits++;
+  return &it->second;
+}
+
+plugin_entry_t *PluginCache::add(const char *path, struct stat *st) {
+  plugin_entry_t *e = &entries[path];
+
+  e->mtime = st->st_mtime;
+  e->size = st->st_size;
+  e->kind = PLUGIN_NONE;
+  e->type = 0;
+  e->name.clear();
+  e->author.clear();
+  e->explanation.clear();
+  e->version[0] = e->version[1] = e->version[2] = e->version[3] = 0;
+  e->params.clear();
+  e->seen = true;
+
+  misses++;
+  changed = true;
+  return e;
+}
@@ -0,0 +1,233 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <math.h>
+
+#include <rotozoom.h>
+#include <worker_pool.h>
+#include <layer.h>
+#include <blitter.h>
+#include <jutils.h>
+#include <config.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// blend two pixels with a weight from 0 to 255 on b, working on two
+// channels at once: red and blue, then alpha and green
+static inline uint32_t lerp_pixel(uint32_t a, uint32_t b, uint32_t f) {
+  uint32_t rb, ag;
+  rb = ( ((a & 0x00ff00ff) * (256 - f)
+	  + (b & 0x00ff00ff) * f) >> 8 ) & 0x00ff00ff;
+  ag = ( (((a >> 8) & 0x00ff00ff) * (256 - f)
+	  + ((b >> 8) & 0x00ff00ff) * f) ) & 0xff00ff00;
+  return rb | ag;
+}
+
+RotoZoom::RotoZoom() {
+  w = h = 0;
+  src = NULL;
+  src_w = src_h = 0;
+  smooth = false;
+  u0 = v0 = 0;
+  du_x = dv_x = du_y = dv_y = 0;
+  buffer = NULL;
+  buffer_size = 0;
+  scratch = NULL;
+  scratch_size = 0;
+  jobs = 1;
+  job_blit = NULL;
+  job_surface = NULL;
+}
+
+RotoZoom::~RotoZoom() {
+  if(buffer) free(buffer);
+  if(scratch) free(scratch);
+}
+
+bool RotoZoom::setup(Layer *lay) {
+  double angle, zx, zy, c, s, dx, dy;
+  int nw, nh;
+  bool changed;
+
+  // rotation uses the horizontal zoom on both axes, like sdl_gfx
+  angle = lay->rotating ? lay->rotate * (M_PI / 180.0) : 0.0;
+  zx = lay->zoom_x;
+  zy = lay->rotating ? lay->zoom_x : lay->zoom_y;
+  if(fabs(zx) < 0.001) zx = 0.001;
+  if(fabs(zy) < 0.001) zy = 0.001;
+  c = cos(angle);
+  s = sin(angle);
+
+  src = (uint32_t*)lay->buffer;
+  src_w = lay->geo.w;
+  src_h = lay->geo.h;
+  smooth = lay->antialias;
+
+  // bounds of the rotated and zoomed frame, kept even to center it
+  nw = 2 * (int)ceil( (fabs(c * zx) * src_w + fabs(s * zy) * src_h) / 2.0 );
+  nh = 2 * (int)ceil( (fabs(s * zx) * src_w + fabs(c * zy) * src_h) / 2.0 );
+  if(nw < 2) nw = 2;
+  if(nh < 2) nh = 2;
+  changed = (nw != w) || (nh != h);
+  w = nw;
+  h = nh;
+  lay->geo_rotozoom.init(w, h, lay->geo.bpp);
+
+  // inverse transform: source position of the center of the first
+  // destination pixel, bilinear sampling is centered on pixels
+  dx = 0.5 - w / 2.0;
+  dy = 0.5 - h / 2.0;
+  u0 = (int32_t) lrint( (src_w / 2.0 + (c * dx - s * dy) / zx
+			 - (smooth ? 0.5 : 0.0)) * 65536.0 );
+  v0 = (int32_t) lrint( (src_h / 2.0 + (s * dx + c * dy) / zy
+			 - (smooth ? 0.5 : 0.0)) * 65536.0 );
+  du_x = (int32_t) lrint( (c / zx) * 65536.0 );
+  dv_x = (int32_t) lrint( (s / zy) * 65536.0 );
+  du_y = (int32_t) lrint( (-s / zx) * 65536.0 );
+  dv_y = (int32_t) lrint( (c / zy) * 65536.0 );
+
+  return changed;
+}
+
+void RotoZoom::sample_row(uint32_t *dst, int x, int y, int len) {
+  register int32_t u, v;
+  register int xi, yi;
+  uint32_t *p;
+  uint32_t fx, fy;
+  int nx, ny;
+
+  u = u0 + x * du_x + y * du_y;
+  v = v0 + x * dv_x + y * dv_y;
+
+  if(!smooth) {
+    for( ; len > 0 ; len--, dst++, u += du_x, v += dv_x ) {
+      xi = u >> 16;
+      yi = v >> 16;
+      // negative positions turn into large unsigned values
+      if( (unsigned)xi < (unsigned)src_w && (unsigned)yi < (unsigned)src_h )
+	*dst = src[ yi * src_w + xi ];
+      else
+	*dst = 0;
+    }
+    return;
+  }
+
+  for( ; len > 0 ; len--, dst++, u += du_x, v += dv_x ) {
+    xi = u >> 16;
+    yi = v >> 16;
+    if( (unsigned)xi >= (unsigned)src_w || (unsigned)yi >= (unsigned)src_h ) {
+      *dst = 0;
+      continue;
+    }
+    p = src + yi * src_w + xi;
+    // the last row and column are repeated
+    nx = (xi + 1 < src_w) ? 1 : 0;
+    ny = (yi + 1 < src_h) ? src_w : 0;
+    fx = (u >> 8) & 0xff;
+    fy = (v >> 8) & 0xff;
+    *dst = lerp_pixel( lerp_pixel(p[0],  p[nx],      fx),
+		       lerp_pixel(p[ny], p[ny + nx], fx), fy );
+  }
+}
+
+int RotoZoom::prepare_jobs(WorkerPool *pool, int line) {
+  size_t size;
+
+  // twice as many jobs as threads to balance rows of different cost
+  jobs = pool ? (pool->threads() + 1) * 2 : 1;
+
+  if(line) {
+    size = jobs * line * sizeof(uint32_t);
+    if(scratch_size < size) {
+      scratch = (uint32_t*)realloc(scratch, size);
+      scratch_size = size;
+    }
+  }
+  return jobs;
+}
+
+void *RotoZoom::render(WorkerPool *pool) {
+  size_t size = w * h * sizeof(uint32_t);
+
+  // the buffer only grows, so that zooming in and out reuses it
+  if(buffer_size < size) {
+    buffer = (uint32_t*)realloc(buffer, size);
+    buffer_size = size;
+    func("rotozoom buffer grown to %ux%u", w, h);
+  }
+
+  prepare_jobs(pool, 0);
+  if(pool)
+    pool->run(&RotoZoom::render_job, this, jobs);
+  else
+    render_job(this, 0);
+
+  return buffer;
+}
+
+void RotoZoom::render_job(void *arg, int idx) {
+  RotoZoom *rz = (RotoZoom*)arg;
+  int y, y1;
+
+  y  = (idx * rz->h) / rz->jobs;
+  y1 = ((idx + 1) * rz->h) / rz->jobs;
+  for( ; y < y1 ; y++ )
+    rz->sample_row(rz->buffer + y * rz->w, 0, y, rz->w);
+}
+
+void RotoZoom::blit(Blit *b, void *surface, WorkerPool *pool) {
+
+  if(b->lay_height <= 0 || b->lay_pitch <= 0) return;
+
+  job_blit = b;
+  job_surface = (uint32_t*)surface;
+
+  prepare_jobs(pool, b->lay_pitch);
+  if(pool)
+    pool->run(&RotoZoom::blit_job, this, jobs);
+  else
+    blit_job(this, 0);
+}
+
+void RotoZoom::blit_job(void *arg, int idx) {
+  RotoZoom *rz = (RotoZoom*)arg;
+  Blit *b = rz->job_blit;
+  uint32_t *line, *pscr;
+  int r, r1;
+
+  r  = (idx * b->lay_height) / rz->jobs;
+  r1 = ((idx + 1) * b->lay_height) / rz->jobs;
+
+  line = rz->scratch + idx * b->lay_pitch;
+  pscr = rz->job_surface + b->scr_offset + r * (b->scr_stride + b->lay_pitch);
+
+  for( ; r < r1 ; r++ ) {
+    // sample the cropped part of the rotated row, then blit it
+    rz->sample_row(line, b->lay_stride_sx, b->lay_stride_up + r, b->lay_pitch);
+
+    (*b->fun)
+      ((void*)line, (void*)pscr,
+       b->lay_bytepitch,
+       &b->parameters);
+
+    pscr += b->scr_stride + b->lay_pitch;
+  }
+}
@@ -27,6 +27,8 @@
 #include <audio_jack.h>
 #endif
 #include <ringbuffer.h>
+#include <worker_pool.h>
+#include <jutils.h>
 
 #include <video_layer.h>
 
@@ -50,6 +52,18 @@ ViewPort::ViewPort()
   audio = NULL;
   m_SampleRate=NULL;
   indestructible = false;
+
+  compositor = SERIAL;
+  pool = NULL;
+  bands = 1;
+  band_ms = NULL;
+  tile_bytes = 128 * 1024; // half of a small L2 cache, the rest for layer rows
+
+  show_stats.init(this, "show");
+  composite_stats.init(this, "composite");
+  run_layers = NULL;
+  run_len = 0;
+  run_size = 0;
 #ifdef WITH_AUDIO
   // if compiled with audio initialize the audio data pipe
 //   audio = ringbuffer_create(1024 * 512);
@@ -77,6 +91,10 @@ ViewPort::~ViewPort() {
 
   if(audio) ringbuffer_free(audio);
 
+  if(pool) delete pool;
+  if(band_ms) free(band_ms);
+  if(run_layers) free(run_layers);
+
   func("screen %s deleting %u encoders", name, encoders.len() );
   VideoEncoder *enc;
   enc = encoders.begin();
@@ -159,6 +177,7 @@ std::cerr << "------ audio_samplerate :" << ((VideoLayer*) layers.begin())->audi
 void ViewPort::rem_layer(Layer *lay)
 {
     lay->screen = NULL; // symmetry
+    lay->set_yuv420(false); // other screens blit RGBA frames
     lay->rem();
     notice("removed layer %s (but still present as an instance)", lay->name);
 }
@@ -169,6 +188,7 @@ void ViewPort::reset()
     lay = layers.begin();
     while(lay) {
         // TODO - notify the layer that it has been removed from the screen
+        lay->set_yuv420(false);
         lay->rem();
         lay = layers.begin();
     }
@@ -182,6 +202,10 @@ bool ViewPort::add_encoder(VideoEncoder *enc) {
     error("moving an encoder from one screen to another is not supported");
     return(false);
   }
+  if(enc->master) {
+    error("encoder %s is a rendition of %s", enc->name, enc->master->name);
+    return(false);
+  }
 
   func("initializing encoder %s",enc->name);
   if(!enc->init(this)) {
@@ -230,31 +254,214 @@ void ViewPort::save_frame(char *file) {
 void ViewPort::blit_layers() {
   Layer *lay;
 
+  if(compositor != SERIAL) {
+    for(int b = 0; b < bands; b++) band_ms[b] = 0.0;
+  }
+
   lay = layers.end();
   if (lay) {
     layers.lock ();
     while (lay) {
 
-      if(lay->buffer) {
+      // take the newest frame published by the layer thread, without
+      // locking it: the layer keeps feeding in its own back buffer
+      if(lay->acquire_frame()) {
+
+	// a yuv frame still in the buffers of a layer leaving a yuv screen
+	if (lay->buffer_yuv420 && get_pixel_format() != YUV420) {
+	  lay = (Layer *)lay->prev;
+	  continue;
+	}
 
 	if (lay->active & lay->opened) {
 
-	  lay->lock();
+	  if(compositor != SERIAL) {
+
+	    if(band_blittable(lay)) {
+	      if(lay->need_crop) {
+		lay->lock(); // the layer can change its geometry
+		lay->blitter->crop( lay, this );
+		lay->unlock();
+	      }
+
+	      // queue the layer, its frame stays valid until the next frame
+	      if(lay->current_blit->type != Blit::MIXER || band_mixer(lay)) {
+		if(run_len == run_size) {
+		  run_size = run_size ? run_size * 2 : 8;
+		  run_layers = (Layer**)realloc(run_layers, run_size * sizeof(Layer*));
+		}
+		run_layers[run_len++] = lay;
+		lay = (Layer *)lay->prev;
+		continue;
+	      }
+	    }
+
+	    // this layer needs the whole surface: composite what is queued first
+	    flush_run();
+	  }
+
+	  lay->blit_stats.start();
 	  lock();
 	  blit(lay);
 	  unlock();
-	  lay->unlock();
+	  lay->blit_stats.stop();
 	  
 	}
       }
       lay = (Layer *)lay->prev;
     }
+    if(compositor != SERIAL)
+      flush_run();
     layers.unlock ();
   }
   /////////// finish processing layers
 
 }
 
+bool ViewPort::set_compositor(compositor_t mode, int threads) {
+
+  // don't swap the pool under the feet of blit_layers()
+  layers.lock();
+
+  if(mode == SERIAL) {
+    compositor = SERIAL;
+    if(pool) { delete pool; pool = NULL; }
+    layers.unlock();
+    act("screen %s compositing layers serially", name);
+    return true;
+  }
+
+  if(mode == FUSED) {
+    if(pool) { delete pool; pool = NULL; }
+    bands = 1;
+    band_ms = (float*)realloc(band_ms, sizeof(float));
+    band_ms[0] = 0.0;
+    compositor = FUSED;
+    layers.unlock();
+    act("screen %s compositing layers fused in tiles of %u bytes", name, tile_bytes);
+    return true;
+  }
+
+  if(!pool) pool = new WorkerPool();
+  if(!pool->init(threads))
+    warning("screen %s compositor started only %u threads", name, pool->threads());
+
+  // twice as many bands as threads, so that bands covered by more
+  // layers don't leave the other threads idle
+  bands = (pool->threads() + 1) * 2;
+  band_ms = (float*)realloc(band_ms, bands * sizeof(float));
+  for(int b = 0; b < bands; b++) band_ms[b] = 0.0;
+
+  compositor = BANDS;
+  layers.unlock();
+
+  act("screen %s compositing layers in %u bands on %u threads",
+      name, bands, pool->threads() + 1);
+  return true;
+}
+
+bool ViewPort::band_blittable(Layer *lay) {
+  // SDL blits draw the whole surface and rotozoom is done inside blit()
+  if(!lay->current_blit) return false;
+  if(lay->rotating | lay->zooming) return false;
+  // mixers of whole frames are run once on the layer
+  if(lay->current_blit->type == Blit::MIXER)
+    return lay->current_blit->mixer_rows;
+  if(lay->current_blit->type != Blit::LINEAR) return false;
+  return true;
+}
+
+bool ViewPort::band_mixer(Layer *lay) {
+  Blit *b = lay->current_blit;
+  uint32_t *pscr, *play;
+
+  // an instance for each band, made before they run; rows which are
+  // not aligned are mixed by a single instance, outside of the bands
+  pscr = (uint32_t*) get_surface() + b->scr_offset;
+  play = (uint32_t*) lay->buffer   + b->lay_offset;
+  if(!mixer_blit_prepare(b, play, pscr, bands)) return false;
+  return b->mixer_by_rows;
+}
+
+void ViewPort::blit_band(Layer *lay, int y0, int y1, int band) {
+  int16_t c;
+  int32_t top, r0, r1;
+  uint32_t *pscr, *play;
+  Blit *b = lay->current_blit;
+
+  if(lay->hidden) return;
+
+  // screen rows covered by the layer, intersected with the band
+  top = b->scr_stride_up;
+  r0 = (y0 > top) ? y0 : top;
+  r1 = (y1 < top + b->lay_height) ? y1 : top + b->lay_height;
+  if(r0 >= r1) return;
+
+  pscr = (uint32_t*) get_surface() + b->scr_offset
+    + (r0 - top) * (b->scr_stride + b->lay_pitch);
+  play = (uint32_t*) lay->buffer   + b->lay_offset
+    + (r0 - top) * (b->lay_stride + b->lay_pitch);
+
+  if(b->type == Blit::MIXER) {
+    mixer_blit_rows(b, play, pscr, r1 - r0, band);
+    return;
+  }
+
+  for( c = r1 - r0 ; c > 0 ; c-- ) {
+
+    (*b->fun)
+      ((void*)play, (void*)pscr,
+       b->lay_bytepitch,
+       &b->parameters);
+
+    pscr += b->scr_stride + b->lay_pitch;
+    play += b->lay_stride + b->lay_pitch;
+  }
+}
+
+void ViewPort::blit_rows(int y0, int y1, int band) {
+  int rows, t0, t1, c;
+
+  // rows in a tile, so that the screen tile stays in cache while
+  // all the layers are blended on it and is written back once
+  rows = geo.bytewidth ? tile_bytes / geo.bytewidth : 1;
+  if(rows < 1) rows = 1;
+
+  for(t0 = y0; t0 < y1; t0 = t1) {
+    t1 = (t0 + rows < y1) ? t0 + rows : y1;
+
+    // every tile walks all queued layers back to front
+    for(c = 0; c < run_len; c++)
+      blit_band(run_layers[c], t0, t1, band);
+  }
+}
+
+void ViewPort::band_job(void *arg, int band) {
+  ViewPort *scr = (ViewPort*)arg;
+  double start = dtime();
+
+  scr->blit_rows( (band * scr->geo.h) / scr->bands,
+		  ((band + 1) * scr->geo.h) / scr->bands, band );
+
+  scr->band_ms[band] += (dtime() - start) * 1000.0;
+}
+
+void ViewPort::flush_run() {
+
+  if(!run_len) return;
+
+  composite_stats.start();
+  lock();
+  if(pool)
+    pool->run(&ViewPort::band_job, this, bands);
+  else
+    band_job(this, 0);
+  unlock();
+  composite_stats.stop();
+
+  run_len = 0;
+}
+
 
 void ViewPort::handle_resize() {
   lock ();
@@ -33,6 +33,7 @@ JSFunctionSpec screen_methods[] = {
   {"add_layer",         screen_add_layer,       1},
   {"rem_layer",         screen_rem_layer,       1},
   {"save_frame",        screen_save_frame,      1},
+  {"set_compositor",    screen_set_compositor,  1},
   {0}
 };
 
@@ -42,6 +43,7 @@ JSPropertySpec screen_properties[] = {
   { "h",           1, JSPROP_ENUMERATE | JSPROP_PERMANENT | JSPROP_READONLY, screen_get_height, NULL },
   { "layers",      2, JSPROP_ENUMERATE | JSPROP_PERMANENT | JSPROP_READONLY, screen_list_layers, NULL },
   { "initialized", 3, JSPROP_ENUMERATE | JSPROP_PERMANENT | JSPROP_READONLY, screen_initialized, NULL },
+  { "band_times",  4, JSPROP_ENUMERATE | JSPROP_PERMANENT | JSPROP_READONLY, screen_band_times, NULL },
   {0}
 };
 
@@ -131,6 +133,41 @@ JS(screen_save_frame) {
 }
 
 
+JS(screen_set_compositor) {
+  func("%s",__PRETTY_FUNCTION__);
+  ViewPort::compositor_t mode;
+  jsint threads = 0;
+
+  JS_BeginRequest(cx);
+  JS_CHECK_ARGC(1);
+
+  ViewPort *screen = (ViewPort*)JS_GetPrivate(cx,obj);
+  if(!screen) {
+    JS_ERROR("Screen core data is NULL");
+    return JS_FALSE;
+  }
+
+  char *name = js_get_string(argv[0]);
+  if(argc > 1)
+    threads = js_get_int(argv[1]);
+  JS_EndRequest(cx);
+
+  if(strcasecmp(name, "serial") == 0)
+    mode = ViewPort::SERIAL;
+  else if(strcasecmp(name, "fused") == 0)
+    mode = ViewPort::FUSED;
+  else if(strcasecmp(name, "bands") == 0)
+    mode = ViewPort::BANDS;
+  else {
+    error("unknown compositor %s, use \"serial\", \"fused\" or \"bands\"", name);
+    return JS_FALSE;
+  }
+
+  *rval = BOOLEAN_TO_JSVAL(screen->set_compositor(mode, threads));
+  return JS_TRUE;
+}
+
+
 JS(screen_add_layer) {
   func("%s",__PRETTY_FUNCTION__);
 
@@ -290,4 +327,37 @@ JSP(screen_list_layers) {
   JS_EndRequest(cx);
   //JS_ClearContextThread(cx);
   return JS_TRUE;
-}
\ No newline at end of file
+}
+
+JSP(screen_band_times) {
+  func("%s",__PRETTY_FUNCTION__);
+  JSObject *arr;
+  jsval val;
+  int c;
+
+  JS_BeginRequest(cx);
+  ViewPort *screen = (ViewPort*)JS_GetPrivate(cx,obj);
+  if(!screen) {
+    JS_ERROR("Screen core data is NULL");
+    JS_EndRequest(cx);
+    return JS_TRUE;
+  }
+
+  arr = JS_NewArrayObject(cx, 0, NULL);
+  if(!arr) {
+    JS_EndRequest(cx);
+    return JS_FALSE;
+  }
+
+  // milliseconds spent on each band in the last frame, fused is one band
+  if(screen->get_compositor() != ViewPort::SERIAL) {
+    for(c = 0; c < screen->bands; c++) {
+      JS_NewNumberValue(cx, (jsdouble)screen->band_ms[c], &val);
+      JS_SetElement(cx, arr, c, &val);
+    }
+  }
+
+  *vp = OBJECT_TO_JSVAL( arr );
+  JS_EndRequest(cx);
+  return JS_TRUE;
+}
@@ -44,31 +44,11 @@ BLIT sdl_rgb(void *src, SDL_Rect *src_rect,
   SDL_FreeSurface( sdl_surf );
 };
 
-BLIT sdl_alpha(void *src, SDL_Rect *src_rect,
-	       SDL_Surface *dst, SDL_Rect *dst_rect,
-	       Geometry *geo, Linklist<Parameter> *params) {
-
-  float alpha = *(float*)(params->begin()->value); // only one value
-  unsigned int int_alpha = (unsigned int) alpha;
-
-  sdl_surf = SDL_CreateRGBSurfaceFrom
-    (src, geo->w, geo->h, geo->bpp,
-     geo->bytewidth, red_bitmask, green_bitmask, blue_bitmask, 0x0);
-
-  SDL_SetAlpha( sdl_surf, SDL_SRCALPHA|SDL_RLEACCEL, int_alpha );  
-
-  SDL_BlitSurface( sdl_surf, src_rect, dst, dst_rect );
-  
-  SDL_FreeSurface( sdl_surf );
-  
-};
-
 BLIT sdl_srcalpha(void *src, SDL_Rect *src_rect,
 		  SDL_Surface *dst, SDL_Rect *dst_rect,
 		  Geometry *geo, Linklist<Parameter> *params) {
 
-  float alpha = *(float*)(params->begin()->value); // only one value
-  unsigned int int_alpha = (unsigned int) alpha;
+  unsigned int int_alpha = blit_param_byte(params); // only one value
 
   sdl_surf = SDL_CreateRGBSurfaceFrom
     (src, geo->w, geo->h, geo->bpp,
@@ -122,17 +102,7 @@ void setup_sdl_blits(Blitter *blitter) {
 
   /////////////
 
-  b = new Blit(); b->set_name("ALPHA");
-  sprintf(b->desc,"alpha blit (SDL)");
-  b->type = Blit::SDL;
-  b->sdl_fun = sdl_alpha;
-  blitter->blitlist.prepend(b);
-  
-  p = new Parameter(Parameter::NUMBER);
-  strcpy(p->name, "alpha");
-  strcpy(p->description, "level of transparency of alpha channel (0.0 - 1.0)");
-  p->multiplier = 255.0;
-  b->parameters.append(p);
+  // ALPHA is a linear blit, see linear_blits.cpp
 
   /////////////
 
@@ -32,7 +32,8 @@
 
 #include <SDL_imageFilter.h>
 #include <SDL_framerate.h>
-#include <SDL_rotozoom.h>
+#include <rotozoom.h>
+#include <worker_pool.h>
 
 #include <jutils.h>
 
@@ -45,8 +46,7 @@ SdlScreen::SdlScreen()
   sdl_screen = NULL;
   emuscr = NULL;
 
-  rotozoom = NULL;
-  pre_rotozoom = NULL;
+  roto_pool = NULL;
 
   dbl = false;
   sdl_flags = (SDL_HWSURFACE | SDL_DOUBLEBUF | SDL_HWACCEL );
@@ -59,6 +59,7 @@ SdlScreen::SdlScreen()
 }
 
 SdlScreen::~SdlScreen() {
+  if(roto_pool) delete roto_pool;
   SDL_Quit();
 }
 
@@ -105,6 +106,8 @@ void SdlScreen::setup_blits(Layer *lay) {
 
   setup_sdl_blits(b);
 
+  setup_mixer_blits(b);
+
   lay->blitter = b;
 
   lay->set_blit("SDL"); // default
@@ -114,39 +117,45 @@ void SdlScreen::blit(Layer *src) {
   register int16_t c;
   void *offset;
   Blit *b;
+  RotoZoom *roto = NULL;
+  WorkerPool *roto_workers = NULL;
 
   if(src->rotating | src->zooming) {
 
-    // if we have to rotate or scale,
-    // create a sdl surface from current pixel buffer
-    pre_rotozoom = SDL_CreateRGBSurfaceFrom
-      (src->buffer,
-       src->geo.w, src->geo.h, src->geo.bpp,
-       src->geo.bytewidth, red_bitmask, green_bitmask, blue_bitmask, alpha_bitmask);
-    
-    if(src->rotating) {
-      
-      rotozoom =
-	rotozoomSurface(pre_rotozoom, src->rotate, src->zoom_x, (int)src->antialias);
-
-    } else if(src->zooming) {
-      
-      rotozoom =
-	zoomSurface(pre_rotozoom, src->zoom_x, src->zoom_y, (int)src->antialias);
-      
+    // if we have to rotate or scale, the engine of the layer
+    // samples its frame directly in the blit, keeping its buffers
+    if(!src->blitter->rotozoom)
+      src->blitter->rotozoom = new RotoZoom();
+    roto = src->blitter->rotozoom;
+
+    // the compositor threads are idle while a layer is blitted whole,
+    // the screen has its own only when compositing serially
+    if(pool) {
+      if(roto_pool) { delete roto_pool; roto_pool = NULL; }
+      roto_workers = pool;
+    } else {
+      if(!roto_pool) {
+	roto_pool = new WorkerPool();
+	roto_pool->init();
+      }
+      roto_workers = roto_pool;
     }
-    
-    offset = rotozoom->pixels;
-    // free the temporary surface (needed again in sdl blits)
-    src->geo_rotozoom.init( rotozoom->w, rotozoom->h, src->geo.bpp);
 
+    // sets geo_rotozoom, crop again if the bounds changed
+    if( roto->setup(src) )
+      src->need_crop = true;
 
-  } else offset = src->buffer;
+  }
 
+  offset = src->buffer;
 
 
-  if(src->need_crop)
+
+  if(src->need_crop) {
+    src->lock(); // the layer can change its geometry
     src->blitter->crop( src, this );
+    src->unlock();
+  }
 
   b = src->current_blit;
 
@@ -156,7 +165,13 @@ void SdlScreen::blit(Layer *src) {
 //   }
 
   // executes LINEAR blit
-  if( b->type == Blit::LINEAR ) {
+  if( b->type == Blit::LINEAR && roto ) {
+
+    // rotated rows are sampled and blitted in place
+    if(!src->hidden)
+      roto->blit(b, get_surface(), roto_workers);
+
+  } else if( b->type == Blit::LINEAR ) {
     
     pscr = (uint32_t*) get_surface() + b->scr_offset;
     play = (uint32_t*) offset        + b->lay_offset;
@@ -174,9 +189,22 @@ void SdlScreen::blit(Layer *src) {
       play += b->lay_stride + b->lay_pitch;
     }
     
+    // executes MIXER blit, on the whole rotated frame
+  } else if (b->type == Blit::MIXER) {
+
+    if(roto) offset = roto->render(roto_workers);
+
+    play = (uint32_t*) offset + b->lay_offset;
+    pscr = (uint32_t*) get_surface() + b->scr_offset;
+    if( !src->hidden && mixer_blit_prepare(b, play, pscr, 1) )
+      mixer_blit_rows(b, play, pscr, b->lay_height, 0);
+
     // executes SDL blit
   } else if (b->type == Blit::SDL) {
 
+    // sdl blits need the whole rotated frame
+    if(roto) offset = roto->render(roto_workers);
+
     if (src->blitter->geo)
         (*b->sdl_fun)
           (offset, &b->sdl_rect, sdl_screen,
@@ -211,14 +239,6 @@ void SdlScreen::blit(Layer *src) {
 //     }
 //   }
 
-  // free rotozooming temporary surface
-  if(rotozoom) {
-    SDL_FreeSurface(pre_rotozoom);
-    pre_rotozoom = NULL;
-    SDL_FreeSurface(rotozoom);
-    rotozoom = NULL;
-  }
-  
 }
 
 void SdlScreen::resize(int resize_w, int resize_h) {
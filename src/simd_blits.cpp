@@ -0,0 +1,208 @@
+/*  FreeJ - SIMD linear blits
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include <jutils.h>
+#include <blitter.h>
+#include <screen.h>
+#include <cpu_accel.h>
+
+/* The kernels are compiled for each instruction set with a function
+   target attribute, so the whole file builds with the default flags
+   and the right version is picked at runtime by setup_linear_blits()
+   according to what mm_accel() finds on the cpu. */
+
+#if defined(ARCH_X86) && defined(__GNUC__)
+
+#include <emmintrin.h>
+#include <immintrin.h>
+
+// scalar byte operations used for the tails, same as sdl_gfx
+static inline uint8_t byte_add(int a, int b) {
+  return (a + b > 255) ? 255 : a + b;
+}
+static inline uint8_t byte_sub(int a, int b) {
+  return (a - b < 0) ? 0 : a - b;
+}
+static inline uint8_t byte_mult(int a, int b) {
+  return (a * b > 255) ? 255 : a * b;
+}
+
+/////////////////////////////// SSE2
+
+#define TARGET __attribute__((target("sse2")))
+#define KERNEL(name) sse2_##name
+#define V __m128i
+#define VLEN 16
+#define ZERO _mm_setzero_si128()
+#define LD(p) _mm_loadu_si128((const __m128i*)(p))
+#define ST(p, v) _mm_storeu_si128((__m128i*)(p), v)
+#define SET8(x) _mm_set1_epi8((char)(x))
+#define SET16(x) _mm_set1_epi16((short)(x))
+#define SET32(x) _mm_set1_epi32((int)(x))
+#define ADD8(a, b) _mm_add_epi8(a, b)
+#define ADD16(a, b) _mm_add_epi16(a, b)
+#define ADDS8(a, b) _mm_adds_epu8(a, b)
+#define SUBS8(a, b) _mm_subs_epu8(a, b)
+#define MAX8(a, b) _mm_max_epu8(a, b)
+#define CMPEQ8(a, b) _mm_cmpeq_epi8(a, b)
+#define CMPEQ16(a, b) _mm_cmpeq_epi16(a, b)
+#define AND(a, b) _mm_and_si128(a, b)
+#define OR(a, b) _mm_or_si128(a, b)
+#define XOR(a, b) _mm_xor_si128(a, b)
+#define ANDNOT(a, b) _mm_andnot_si128(a, b)
+#define SRL16(v, n) _mm_srl_epi16(v, _mm_cvtsi32_si128(n))
+#define SLL16(v, n) _mm_sll_epi16(v, _mm_cvtsi32_si128(n))
+#define MULLO16(a, b) _mm_mullo_epi16(a, b)
+#define UNPACKLO8(a, b) _mm_unpacklo_epi8(a, b)
+#define UNPACKHI8(a, b) _mm_unpackhi_epi8(a, b)
+#define PACKUS16(a, b) _mm_packus_epi16(a, b)
+
+#include "simd_kernels.h"
+
+#undef TARGET
+#undef KERNEL
+#undef V
+#undef VLEN
+#undef ZERO
+#undef LD
+#undef ST
+#undef SET8
+#undef SET16
+#undef SET32
+#undef ADD8
+#undef ADD16
+#undef ADDS8
+#undef SUBS8
+#undef MAX8
+#undef CMPEQ8
+#undef CMPEQ16
+#undef AND
+#undef OR
+#undef XOR
+#undef ANDNOT
+#undef SRL16
+#undef SLL16
+#undef MULLO16
+#undef UNPACKLO8
+#undef UNPACKHI8
+#undef PACKUS16
+
+/////////////////////////////// AVX2
+
+/* unpack and pack work inside each 128 bit lane on AVX2, since the
+   kernels always unpack and pack back in pairs the byte order of the
+   result is preserved */
+#define TARGET __attribute__((target("avx2")))
+#define KERNEL(name) avx2_##name
+#define V __m256i
+#define VLEN 32
+#define ZERO _mm256_setzero_si256()
+#define LD(p) _mm256_loadu_si256((const __m256i*)(p))
+#define ST(p, v) _mm256_storeu_si256((__m256i*)(p), v)
+#define SET8(x) _mm256_set1_epi8((char)(x))
+#define SET16(x) _mm256_set1_epi16((short)(x))
+#define SET32(x) _mm256_set1_epi32((int)(x))
+#define ADD8(a, b) _mm256_add_epi8(a, b)
+#define ADD16(a, b) _mm256_add_epi16(a, b)
+#define ADDS8(a, b) _mm256_adds_epu8(a, b)
+#define SUBS8(a, b) _mm256_subs_epu8(a, b)
+#define MAX8(a, b) _mm256_max_epu8(a, b)
+#define CMPEQ8(a, b) _mm256_cmpeq_epi8(a, b)
+#define CMPEQ16(a, b) _mm256_cmpeq_epi16(a, b)
+#define AND(a, b) _mm256_and_si256(a, b)
+#define OR(a, b) _mm256_or_si256(a, b)
+#define XOR(a, b) _mm256_xor_si256(a, b)
+#define ANDNOT(a, b) _mm256_andnot_si256(a, b)
+#define SRL16(v, n) _mm256_srl_epi16(v, _mm_cvtsi32_si128(n))
+#define SLL16(v, n) _mm256_sll_epi16(v, _mm_cvtsi32_si128(n))
+#define MULLO16(a, b) _mm256_mullo_epi16(a, b)
+#define UNPACKLO8(a, b) _mm256_unpacklo_epi8(a, b)
+#define UNPACKHI8(a, b) _mm256_unpackhi_epi8(a, b)
+#define PACKUS16(a, b) _mm256_packus_epi16(a, b)
+
+#include "simd_kernels.h"
+
+#undef TARGET
+#undef KERNEL
+
+// name of the blit and its kernel for each instruction set
+struct simd_blit_t {
+  const char *name;
+  blit_f *sse2;
+  blit_f *avx2;
+};
+
+#define SIMD_BLIT(name, kernel) { name, sse2_##kernel, avx2_##kernel }
+
+static const simd_blit_t simd_blits[] = {
+  SIMD_BLIT("XOR", xor),
+  SIMD_BLIT("ADD", add),
+  SIMD_BLIT("SUB", sub),
+  SIMD_BLIT("MEAN", mean),
+  SIMD_BLIT("ABSDIFF", absdiff),
+  SIMD_BLIT("MULT", mult),
+  SIMD_BLIT("MULTNOR", multnor),
+  SIMD_BLIT("MULTDIV2", multdiv2),
+  SIMD_BLIT("MULTDIV4", multdiv4),
+  SIMD_BLIT("AND", and),
+  SIMD_BLIT("OR", or),
+  SIMD_BLIT("ALPHA", alpha),
+  SIMD_BLIT("RED", red_channel),
+  SIMD_BLIT("GREEN", green_channel),
+  SIMD_BLIT("BLUE", blue_channel),
+  SIMD_BLIT("REDMASK", red_mask),
+  SIMD_BLIT("GREENMASK", green_mask),
+  SIMD_BLIT("BLUEMASK", blue_mask),
+  SIMD_BLIT("NEG", neg),
+  SIMD_BLIT("ADDB", addbyte),
+  SIMD_BLIT("ADDBH", addbytetohalf),
+  SIMD_BLIT("SUBB", subbyte),
+  SIMD_BLIT("SHL", shl),
+  SIMD_BLIT("SHLB", shlb),
+  SIMD_BLIT("SHR", shr),
+  SIMD_BLIT("MULB", mulbyte),
+  SIMD_BLIT("BIN", binarize),
+  { NULL, NULL, NULL }
+};
+
+blit_f *accel_linear_blit(const char *name, uint32_t accel) {
+  const simd_blit_t *b;
+
+  if( ! (accel & (MM_ACCEL_X86_SSE2 | MM_ACCEL_X86_AVX2)) )
+    return NULL;
+
+  for(b = simd_blits; b->name; b++) {
+    if(strcmp(b->name, name) != 0) continue;
+    if(accel & MM_ACCEL_X86_AVX2) return b->avx2;
+    return b->sse2;
+  }
+
+  return NULL;
+}
+
+#else
+
+blit_f *accel_linear_blit(const char *name, uint32_t accel) {
+  return NULL;
+}
+
+#endif
@@ -0,0 +1,240 @@
+/*  FreeJ - SIMD linear blit kernels
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/* No include guard: this file is included by simd_blits.cpp once for
+   every instruction set, after defining the vector macros (V, VLEN,
+   LD, ST, SET8 ...), the TARGET attribute and the KERNEL(name) suffix.
+   Each kernel runs the vector loop and finishes the row with the
+   scalar byte operations shared by all instruction sets, so that the
+   result is bit-exact with the reference blits in linear_blits.cpp */
+
+// widen the low/high bytes of a vector to 16 bit words
+#define LO16(v) UNPACKLO8(v, ZERO)
+#define HI16(v) UNPACKHI8(v, ZERO)
+
+// clamp 16 bit words to 255
+#define SAT16(p) OR(AND(p, CMPEQ16(SRL16(p, 8), ZERO)), \
+                    ANDNOT(CMPEQ16(SRL16(p, 8), ZERO), SET16(255)))
+
+// bytewise logical shift right
+#define SRL8(v, n) AND(SRL16(v, n), SET8(0xff >> (n)))
+
+#define SIMD_LOOP(op) \
+  register uint8_t *s = (uint8_t*)src; \
+  register uint8_t *d = (uint8_t*)dst; \
+  register int c; \
+  for(c = bytes; c >= VLEN; c -= VLEN, s += VLEN, d += VLEN) { op; } \
+  bytes = c;
+
+TARGET static void KERNEL(xor)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  SIMD_LOOP( ST(d, XOR(LD(d), LD(s))) );
+  for(; bytes > 0; bytes--, s++, d++) *d ^= *s;
+}
+
+TARGET static void KERNEL(add)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  SIMD_LOOP( ST(d, ADDS8(LD(s), LD(d))) );
+  for(; bytes > 0; bytes--, s++, d++) *d = byte_add(*s, *d);
+}
+
+TARGET static void KERNEL(sub)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  SIMD_LOOP( ST(d, SUBS8(LD(s), LD(d))) );
+  for(; bytes > 0; bytes--, s++, d++) *d = byte_sub(*s, *d);
+}
+
+TARGET static void KERNEL(mean)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  SIMD_LOOP( ST(d, ADD8(SRL8(LD(s), 1), SRL8(LD(d), 1))) );
+  for(; bytes > 0; bytes--, s++, d++) *d = (*s >> 1) + (*d >> 1);
+}
+
+TARGET static void KERNEL(absdiff)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  V vs, vd;
+  SIMD_LOOP( vs = LD(s); vd = LD(d); ST(d, OR(SUBS8(vs, vd), SUBS8(vd, vs))) );
+  for(; bytes > 0; bytes--, s++, d++) *d = (*s > *d) ? *s - *d : *d - *s;
+}
+
+TARGET static void KERNEL(mult)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  V vs, vd, lo, hi;
+  SIMD_LOOP( vs = LD(s); vd = LD(d);
+             lo = MULLO16(LO16(vs), LO16(vd));
+             hi = MULLO16(HI16(vs), HI16(vd));
+             ST(d, PACKUS16(SAT16(lo), SAT16(hi))) );
+  for(; bytes > 0; bytes--, s++, d++) *d = byte_mult(*s, *d);
+}
+
+TARGET static void KERNEL(multnor)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  V vs, vd, lo, hi;
+  SIMD_LOOP( vs = LD(s); vd = LD(d);
+             lo = AND(MULLO16(LO16(vs), LO16(vd)), SET16(0xff));
+             hi = AND(MULLO16(HI16(vs), HI16(vd)), SET16(0xff));
+             ST(d, PACKUS16(lo, hi)) );
+  for(; bytes > 0; bytes--, s++, d++) *d = (uint8_t)(*s * *d);
+}
+
+TARGET static void KERNEL(multdiv2)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  V vs, vd, lo, hi;
+  SIMD_LOOP( vs = SRL8(LD(s), 1); vd = LD(d);
+             lo = MULLO16(LO16(vs), LO16(vd));
+             hi = MULLO16(HI16(vs), HI16(vd));
+             ST(d, PACKUS16(SAT16(lo), SAT16(hi))) );
+  for(; bytes > 0; bytes--, s++, d++) *d = byte_mult(*s >> 1, *d);
+}
+
+TARGET static void KERNEL(multdiv4)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  V vs, vd, lo, hi;
+  SIMD_LOOP( vs = SRL8(LD(s), 1); vd = SRL8(LD(d), 1);
+             lo = MULLO16(LO16(vs), LO16(vd));
+             hi = MULLO16(HI16(vs), HI16(vd));
+             ST(d, PACKUS16(SAT16(lo), SAT16(hi))) );
+  for(; bytes > 0; bytes--, s++, d++) *d = byte_mult(*s >> 1, *d >> 1);
+}
+
+TARGET static void KERNEL(and)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  SIMD_LOOP( ST(d, AND(LD(s), LD(d))) );
+  for(; bytes > 0; bytes--, s++, d++) *d &= *s;
+}
+
+TARGET static void KERNEL(or)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  SIMD_LOOP( ST(d, OR(LD(s), LD(d))) );
+  for(; bytes > 0; bytes--, s++, d++) *d |= *s;
+}
+
+TARGET static void KERNEL(alpha)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  unsigned int a = blit_param_byte(params);
+  V vs, vd, va, vb, lo, hi;
+  a += a >> 7;
+  va = SET16(a);
+  vb = SET16(256 - a);
+  SIMD_LOOP( vs = LD(s); vd = LD(d);
+             lo = SRL16(ADD16(MULLO16(LO16(vs), va), MULLO16(LO16(vd), vb)), 8);
+             hi = SRL16(ADD16(MULLO16(HI16(vs), va), MULLO16(HI16(vd), vb)), 8);
+             ST(d, PACKUS16(lo, hi)) );
+  for(; bytes > 0; bytes--, s++, d++) *d = (*s * a + *d * (256 - a)) >> 8;
+}
+
+// single channel copy: keep the other channels of the screen
+#define CHANNEL_KERNEL(name, chan) \
+TARGET static void KERNEL(name)(void *src, void *dst, int bytes, Linklist<Parameter> *params) { \
+  V m = SET32(0xffU << ((chan) << 3)); \
+  SIMD_LOOP( ST(d, OR(AND(LD(s), m), ANDNOT(m, LD(d)))) ); \
+  for(; bytes >= 4; bytes -= 4, s += 4, d += 4) \
+    *(d + (chan)) = *(s + (chan)); \
+}
+CHANNEL_KERNEL(red_channel, rchan)
+CHANNEL_KERNEL(green_channel, gchan)
+CHANNEL_KERNEL(blue_channel, bchan)
+#undef CHANNEL_KERNEL
+
+// channel mask ored on the screen, then binarized with a threshold
+#define MASK_KERNEL(chan, bitmask) \
+TARGET static void KERNEL(chan)(void *src, void *dst, int bytes, Linklist<Parameter> *params) { \
+  uint8_t t = blit_param_byte(params); \
+  V m = SET32(bitmask); \
+  V vt = SET8(t); \
+  V vd; \
+  SIMD_LOOP( vd = OR(LD(d), AND(LD(s), m)); \
+             ST(d, CMPEQ8(MAX8(vd, vt), vd)) ); \
+  for(; bytes >= 4; bytes -= 4, s += 4, d += 4) { \
+    *(uint32_t*)d |= *(uint32_t*)s & bitmask; \
+    d[0] = (d[0] >= t) ? 255 : 0; d[1] = (d[1] >= t) ? 255 : 0; \
+    d[2] = (d[2] >= t) ? 255 : 0; d[3] = (d[3] >= t) ? 255 : 0; \
+  } \
+  for(; bytes > 0; bytes--, d++) *d = (*d >= t) ? 255 : 0; \
+}
+MASK_KERNEL(red_mask, red_bitmask)
+MASK_KERNEL(green_mask, green_bitmask)
+MASK_KERNEL(blue_mask, blue_bitmask)
+#undef MASK_KERNEL
+
+/* ====== non-transparent blits, the screen is overwritten */
+
+TARGET static void KERNEL(neg)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  SIMD_LOOP( ST(d, XOR(LD(s), SET8(0xff))) );
+  for(; bytes > 0; bytes--, s++, d++) *d = ~*s;
+}
+
+TARGET static void KERNEL(addbyte)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  uint8_t v = blit_param_byte(params);
+  V vv = SET8(v);
+  SIMD_LOOP( ST(d, ADDS8(LD(s), vv)) );
+  for(; bytes > 0; bytes--, s++, d++) *d = byte_add(*s, v);
+}
+
+TARGET static void KERNEL(addbytetohalf)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  uint8_t v = blit_param_byte(params);
+  V vv = SET8(v);
+  SIMD_LOOP( ST(d, ADDS8(SRL8(LD(s), 1), vv)) );
+  for(; bytes > 0; bytes--, s++, d++) *d = byte_add(*s >> 1, v);
+}
+
+TARGET static void KERNEL(subbyte)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  uint8_t v = blit_param_byte(params);
+  V vv = SET8(v);
+  SIMD_LOOP( ST(d, SUBS8(LD(s), vv)) );
+  for(; bytes > 0; bytes--, s++, d++) *d = byte_sub(*s, v);
+}
+
+TARGET static void KERNEL(shl)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  uint8_t n = blit_param_byte(params);
+  V vs, over;
+  if((n > 8) || (n < 1)) return; // same range as sdl_gfx
+  // bytes from 256>>n up overflow and saturate
+  over = SET8((256 >> n) - 1);
+  SIMD_LOOP( vs = LD(s);
+             ST(d, OR(AND(SLL16(vs, n), SET8((0xff << n) & 0xff)),
+                      XOR(CMPEQ8(MAX8(vs, over), over), SET8(0xff)))) );
+  for(; bytes > 0; bytes--, s++, d++) *d = ((*s << n) > 255) ? 255 : *s << n;
+}
+
+TARGET static void KERNEL(shlb)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  uint8_t n = blit_param_byte(params);
+  if((n > 8) || (n < 1)) return;
+  SIMD_LOOP( ST(d, AND(SLL16(LD(s), n), SET8((0xff << n) & 0xff))) );
+  for(; bytes > 0; bytes--, s++, d++) *d = (*s << n) & 0xff;
+}
+
+TARGET static void KERNEL(shr)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  uint8_t n = blit_param_byte(params);
+  if((n > 8) || (n < 1)) return;
+  SIMD_LOOP( ST(d, SRL8(LD(s), n)) );
+  for(; bytes > 0; bytes--, s++, d++) *d = *s >> n;
+}
+
+TARGET static void KERNEL(mulbyte)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  uint8_t v = blit_param_byte(params);
+  V vs, vv, lo, hi;
+  vv = SET16(v);
+  SIMD_LOOP( vs = LD(s);
+             lo = MULLO16(LO16(vs), vv);
+             hi = MULLO16(HI16(vs), vv);
+             ST(d, PACKUS16(SAT16(lo), SAT16(hi))) );
+  for(; bytes > 0; bytes--, s++, d++) *d = byte_mult(*s, v);
+}
+
+TARGET static void KERNEL(binarize)(void *src, void *dst, int bytes, Linklist<Parameter> *params) {
+  uint8_t t = blit_param_byte(params);
+  V vs, vt = SET8(t);
+  SIMD_LOOP( vs = LD(s); ST(d, CMPEQ8(MAX8(vs, vt), vs)) );
+  for(; bytes > 0; bytes--, s++, d++) *d = (*s >= t) ? 255 : 0;
+}
+
+#undef SIMD_LOOP
+#undef SRL8
+#undef SAT16
+#undef HI16
+#undef LO16
@@ -51,6 +51,8 @@ void SoftScreen::setup_blits(Layer *lay) {
 
   setup_linear_blits(b);
 
+  setup_mixer_blits(b);
+
   lay->blitter = b;
 
   lay->set_blit("RGB"); // default
@@ -73,14 +75,24 @@ void SoftScreen::blit(Layer *src) {
     return;
   }
 
-  if(src->need_crop)
+  if(src->need_crop) {
+    src->lock(); // the layer can change its geometry
     src->blitter->crop( src, this );
+    src->unlock();
+  }
 
   b = src->current_blit;
 
   pscr = (uint32_t*) get_surface() + b->scr_offset;
   play = (uint32_t*) src->buffer   + b->lay_offset;
 
+  // mixers blend the layer with the screen in a pass of their own
+  if(b->type == Blit::MIXER) {
+    if(mixer_blit_prepare(b, play, pscr, 1))
+      mixer_blit_rows(b, play, pscr, b->lay_height, 0);
+    return;
+  }
+
   // iterates the blit on each horizontal line
   for( c = b->lay_height ; c > 0 ; c-- ) {
 
@@ -105,7 +105,10 @@ void TextLayer::close() {
 
   if( TTF_WasInit() ) TTF_Quit();
   // free sdl font surface
+  lock();
   if(surf) SDL_FreeSurface(surf);
+  surf = NULL;
+  unlock();
   if(fontfile) free(fontfile);
   if(fontname) free(fontname);
   FcFini ();
@@ -205,14 +208,14 @@ bool TextLayer::set_fontsize(int sz) {
 
 void TextLayer::_display_text(SDL_Surface *newsurf) {
 
+  // the screen crops the layer and feed() copies the surface under lock
+  lock();
   geo.init( newsurf->w, newsurf->h, 32);
-
-  // we're going to free the memory pointed by Layer::buffer,
-  // NULLify first..
-  buffer = NULL;
+  need_crop = true;
 
   if (surf) SDL_FreeSurface(surf);
   surf = newsurf;
+  unlock();
 
 }
 
@@ -243,10 +246,16 @@ void TextLayer::write(const char *str) {
 }
 
 void *TextLayer::feed() {
-	if(!surf)
-		return NULL;
-	else
-		return surf->pixels;
+	void *slot = NULL;
+
+	// the surface is copied in the frame slot before it can be freed
+	lock();
+	if(surf) {
+		slot = frame_slot();
+		if(slot) jmemcpy(slot, surf->pixels, geo.bytesize);
+	}
+	unlock();
+	return slot;
 }
 
 #endif
@@ -105,6 +105,9 @@ void init_info(oggmux_info *info) {
 
 	memset(info->status, 0x0, 512); // zeroing stats
 
+    pthread_mutex_init(&info->lock, NULL);
+    info->resampled = NULL;
+    info->resampled_size = 0;
 }
 
 void oggmux_setup_kate_streams(oggmux_info *info, int n_kate_streams)
@@ -746,10 +749,12 @@ void oggmux_init (oggmux_info *info){
 void oggmux_add_video (oggmux_info *info, yuv_buffer *yuv, int e_o_s){
     ogg_packet op;
     theora_encode_YUVin (&info->td, yuv);
+    pthread_mutex_lock (&info->lock);
     while(theora_encode_packetout (&info->td, e_o_s, &op)) {
         ogg_stream_packetin (&info->to, &op);
         info->v_pkg++;
     }
+    pthread_mutex_unlock (&info->lock);
 }
 
 
@@ -763,7 +768,8 @@ void oggmux_add_video (oggmux_info *info, yuv_buffer *yuv, int e_o_s){
 void oggmux_add_audio (oggmux_info *info, float * buffer, int bytes, int samples, int e_o_s){
     ogg_packet op;
     float *ptr = buffer;
-    float *sampleOut = NULL;
+    float *sampleOut;
+    size_t size;
     int i,j, c, count = 0;
     float **vorbis_buffer;
 
@@ -773,8 +779,12 @@ void oggmux_add_audio (oggmux_info *info, float * buffer, int bytes, int samples
             vorbis_analysis_wrote (&info->vd, 0);
     }
     else{	//resample code
-      sampleOut = (float *)realloc(sampleOut, ((samples * info->channels * sizeof(float)) \
-	    + (1.2 * ((samples * info->channels * sizeof(float))))));
+      size = (size_t)(2.2 * samples * info->channels * sizeof(float));
+      if(info->resampled_size < size) {
+        info->resampled = (float *)realloc(info->resampled, size);
+        info->resampled_size = size;
+      }
+      sampleOut = info->resampled;
       memset(src_data, 0, sizeof(SRC_DATA));
       src_data->data_in = buffer;
       src_data->input_frames = (long)samples;
@@ -806,10 +816,12 @@ void oggmux_add_audio (oggmux_info *info, float * buffer, int bytes, int samples
 
 	int bet;
         /* weld packets into the bitstream */
+	pthread_mutex_lock (&info->lock);
 	while ((bet = vorbis_bitrate_flushpacket (&info->vd, &op)) == 1){
             ogg_stream_packetin (&info->vo, &op);
 	    info->a_pkg++;
         }
+	pthread_mutex_unlock (&info->lock);
         if (bet && OV_EINVAL)
           std::cerr << std::endl << "vorbis_analysis_blockout :Invalid parameters." << std::endl << std::flush;
         else if (bet && OV_EFAULT)
@@ -1028,13 +1040,23 @@ double _fabs (double val)
     return (-val);
 }
 
-void oggmux_flush (oggmux_info *info, int e_o_s)
+/*
+ * pages are written only when the ringbuffer has room for them: the
+ * lock is shared with the threads adding packets and the ringbuffer is
+ * drained by the encoder thread, so waiting here could block both.
+ * A page that doesn't fit stays valid and is written by the next flush,
+ * the ones after it wait in the ogg streams.
+ * Returns 1 if pages are left waiting for room in the ringbuffer.
+ */
+int oggmux_flush (oggmux_info *info, int e_o_s)
 {
     int len;
 //     ogg_page ogv, ogt;
     ogg_page og;
     int best;
+    int pending = 0;
     
+    pthread_mutex_lock (&info->lock);
     /* flush out the ogg pages to info->outfile */
     while(1) {
       /* Get pages for both streams, if not already present, and if available.*/
@@ -1150,6 +1172,15 @@ void oggmux_flush (oggmux_info *info, int e_o_s)
 
       best=find_best_valid_kate_page(info);
 
+      // the page chosen below must fit whole in the ringbuffer
+      len = 0;
+      if(info->videopage_valid && !info->audio_only) len = info->videopage_len;
+      else if(info->audiopage_valid && !info->video_only) len = info->audiopage_len;
+      if(len && ringbuffer_write_space(info->ringbuffer) < (size_t)len) {
+        pending = 1;
+        break;
+      }
+
       if(info->video_only && info->videopage_valid) {
 //         CHECK_KATE_OUTPUT(video);
         write_video_page(info);
@@ -1189,6 +1220,8 @@ void oggmux_flush (oggmux_info *info, int e_o_s)
         break; /* Nothing more writable at the moment */
       }
     }
+    pthread_mutex_unlock (&info->lock);
+    return pending;
 }
 
 void oggmux_close (oggmux_info *info){
@@ -1235,4 +1268,7 @@ void oggmux_close (oggmux_info *info){
         if(info->kate_streams[n].katepage)
           free(info->kate_streams[n].katepage);
     }
+    pthread_mutex_destroy(&info->lock);
+    if(info->resampled)
+        free(info->resampled);
 }
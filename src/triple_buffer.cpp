@@ -0,0 +1,102 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <triple_buffer.h>
+#include <jutils.h>
+#include <config.h>
+
+// set on the middle index when it holds a frame not yet taken
+#define FRESH 4
+
+// atomic exchange with a full memory barrier, so that the frame
+// written in a slot is visible before its index is
+static inline int swap_index(volatile int *ptr, int val) {
+  __sync_synchronize();
+  return __sync_lock_test_and_set(ptr, val);
+}
+
+TripleBuffer::TripleBuffer() {
+  int c;
+  for(c = 0; c < 3; c++) {
+    slot[c] = NULL;
+    slot_size[c] = 0;
+    slot_alloc[c] = 0;
+  }
+  back_idx = 0;
+  middle = 1;
+  front_idx = 2;
+
+  published = 0;
+  dropped = 0;
+}
+
+TripleBuffer::~TripleBuffer() {
+  int c;
+  for(c = 0; c < 3; c++)
+    if(slot[c]) free(slot[c]);
+}
+
+void *TripleBuffer::back(size_t bytes) {
+  // only the producer touches the back slot, it can be reallocated
+  if(slot_alloc[back_idx] < bytes) {
+    slot[back_idx] = realloc(slot[back_idx], bytes);
+    slot_alloc[back_idx] = bytes;
+  }
+  return slot[back_idx];
+}
+
+void TripleBuffer::publish(void *frame, size_t bytes) {
+  void *dst;
+  int prev;
+
+  if(!frame || !bytes) return;
+
+  if(frame == slot[back_idx]) {
+    // rendered in the slot: growing it now would free the frame
+    if(bytes > slot_alloc[back_idx]) {
+      error("frame of %u bytes overflows its slot", (unsigned int)bytes);
+      return;
+    }
+  } else {
+    dst = back(bytes);
+    if(!dst) {
+      error("can't allocate frame slot of %u bytes", (unsigned int)bytes);
+      return;
+    }
+    jmemcpy(dst, frame, bytes);
+  }
+  slot_size[back_idx] = bytes;
+
+  prev = swap_index(&middle, back_idx | FRESH);
+  back_idx = prev & ~FRESH;
+
+  published++;
+  if(prev & FRESH) dropped++;
+}
+
+void *TripleBuffer::front(size_t *bytes) {
+
+  if(middle & FRESH)
+    front_idx = swap_index(&middle, front_idx) & ~FRESH;
+
+  if(!slot_size[front_idx]) return NULL;
+
+  if(bytes) *bytes = slot_size[front_idx];
+  return slot[front_idx];
+}
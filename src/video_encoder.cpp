@@ -27,6 +27,7 @@
 #include <context.h>
 
 #include <video_encoder.h>
+#include <buffer_pool.h>
 
 
 #include <convertvid.h>
@@ -79,12 +80,18 @@ VideoEncoder::VideoEncoder()
 
   initialized = false;
   encbuf = NULL;
+  encbuf_size = 0;
+  headers = NULL;
+  headers_len = 0;
+  headers_skip = 0;
   use_audio = false;
 
   write_to_disk   = false;
   write_to_stream = false;
 
-  filedump_fd = NULL;
+  file_sink = NULL;
+  stream_sink = NULL;
+  last_sink_id = 0;
 
   status = NULL;
   audio_kbps = 0;
@@ -93,9 +100,30 @@ VideoEncoder::VideoEncoder()
   m_ElapsedTime = 0;
   m_Streamed = 0;
   enc_y = enc_u = enc_v = NULL;
+  snapshot = NULL;
+  snapshot_size = 0;
+
+  frame_pool = NULL;
+  last = NULL;
+  master = NULL;
+  num_renditions = 0;
+  enc_w = enc_h = 0;
+  encoding = false;
+  drop_policy = DROP_NEWEST;
+  duplicate = true;
+  frames_captured = frames_encoded = 0;
+  frames_dropped = frames_duplicated = 0;
+  last_missed = 0;
 
   fps = new FPS();
   fps->init(25); // default FPS
+
+  // half of the cpus convert, the rest is left to the compositor
+  if(online_cpus() / 2 > 1)
+    convert_pool.init(online_cpus() / 2 - 1);
+
+  convert_stats.init(this, "convert");
+  encode_stats.init(this, "encode");
   // initialize the encoded data pipe
   // TODO: set the size to width * height * 4 * nframes (3-4)
   ringbuffer = ringbuffer_create(1048*2096);
@@ -126,34 +154,37 @@ VideoEncoder::VideoEncoder()
 
 VideoEncoder::~VideoEncoder() {
   // flush all the ringbuffer to file and stream
-  int encnum = 0;
+  EncoderSink *sink;
+  char *data;
+  int encnum = 0, c;
+
+  stop();
+  stop_encoding();
 
-  if (encbuf)
+  // the capture is over, the renditions encode what they were given
+  for(c = 0; c < num_renditions; c++)
+    delete renditions[c];
+
+  if (sinks.len())
   {
     do {
-      if (encnum = ringbuffer_read_space(ringbuffer))
-	encnum = ringbuffer_read(ringbuffer, encbuf, encnum);
-// 			     ((audio_kbps + video_kbps)*1024)/24);
+      encnum = read_encoded(&data);
 
       if(encnum <=0) break;
 
-      if(write_to_disk && filedump_fd) {
-	size_t nn;
-	nn = fwrite(encbuf, 1, encnum, filedump_fd);
-      }
-
-      if(write_to_stream && ice) {
-	shout_sync(ice);
-	shout_send(ice, (const unsigned char*)encbuf, encnum);
-      }
+      push_sinks(data, encnum);
 
       func("flushed %u bytes closing video encoder", encnum);
 
     } while(encnum > 0); 
-    free(encbuf);
   }
-  // close the filedump
-  if(filedump_fd) fclose(filedump_fd);
+  if(encbuf) free(encbuf);
+  if(headers) free(headers);
+  // close the sinks, once they delivered what is queued
+  while((sink = sinks.begin())) {
+    sink->rem();
+    delete sink;
+  }
 
   // now deallocate the ringbuffer
   ringbuffer_free(ringbuffer);
@@ -163,12 +194,10 @@ VideoEncoder::~VideoEncoder() {
   //  shout_free(ice);
   shout_shutdown();
 
-  if(enc_y) free(enc_y);
-  if(enc_u) free(enc_u);
-  if(enc_v) free(enc_v);
-  if(enc_yuyv) free(enc_yuyv);
+  if(snapshot) free(snapshot);
+  convert_pool.close();
   
-  free(fps);
+  delete fps;
 }
 
 void VideoEncoder::thread_setup() {
@@ -177,28 +206,17 @@ void VideoEncoder::thread_setup() {
  }
 
 void VideoEncoder::thread_loop() {
-  int encnum;
-  int res;
-  /* Convert picture from rgb to yuv420 planar 
-
-     two steps here:
-     
-     1) rgb24a or bgr24a to yuv422 interlaced (yuyv)
-     2) yuv422 to yuv420 planar (yuv420p)
-
-     to fix endiannes issues try adding #define ARCH_PPC
-     and using 
-     mlt_convert_bgr24a_to_yuv422
-     or
-     mlt_convert_argb_to_yuv422
-     (see mlt_frame.h in mltframework.org sourcecode)
-     i can't tell as i don't have PPC, waiting for u mr.goil :)
+  enc_frame_t *f[ENCODER_MAX_RENDITIONS + 1];
+  uint32_t missed;
+  bool got;
+  /* Capture the screen in yuv420 planar and queue it for encoding
+
+     the screen is copied while locked, so that the compositor waits
+     only for the copy, then converted in a single pass from the copy
+     to the planes (see i420_convert.h)
   */
     
     uint8_t *surface = (uint8_t *)screen->get_surface();
-  time_t *tm = (time_t *)malloc(sizeof(time_t));
-  time (tm);
-//   std::cerr << "-- ENC:" << asctime(localtime(tm));
     if (!surface) {
         fps->calc();
         fps->delay();
@@ -206,6 +224,11 @@ void VideoEncoder::thread_loop() {
 			" tv_usec :" << fps->start_tv.tv_usec << "   \r" << std::endl;
         return;
     }
+    if(!encoding && !start_encoding()) {
+      fps->calc();
+      fps->delay();
+      return;
+    }
     fps->calc();
     fps->delay();
     //uncomment this to see how long it takes between two frames in us.
@@ -216,69 +239,376 @@ void VideoEncoder::thread_loop() {
     m_lastTime.tv_sec = start_t.tv_sec;
     m_lastTime.tv_usec = start_t.tv_usec;
     std::cerr << "diff time :" << did.tv_usec << std::endl;*/
-    screen->lock();
 
-    switch(screen->get_pixel_format()) {
-    case ViewPort::RGBA32:
-      mlt_convert_rgb24a_to_yuv422(surface,
-                   screen->geo.w, screen->geo.h,
-                   screen->geo.w<<2, (uint8_t*)enc_yuyv, NULL);
-      break;
-      
-    case ViewPort::BGRA32:
-      mlt_convert_bgr24a_to_yuv422(surface,
-                   screen->geo.w, screen->geo.h,
-                   screen->geo.w<<2, (uint8_t*)enc_yuyv, NULL);
-      break;
+    // ticks skipped by the pacing since the last capture
+    missed = fps->missed - last_missed;
+    last_missed = fps->missed;
+
+    lock(); // the renditions don't change meanwhile
+
+    // the renditions get the frame all, or none of them
+    if(num_renditions)
+      got = get_ladder(f, drop_policy == DROP_NONE || FPS::is_virtual());
+    else
+      got = ((f[0] = get_frame()) != NULL);
+    if(!got) {
+      drop_ladder(1 + (duplicate ? missed : 0));
+      unlock();
+      return;
+    }
+    if(!capture(f[0])) {
+      put_ladder(f, num_renditions + 1);
+      unlock();
+      return;
+    }
+    scale_ladder(f);
+    queue_ladder(f, false);
+
+    // the stream has a frame for each tick, repeat the last one
+    if(duplicate) {
+      for(; missed > 0; missed--) {
+	if(!get_ladder(f, false)) {
+	  drop_ladder(missed);
+	  break;
+	}
+	queue_ladder(f, true);
+      }
+    }
+    unlock();
+}
+
+bool VideoEncoder::capture(enc_frame_t *f) {
+  uint8_t *surface = (uint8_t *)screen->get_surface();
+
+    convert_stats.start();
+    if(screen->get_pixel_format() == ViewPort::YUV420) {
+      // the screen composites in yuv already: the planes are copied
+      int luma = enc_w * enc_h;
+      screen->lock();
+      jmemcpy(f->y, surface, luma);
+      jmemcpy(f->u, surface + luma, luma >> 2);
+      jmemcpy(f->v, surface + luma + (luma >> 2), luma >> 2);
+      screen->unlock();
+
+    } else {
+
+      if(!converter.set_format(screen->get_pixel_format())) {
+	error("Video Encoder %s doesn't supports Screen %s pixel format",
+	      name, screen->name);
+	convert_stats.stop();
+	return false;
+      }
+
+      if(snapshot_size < screen->geo.bytesize) {
+	snapshot = realloc(snapshot, screen->geo.bytesize);
+	snapshot_size = screen->geo.bytesize;
+      }
+
+      screen->lock();
+      jmemcpy(snapshot, surface, screen->geo.bytesize);
+      screen->unlock();
+
+      converter.convert((uint8_t*)snapshot,
+			screen->geo.w, screen->geo.h, screen->geo.w<<2,
+			f->y, f->u, f->v,
+			convert_pool.threads() ? &convert_pool : NULL);
+    }
+    convert_stats.stop();
+    return true;
+}
+
+VideoEncoder::enc_frame_t *VideoEncoder::get_frame() {
+  enc_frame_t *f;
+
+  // offline every rendered frame is encoded
+  if(drop_policy == DROP_NONE || FPS::is_virtual())
+    return (enc_frame_t*)free_frames.pop();
+
+  f = (enc_frame_t*)free_frames.try_pop();
+  if(!f && drop_policy == DROP_OLDEST) {
+    f = (enc_frame_t*)frames.try_pop();
+    if(f) frames_dropped++;
+  }
+  return f;
+}
+
+bool VideoEncoder::get_ladder(enc_frame_t **f, bool wait) {
+  VideoEncoder *enc;
+  int c;
+
+  for(c = 0; c <= num_renditions; c++) {
+    enc = c ? renditions[c - 1] : this;
+    f[c] = (enc_frame_t*)(wait ? enc->free_frames.pop() : enc->free_frames.try_pop());
+    if(!f[c]) {
+      put_ladder(f, c);
+      return false;
+    }
+  }
+  return true;
+}
+
+void VideoEncoder::put_ladder(enc_frame_t **f, int n) {
+  int c;
+  for(c = 0; c < n; c++)
+    (c ? renditions[c - 1] : this)->free_frames.push(f[c]);
+}
+
+void VideoEncoder::drop_ladder(int n) {
+  int c;
+  for(c = 0; c <= num_renditions; c++)
+    (c ? renditions[c - 1] : this)->frames_dropped += n;
+}
+
+void VideoEncoder::scale_ladder(enc_frame_t **f) {
+  VideoEncoder *enc, *from;
+  int c, s;
+
+  if(!num_renditions) return;
+
+  convert_stats.start();
+  for(c = 1; c <= num_renditions; c++) {
+    enc = renditions[c - 1];
+    // from the smallest frame still larger, the screen at worst
+    for(s = c - 1; s > 0; s--) {
+      from = renditions[s - 1];
+      if(from->enc_w >= enc->enc_w && from->enc_h >= enc->enc_h) break;
+    }
+    from = s ? renditions[s - 1] : this;
+    scaler.scale(f[s]->y, f[s]->u, f[s]->v, from->enc_w, from->enc_h,
+		 f[c]->y, f[c]->u, f[c]->v, enc->enc_w, enc->enc_h,
+		 convert_pool.threads() ? &convert_pool : NULL);
+  }
+  convert_stats.stop();
+}
+
+void VideoEncoder::queue_ladder(enc_frame_t **f, bool repeat) {
+  VideoEncoder *enc;
+  int c;
+
+  for(c = 0; c <= num_renditions; c++) {
+    enc = c ? renditions[c - 1] : this;
+    if(repeat) {
+      // the last frame may be encoded and free already
+      if(f[c] != enc->last)
+	jmemcpy(f[c]->y, enc->last->y, enc->enc_w * enc->enc_h * 3 / 2);
+      enc->frames_duplicated++;
+    } else {
+      enc->last = f[c];
+      enc->frames_captured++;
+    }
+    enc->frames.push(f[c]);
+  }
+}
+
+bool VideoEncoder::add_rendition(VideoEncoder *enc, int w, int h) {
+  int c;
+
+  if(!initialized) {
+    error("Encoder %s must be added to a screen before its renditions", name);
+    return false;
+  }
+  if(master) {
+    error("Encoder %s is a rendition, it can't have renditions", name);
+    return false;
+  }
+  if(enc == this || enc->initialized || enc->list || enc->master) {
+    error("Encoder %s is in use already, it can't be a rendition", enc->name);
+    return false;
+  }
+  if(num_renditions >= ENCODER_MAX_RENDITIONS) {
+    error("Encoder %s has %u renditions already", name, num_renditions);
+    return false;
+  }
+
+  // even sizes for 4:2:0, only smaller than the screen
+  w &= ~1;
+  h &= ~1;
+  if(w < 16 || h < 16 || w > enc_w || h > enc_h) {
+    error("rendition of %ux%u is out of the %ux%u of encoder %s",
+	  w, h, enc_w, enc_h, name);
+    return false;
+  }
+
+  enc->master = this;
+  enc->enc_w = w;
+  enc->enc_h = h;
+  if(!enc->init(screen) || !enc->start_encoding()) {
+    error("rendition %s of encoder %s failed initialization", enc->name, name);
+    enc->master = NULL;
+    return false;
+  }
+  enc->active = true;
+
+  // kept from the largest, the smaller ones are scaled from them
+  lock();
+  for(c = num_renditions; c > 0; c--) {
+    if(renditions[c - 1]->enc_w * renditions[c - 1]->enc_h >= w * h) break;
+    renditions[c] = renditions[c - 1];
+  }
+  renditions[c] = enc;
+  num_renditions++;
+  unlock();
+
+  act("Encoder %s renders also %ux%u with %s", name, w, h, enc->name);
+  return true;
+}
+
+bool VideoEncoder::start_encoding() {
+  int c, luma = enc_w * enc_h;
+  uint8_t *buf;
 
-    case ViewPort::ARGB32:
-      mlt_convert_argb_to_yuv422(surface,
-                   screen->geo.w, screen->geo.h,
-                   screen->geo.w<<2, (uint8_t*)enc_yuyv, NULL);
+  if(!frames.init(ENCODER_QUEUE_SIZE) || !free_frames.init(ENCODER_QUEUE_SIZE))
+    return false;
+
+  frame_pool = (enc_frame_t*)calloc(ENCODER_QUEUE_SIZE, sizeof(enc_frame_t));
+  for(c = 0; c < ENCODER_QUEUE_SIZE; c++) {
+    // the frames of a size are reused by the next encoder started
+    buf = (uint8_t*)BufferPool::get(luma * 3 / 2);
+    if(!buf) {
+      error("Video Encoder %s can't allocate its frames", name);
       break;
-      
-    default:
-      error("Video Encoder %s doesn't supports Screen %s pixel format",
-        name, screen->name);
     }
+    frame_pool[c].y = buf;
+    frame_pool[c].u = buf + luma;
+    frame_pool[c].v = buf + luma + (luma >> 2);
+    free_frames.push(&frame_pool[c]);
+  }
+  if(!c) return false;
 
-    screen->unlock();
-    
-    ccvt_yuyv_420p(screen->geo.w, screen->geo.h, enc_yuyv, enc_y, enc_u, enc_v);
+  encoding = true;
+  if(pthread_create(&encode_thread, NULL, &VideoEncoder::encode_run, this) != 0) {
+    error("Video Encoder %s can't create the encoding thread", name);
+    encoding = false;
+    return false;
+  }
+  func("Video Encoder %s queues up to %u frames", name, c);
+  return true;
+}
+
+void VideoEncoder::stop_encoding() {
+  int c;
+
+  if(!encoding) return;
+
+  // what was captured is still encoded
+  while(frames.depth() > 0)
+    jsleep(0, 1000000);
+  frames.abort();
+  free_frames.abort();
+  pthread_join(encode_thread, NULL);
+  encoding = false;
+
+  for(c = 0; c < ENCODER_QUEUE_SIZE; c++)
+    if(frame_pool[c].y) BufferPool::put(frame_pool[c].y);
+  free(frame_pool);
+  frame_pool = NULL;
+  frames.reset();
+  free_frames.reset();
+
+  act("Video Encoder %s: %u frames captured, %u encoded, %u dropped, %u duplicated",
+      name, frames_captured, frames_encoded, frames_dropped, frames_duplicated);
+}
+
+void *VideoEncoder::encode_run(void *arg) {
+  ((VideoEncoder*)arg)->encode_loop();
+  return NULL;
+}
+
+void VideoEncoder::encode_loop() {
+  enc_frame_t *f;
 
-    ////// got the YUV, do the encoding    
-    res = encode_frame();
+  while((f = (enc_frame_t*)frames.pop())) {
+
+    ////// got the YUV, do the encoding
+    enc_y = f->y;
+    enc_u = f->u;
+    enc_v = f->v;
+    encode_stats.start();
+    encode_frame();
+    encode_stats.stop();
+    frames_encoded++;
+
+    free_frames.push(f);
+
+    write_encoded();
+  }
+}
+
+void VideoEncoder::keep_headers() {
+  headers_len = ringbuffer_read_space(ringbuffer);
+  if(!headers_len) return;
+  headers = (char*)realloc(headers, headers_len);
+  ringbuffer_peek(ringbuffer, headers, headers_len);
+  // each sink writes them on its own, the stream goes on without
+  headers_skip = headers_len;
+  func("Video Encoder %s keeps %u bytes of stream headers", name, headers_len);
+}
+
+/*
+ * bytes of the whole ogg pages at the start of buf: the muxer writes a
+ * page at a time but the ringbuffer can be read in the middle of one.
+ * Data that is not ogg is taken as it is.
+ */
+static int ogg_pages_len(const unsigned char *buf, int len) {
+  int pos = 0, segs, body, c;
+
+  while(pos < len) {
+    if(memcmp(buf + pos, "OggS", (len - pos < 4) ? len - pos : 4))
+      return (pos == 0) ? len : pos;
+    if(pos + 27 > len) break; // header not complete
+    segs = buf[pos + 26];
+    if(pos + 27 + segs > len) break;
+    for(body = 0, c = 0; c < segs; c++)
+      body += buf[pos + 27 + c];
+    if(pos + 27 + segs + body > len) break;
+    pos += 27 + segs + body;
+  }
+  return pos;
+}
+
+int VideoEncoder::read_encoded(char **data) {
+  int encnum, skip;
+
+  encnum = ringbuffer_read_space(ringbuffer);
+  if(encnum <= 0) return 0;
+
+  // the buffer only grows, to the largest amount encoded at once
+  if(encbuf_size < encnum) {
+    encbuf = (char *)realloc(encbuf, encnum);
+    encbuf_size = encnum;
+  }
+  // whole pages only, so that sinks dropping chunks drop whole pages,
+  // the rest is read with the next ones
+  encnum = ringbuffer_peek(ringbuffer, encbuf, encnum);
+  encnum = ogg_pages_len((unsigned char*)encbuf, encnum);
+  ringbuffer_read_advance(ringbuffer, encnum);
+  *data = encbuf;
+
+  if(headers_skip) {
+    skip = (encnum < headers_skip) ? encnum : headers_skip;
+    *data += skip;
+    encnum -= skip;
+    headers_skip -= skip;
+  }
+  return encnum;
+}
+
+void VideoEncoder::write_encoded() {
+  char *data;
+  int encnum;
 
     /// proceed writing and streaming encoded data in encpipe
     
-    encnum = 0;
-    if(write_to_disk || write_to_stream) {
-      if (encnum = ringbuffer_read_space(ringbuffer))
-      {
-	encbuf = (char *)realloc(encbuf, encnum);
-// 	encbuf = (char *)realloc(encbuf, (((audio_kbps + video_kbps)*1024)/24)); //doesn't change anything for shifting problem
-	encnum = ringbuffer_read(ringbuffer, encbuf, encnum);
-// 	encnum = ringbuffer_read(ringbuffer, encbuf,
-// 			       ((audio_kbps + video_kbps)*1024)/24);
-      }
-    }
+    // with no one to deliver to, the encoded data is discarded:
+    // the muxer waits for room in the ringbuffer
+    encnum = read_encoded(&data);
+    if(!sinks.len()) return;
 
     if(encnum > 0) {
       //      func("%s has encoded %i bytes", name, encnum);
-      if(write_to_disk && filedump_fd) 
-        fwrite(encbuf, 1, encnum, filedump_fd);
-    
-      if(write_to_stream && ice) {
-/*	int	wait_ms;
-	wait_ms = shout_delay(ice);
-	std::cerr << "---- shout delay :" << wait_ms << std::endl;*/
-	shout_sync(ice);
-        if( shout_send(ice, (const unsigned char*)encbuf, encnum)
-	      != SHOUTERR_SUCCESS) {
-            error("shout_send: %s", shout_get_error(ice));
-        }// else 
-            //printf("%d %d\n", encnum, (int)shout_queuelen(ice));
-      }
+      // encoded once, queued to every file and stream
+      push_sinks(data, encnum);
+
       gettimeofday(&m_ActualTime, NULL);
       if (m_ActualTime.tv_sec == m_OldTime.tv_sec)
 	m_ElapsedTime += ((double)(m_ActualTime.tv_usec - m_OldTime.tv_usec))/1000000.0;
@@ -302,6 +632,82 @@ double VideoEncoder::getStreamRate()
   return (m_StreamRate);
 }
 
+void VideoEncoder::push_sinks(const char *buf, int len) {
+  EncoderSink *sink;
+
+  sinks.lock();
+  sink = sinks.begin();
+  while(sink) {
+    sink->push(buf, len);
+    sink = (EncoderSink*)sink->next;
+  }
+  sinks.unlock();
+}
+
+bool VideoEncoder::add_sink(EncoderSink *sink) {
+  if(!initialized) {
+    error("Encoder %s must be added to a screen before delivering to %s",
+	  name, sink->name);
+    return false;
+  }
+  if(headers_len) sink->set_headers(headers, headers_len);
+  if(!sink->start()) return false;
+
+  sinks.lock();
+  sink->id = ++last_sink_id;
+  sinks.append(sink);
+  sinks.unlock();
+  act("Encoder %s delivers to %s", name, sink->name);
+  return true;
+}
+
+void VideoEncoder::rem_sink(EncoderSink *sink) {
+  sinks.lock();
+  sink->rem();
+  sinks.unlock();
+  // also when removed by a script, or they would be removed again
+  if(sink == file_sink) {
+    file_sink = NULL;
+    write_to_disk = false;
+  }
+  if(sink == stream_sink) {
+    stream_sink = NULL;
+    write_to_stream = false;
+  }
+  // outside of the lock, as the sink may take time to drain
+  delete sink;
+}
+
+EncoderSink *VideoEncoder::get_sink(uint32_t id) {
+  EncoderSink *sink;
+  sinks.lock();
+  sink = sinks.begin();
+  while(sink && sink->id != id)
+    sink = (EncoderSink*)sink->next;
+  sinks.unlock();
+  return sink;
+}
+
+bool VideoEncoder::start_stream() {
+  if(stream_sink) return true;
+
+  stream_sink = new ShoutSink(ice);
+  if(!add_sink(stream_sink)) {
+    delete stream_sink;
+    stream_sink = NULL;
+    return false;
+  }
+  write_to_stream = true;
+  return true;
+}
+
+void VideoEncoder::stop_stream() {
+  write_to_stream = false;
+  if(!stream_sink) return;
+  rem_sink(stream_sink);
+  stream_sink = NULL;
+}
+
 void VideoEncoder::thread_teardown() {
   func("VideoEncoder::run : end thread %p", pthread_self() );
 }
@@ -311,9 +717,9 @@ bool VideoEncoder::set_filedump(const char *filename) {
   FILE *fp;
 
   if(write_to_disk) { // stop current filedump
-    if(filedump_fd) {
-      fclose(filedump_fd);
-      filedump_fd = NULL;
+    if(file_sink) {
+      rem_sink(file_sink);
+      file_sink = NULL;
     }
     act("Encoder %s stopped recording to file %s", name, filedump);
     write_to_disk = false;
@@ -358,9 +764,10 @@ bool VideoEncoder::set_filedump(const char *filename) {
     fp = fopen(filedump, "r");
   }
 
-  filedump_fd = fopen(filedump,"w");
-  if(!filedump_fd) {
-    error("can't record to file %s: %s", filedump_fd, strerror(errno));
+  file_sink = new FileSink(filedump);
+  if(!add_sink(file_sink)) {
+    delete file_sink;
+    file_sink = NULL;
     return false;
   }
 
@@ -377,17 +784,12 @@ bool VideoEncoder::set_filedump(const char *filename) {
 
 bool VideoEncoder::filedump_close()
 {
-  if (filedump_fd)
+  if (file_sink)
   {
-    if (!fclose (filedump_fd))
-    {
-      write_to_disk = false;
-      return (true);
-    }
-    else
-    {
-      std::cerr << "----- can't close :" << filedump << " " << errno << std::endl;
-      return (false);
-    }
+    rem_sink(file_sink);
+    file_sink = NULL;
+    write_to_disk = false;
+    return (true);
   }
+  return (false);
 }
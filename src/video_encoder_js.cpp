@@ -39,6 +39,20 @@ JSFunctionSpec js_vid_enc_methods[] = {
   { "stop_stream", stop_stream, 0},
 
   { "add_audio", vid_enc_add_audio, 1 }, 
+
+  { "drop_policy", vid_enc_drop_policy, 1 },
+  { "duplicate_frames", vid_enc_duplicate_frames, 1 },
+  { "dropped_frames", vid_enc_dropped_frames, 0 },
+
+  { "add_sink", vid_enc_add_sink, 1 },
+  { "remove_sink", vid_enc_remove_sink, 1 },
+  { "sink_rate", vid_enc_sink_rate, 1 },
+  { "sink_queue", vid_enc_sink_queue, 1 },
+  { "sink_dropped", vid_enc_sink_dropped, 1 },
+  { "sink_policy", vid_enc_sink_policy, 2 },
+  { "sink_latency", vid_enc_sink_latency, 2 },
+  { "stream_rate", vid_enc_stream_rate, 0 },
+  { "add_rendition", vid_enc_add_rendition, 3 },
   
   { "stream_host",   stream_host,  1},
   { "stream_port",   stream_port,  1},
@@ -120,6 +134,246 @@ JS(vid_enc_add_audio) {
   return JS_TRUE;
 }
 
+JS(vid_enc_drop_policy) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+
+  JS_CHECK_ARGC(1);
+
+  VideoEncoder *enc = (VideoEncoder*)JS_GetPrivate(cx, obj);
+  if(!enc) {
+    error("%u:%s:%s :: VideoEncoder core data is NULL",
+	  __LINE__,__FILE__,__FUNCTION__);
+    return JS_FALSE;
+  }
+
+  char *policy = js_get_string(argv[0]);
+
+  if(strcmp(policy, "newest") == 0)
+    enc->drop_policy = VideoEncoder::DROP_NEWEST;
+  else if(strcmp(policy, "oldest") == 0)
+    enc->drop_policy = VideoEncoder::DROP_OLDEST;
+  else if(strcmp(policy, "none") == 0)
+    enc->drop_policy = VideoEncoder::DROP_NONE;
+  else {
+    error("VideoEncoder drop policy %s is not newest, oldest or none", policy);
+    return JS_FALSE;
+  }
+
+  return JS_TRUE;
+}
+
+JS(vid_enc_duplicate_frames) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+
+  JS_CHECK_ARGC(1);
+
+  VideoEncoder *enc = (VideoEncoder*)JS_GetPrivate(cx, obj);
+  if(!enc) {
+    error("%u:%s:%s :: VideoEncoder core data is NULL",
+	  __LINE__,__FILE__,__FUNCTION__);
+    return JS_FALSE;
+  }
+
+  JSBool dup;
+  JS_ValueToBoolean(cx, argv[0], &dup);
+  enc->duplicate = dup;
+
+  return JS_TRUE;
+}
+
+JS(vid_enc_dropped_frames) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+
+  VideoEncoder *enc = (VideoEncoder*)JS_GetPrivate(cx, obj);
+  if(!enc) {
+    error("%u:%s:%s :: VideoEncoder core data is NULL",
+	  __LINE__,__FILE__,__FUNCTION__);
+    return JS_FALSE;
+  }
+
+  *rval = INT_TO_JSVAL(enc->frames_dropped);
+  return JS_TRUE;
+}
+
+JS(vid_enc_add_sink) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+
+  JS_CHECK_ARGC(1);
+
+  VideoEncoder *enc = (VideoEncoder*)JS_GetPrivate(cx, obj);
+  if(!enc) {
+    error("%u:%s:%s :: VideoEncoder core data is NULL",
+	  __LINE__,__FILE__,__FUNCTION__);
+    return JS_FALSE;
+  }
+
+  char *url = js_get_string(argv[0]);
+
+  EncoderSink *sink = EncoderSink::create(url);
+  if(!sink) {
+    error("VideoEncoder can't deliver to %s", url);
+    return JS_FALSE;
+  }
+  // an optional second argument makes the encoder wait for the sink
+  if(argc > 1) {
+    JSBool wait;
+    JS_ValueToBoolean(cx, argv[1], &wait);
+    if(wait) sink->policy = EncoderSink::SINK_WAIT;
+  }
+
+  // renditions are fed by their master, they don't capture
+  if(!enc->is_running() && !enc->master) enc->start();
+
+  if(!enc->add_sink(sink)) {
+    delete sink;
+    *rval = INT_TO_JSVAL(0);
+    return JS_TRUE;
+  }
+  // the id stays the same when other sinks are removed, 0 is none
+  *rval = INT_TO_JSVAL(sink->id);
+  return JS_TRUE;
+}
+
+// the sink with the id returned by add_sink, first argument
+static EncoderSink *js_get_sink(JSContext *cx, JSObject *obj, jsval num) {
+  VideoEncoder *enc = (VideoEncoder*)JS_GetPrivate(cx, obj);
+  if(!enc) {
+    error("%u:%s:%s :: VideoEncoder core data is NULL",
+	  __LINE__,__FILE__,__FUNCTION__);
+    return NULL;
+  }
+  EncoderSink *sink = enc->get_sink(js_get_int(num));
+  if(!sink)
+    error("VideoEncoder %s has no sink %i", enc->name, js_get_int(num));
+  return sink;
+}
+
+JS(vid_enc_remove_sink) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+
+  JS_CHECK_ARGC(1);
+
+  VideoEncoder *enc = (VideoEncoder*)JS_GetPrivate(cx, obj);
+  EncoderSink *sink = js_get_sink(cx, obj, argv[0]);
+  if(!enc || !sink) return JS_FALSE;
+
+  enc->rem_sink(sink);
+  return JS_TRUE;
+}
+
+JS(vid_enc_sink_rate) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+
+  JS_CHECK_ARGC(1);
+
+  EncoderSink *sink = js_get_sink(cx, obj, argv[0]);
+  if(!sink) return JS_FALSE;
+
+  return JS_NewNumberValue(cx, sink->get_rate(), rval);
+}
+
+JS(vid_enc_sink_queue) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+
+  JS_CHECK_ARGC(1);
+
+  EncoderSink *sink = js_get_sink(cx, obj, argv[0]);
+  if(!sink) return JS_FALSE;
+
+  *rval = INT_TO_JSVAL(sink->queue_depth());
+  return JS_TRUE;
+}
+
+JS(vid_enc_sink_dropped) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+
+  JS_CHECK_ARGC(1);
+
+  EncoderSink *sink = js_get_sink(cx, obj, argv[0]);
+  if(!sink) return JS_FALSE;
+
+  return JS_NewNumberValue(cx, (double)sink->bytes_dropped, rval);
+}
+
+JS(vid_enc_sink_policy) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+
+  JS_CHECK_ARGC(2);
+
+  EncoderSink *sink = js_get_sink(cx, obj, argv[0]);
+  if(!sink) return JS_FALSE;
+
+  char *policy = js_get_string(argv[1]);
+
+  if(strcmp(policy, "newest") == 0)
+    sink->policy = EncoderSink::SINK_DROP;
+  else if(strcmp(policy, "oldest") == 0)
+    sink->policy = EncoderSink::SINK_DROP_OLDEST;
+  else if(strcmp(policy, "wait") == 0)
+    sink->policy = EncoderSink::SINK_WAIT;
+  else {
+    error("sink policy %s is not newest, oldest or wait", policy);
+    return JS_FALSE;
+  }
+  return JS_TRUE;
+}
+
+JS(vid_enc_sink_latency) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+
+  JS_CHECK_ARGC(2);
+
+  EncoderSink *sink = js_get_sink(cx, obj, argv[0]);
+  if(!sink) return JS_FALSE;
+
+  jsint ms = js_get_int(argv[1]);
+  sink->latency = (ms > 0) ? ms : 0;
+  return JS_TRUE;
+}
+
+JS(vid_enc_add_rendition) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+
+  JS_CHECK_ARGC(3);
+
+  VideoEncoder *enc = (VideoEncoder*)JS_GetPrivate(cx, obj);
+  if(!enc) {
+    error("%u:%s:%s :: VideoEncoder core data is NULL",
+	  __LINE__,__FILE__,__FUNCTION__);
+    return JS_FALSE;
+  }
+
+  // another VideoEncoder, with its own quality and bitrate
+  if(!JSVAL_IS_OBJECT(argv[0]) || JSVAL_IS_NULL(argv[0]))
+    JS_ERROR("rendition is not an object");
+  JSObject *robj = JSVAL_TO_OBJECT(argv[0]);
+  if(!JS_InstanceOf(cx, robj, &js_vid_enc_class, NULL))
+    JS_ERROR("rendition is not a VideoEncoder");
+  VideoEncoder *rend = (VideoEncoder*)JS_GetPrivate(cx, robj);
+  if(!rend) {
+    error("%u:%s:%s :: rendition VideoEncoder core data is NULL",
+	  __LINE__,__FILE__,__FUNCTION__);
+    return JS_FALSE;
+  }
+
+  *rval = BOOLEAN_TO_JSVAL(enc->add_rendition(rend, js_get_int(argv[1]),
+					      js_get_int(argv[2])));
+  return JS_TRUE;
+}
+
+JS(vid_enc_stream_rate) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+
+  VideoEncoder *enc = (VideoEncoder*)JS_GetPrivate(cx, obj);
+  if(!enc) {
+    error("%u:%s:%s :: VideoEncoder core data is NULL",
+	  __LINE__,__FILE__,__FUNCTION__);
+    return JS_FALSE;
+  }
+
+  return JS_NewNumberValue(cx, enc->getStreamRate(), rval);
+}
+
 JS(vid_enc_start_filesave) {
   func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
   
@@ -135,7 +389,7 @@ JS(vid_enc_start_filesave) {
 
   char *file = js_get_string(argv[0]);
 
-  if(!enc->is_running()) enc->start();
+  if(!enc->is_running() && !enc->master) enc->start();
 
   enc->set_filedump(file);
 
@@ -172,7 +426,7 @@ JS(start_stream) {
 
   act("starting stream to server %s on port %u",shout_get_host(enc->ice),shout_get_port(enc->ice));
 
-  if(!enc->is_running())
+  if(!enc->is_running() && !enc->master)
     enc->start();
   
   if( shout_open(enc->ice) == SHOUTERR_SUCCESS ) {
@@ -180,7 +434,7 @@ JS(start_stream) {
     notice("streaming on url: http://%s:%i%s",
 	shout_get_host(enc->ice), shout_get_port(enc->ice), shout_get_mount(enc->ice));
 
-    enc->write_to_stream = true;
+    enc->start_stream();
 
   } else {
 
@@ -204,7 +458,8 @@ JS(stop_stream) {
     return JS_FALSE;
   }
 
-  enc->write_to_stream = false;
+  // the sink must be done with the connection first
+  enc->stop_stream();
 
   if(shout_close(enc->ice))
     error("shout_close: %s",shout_get_error(enc->ice));
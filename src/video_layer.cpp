@@ -30,6 +30,7 @@
 #include <math.h>
 
 #include <string.h>
+#include <sys/stat.h>
 
 #include <screen.h>
 #include <context.h>
@@ -39,6 +40,8 @@
 #endif
 #include <ringbuffer.h>
 #include <video_layer.h>
+#include <worker_pool.h>
+#include <buffer_pool.h>
 
 #include <jsparser_data.h>
 
@@ -62,6 +65,7 @@ VideoLayer::VideoLayer()
   play_speed_control=1;
   seekable=true;
   to_seek = -1;
+  full_filename = NULL;
 
   audio_resampled_buf_len=0;
   audio_float_buf = NULL;
@@ -81,8 +85,31 @@ VideoLayer::VideoLayer()
   backward_control=false;
   deinterlace_buffer = NULL;
   video_clock = 0;
-  rgba_picture = NULL;
-  frame_fifo.length = 0;
+  packet_pts = 0;
+  video_current_pts = 0;
+  video_current_pts_time = 0;
+
+  fifo_length = 0;
+  shown = NULL;
+  underruns = 0;
+  pipeline_running = false;
+  reopen = false;
+  decode_threads = 0;
+  codec_threads = 0;
+  use_cache = false;
+  want_yuv420 = false;
+  yuv420_out = false;
+  fast_seek = false;
+  mark_looping = false;
+  skip_to = -1;
+  stream_start = 0;
+  cache_speed = 1.0;
+  clip = NULL;
+  clip_ready = false;
+  clip_pos = 0;
+  packets.init(PACKET_QUEUE_SIZE);
+  frames.init(FRAME_QUEUE_SIZE);
+  free_frames.init(FIFO_SIZE);
   jsclass = &video_layer_class;
 
   eos = new DumbCallback();
@@ -93,6 +120,7 @@ VideoLayer::~VideoLayer() {
 	delete eos;
 	stop();
 	close();
+	if(full_filename) free(full_filename);
 }
 
 /*
@@ -101,9 +129,7 @@ VideoLayer::~VideoLayer() {
 
 bool VideoLayer::_init() {
   func("VideoLayer::init");
-  
-  rgba_picture = (AVPicture *)calloc(1, sizeof(AVPicture));
-  
+
   /* init variables */
   paused=false;
   user_play_speed=1;
@@ -116,24 +142,21 @@ bool VideoLayer::_init() {
 }
 
 int VideoLayer::new_picture(AVPicture *picture) {
+	int size;
 	memset(picture,0,sizeof(AVPicture));
-	return avpicture_alloc(picture, PIX_FMT_RGB32,
-			       video_codec_ctx->width,
-			       video_codec_ctx->height);
+	// frames of the same geometry are reused by the next movie opened
+	size = avpicture_get_size(out_pix_fmt(),
+				  video_codec_ctx->width, video_codec_ctx->height);
+	uint8_t *buf = (uint8_t*)BufferPool::get(size);
+	if(!buf) return -1;
+	return avpicture_fill(picture, buf, out_pix_fmt(),
+			      video_codec_ctx->width, video_codec_ctx->height);
 
 }
-void VideoLayer::free_picture(AVPicture *picture) {
-	if(picture != NULL) {
-		if (picture->data[0])
-			avpicture_free(picture);
-		free(picture);
-	}
-	if (audio_float_buf) free (audio_float_buf);
-	if (audio_resampled_buf) free (audio_resampled_buf);
-}
 
 bool VideoLayer::open(const char *file) {
   AVCodecContext *enc; // tmp
+  struct stat st;
   int err=0;
   video_index=-1;
   func("VideoLayer::open(%s)",file);
@@ -228,8 +251,18 @@ bool VideoLayer::open(const char *file) {
 	return false;
       }
       
+      codec_threads = decode_threads ? decode_threads : share_decode_budget();
+#ifdef FF_THREAD_FRAME
+      video_codec_ctx->thread_count = codec_threads;
+      video_codec_ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+#else
+      if(codec_threads > 1)
+	avcodec_thread_init(video_codec_ctx, codec_threads);
+#endif
+
       if (avcodec_open(video_codec_ctx, video_codec) < 0) {
 	error("VideoLayer :: Could not open codec");
+	codec_threads = 0;
 	return false;
 	
       } else { // correctly opened
@@ -255,6 +288,7 @@ bool VideoLayer::open(const char *file) {
 	act ("%s (codec: %s) has resolution %dx%d and framerate %f",
 	     get_filename(), video_codec->name,
 	     video_codec_ctx->width, video_codec_ctx->height, frame_rate);
+	func("VideoLayer :: decoding on %u codec threads", codec_threads);
 
 	break;
       }
@@ -312,22 +346,27 @@ bool VideoLayer::open(const char *file) {
     return false;
   }
 
+  if(full_filename) free(full_filename);
   full_filename = strdup (file);
 
   geo.init(video_codec_ctx->width, video_codec_ctx->height, 32);
   func("VideoLayer :: w[%u] h[%u] size[%u]", geo.w, geo.h, geo.bytesize);
   func("VideoLayer :: frame_rate[%f]",frame_rate);
 
-  // initialize picture
-  if( new_picture(rgba_picture) < 0) {
-    error("VideoLayer::error allocating picture");
-    return false;
-  }
+  avformat_stream = avformat_context->streams[video_index];
+  stream_start = (avformat_stream->start_time != (int64_t)AV_NOPTS_VALUE) ?
+    avformat_stream->start_time : 0;
+
+  // keyframes are indexed while the movie plays, only in local files:
+  // devices, pipes and network streams are read once
+  if(!grab_dv && stat(file, &st) == 0 && S_ISREG(st.st_mode))
+    keyframes.build(full_filename, video_index, stream_start,
+		    av_q2d(avformat_stream->time_base));
 
 #ifdef WITH_SWSCALE
   img_convert_ctx =
     sws_getContext(geo.w, geo.h, video_codec_ctx->pix_fmt, geo.w, geo.h,
-		   PIX_FMT_RGB32, SWS_BICUBIC, 
+		   out_pix_fmt(), SWS_BICUBIC,
 		   NULL, NULL, NULL);
 #endif
 
@@ -347,6 +386,22 @@ bool VideoLayer::open(const char *file) {
   }
   func ("VideoLayer :: play_speed: %d",play_speed);
 
+  // a clip cached before plays from memory, else it is cached on the way
+  clip_ready = false;
+  clip_pos = 0;
+  if(use_cache && !yuv420_out) { // the cache holds RGBA
+    clip = ClipCache::find(full_filename, geo.w, geo.h);
+    if(clip) {
+      clip_ready = true;
+      act("VideoLayer :: %s plays from the clip cache", get_filename());
+    } else
+      clip = ClipCache::create(full_filename, geo.w, geo.h);
+  }
+
+  // start demuxing and decoding ahead of feed()
+  if(!clip_ready)
+    start_pipeline();
+
   opened = true;
 
   type = VIDEOLAYER;
@@ -355,272 +410,496 @@ bool VideoLayer::open(const char *file) {
 }
 
 void *VideoLayer::feed() {
-  int got_picture=0;
-  int len1=0 ;
-  int ret=0;
-  bool got_it=false;
+  video_frame_t *frame;
+  char *file;
+  bool ok;
+  double now;
+
+  // the stream ended and could not seek back: open it again
+  if(reopen) {
+    reopen = false;
+    file = full_filename; // open() takes a copy of its own
+    full_filename = NULL;
+    close();
+    ok = open(file);
+    free(file);
+    if(!ok) return NULL;
+  }
 
-  double now = get_master_clock();
+  if(clip_ready) {
+    // the clip was cached in this pass: no more decoding
+    if(pipeline_running) {
+      clip_pos = shown ? clip->find(shown->pts) : 0;
+      stop_pipeline();
+    }
+    feed_yuv420 = false;
+    return feed_cached();
+  }
 
+  // the screen asked for yuv frames, or RGBA again
+  if(want_yuv420 != yuv420_out)
+    switch_format();
+  feed_yuv420 = yuv420_out;
 
   if(paused)
-    return rgba_picture->data[0];
+    return shown ? shown->picture.data[0] : NULL;
+
+  now = get_master_clock();
 
   /**
    * follow user video loop
    */
   if(mark_in!=NO_MARK && mark_out!=NO_MARK && seekable) {
-    if (now >= mark_out)
-      seek((int64_t)mark_in * AV_TIME_BASE);
+    // once, until the first frame after mark_in is shown
+    if (now >= mark_out && !mark_looping) {
+      seek_to((int64_t)(mark_in * AV_TIME_BASE));
+      mark_looping = true;
+    }
   }
-  
-  // operate seek if was requested
-  if(to_seek>=0) {
-    seek(to_seek);
-    to_seek = -1;
+
+  /**
+   * take the next frame converted by the decode thread, if none is
+   * ready yet the last one is shown again
+   */
+  frame = (video_frame_t*)frames.try_pop();
+  if(!frame) {
+    underruns++;
+    return shown ? shown->picture.data[0] : NULL;
   }
-    
-  got_it=false;
-  
-  while (!got_it) {
-    
-    
-    if(packet_len<=0) {
-      /**
-       * Read one packet from the media and put it in pkt
-       */
-      while(1) {
-#ifdef DEBUG
-	func("av_read_frame ...");
-#endif
-	ret = av_read_frame(avformat_context, &pkt);
-
-#ifdef DEBUG
-	if(pkt.stream_index == video_index)
-	  std::cout << "video read packet";
-	else if(pkt.stream_index == audio_index)
-	  std::cout << "audio read packet";
-	std::cout << " pkt.data=" << pkt.data;
-	std::cout << " pkt.size=" << pkt.size;
-	std::cout << " pkt.pts/dts=" << pkt.pts << "/" << pkt.dts << std::endl;
-	std::cout << "pkt.duration=" << pkt.duration;
-	std::cout << " avformat_context->start_time=" << avformat_context->start_time;
-	std::cout << " avformat_context->duration=" << avformat_context->duration/AV_TIME_BASE << std::endl;
-	std::cout << "avformat_context->duration=" << avformat_context->duration << std::endl;
+
+  // the frame shown before has been published by now
+  if(shown) free_frames.push(shown);
+  shown = frame;
+
+  video_current_pts = frame->pts;
+  video_current_pts_time = av_gettime();
+  frame_number++;
+  if(frame->pts < mark_out) mark_looping = false;
+
+  return frame->picture.data[0];
+}
+
+bool VideoLayer::set_yuv420(bool on) {
+  // chroma is shared by pairs of pixels and rows
+  if(on && ((geo.w & 1) || (geo.h & 1))) return false;
+  // done by feed(), between two frames
+  want_yuv420 = on;
+  return true;
+}
+
+void VideoLayer::switch_format() {
+  stop_pipeline();
+
+  // a clip being cached is RGBA
+  if(clip) {
+    ClipCache::release(clip);
+    clip = NULL;
+  }
+
+  free_fifo();
+  yuv420_out = want_yuv420;
+#ifdef WITH_SWSCALE
+  sws_freeContext(img_convert_ctx);
+  img_convert_ctx =
+    sws_getContext(geo.w, geo.h, video_codec_ctx->pix_fmt, geo.w, geo.h,
+		   out_pix_fmt(), SWS_BICUBIC,
+		   NULL, NULL, NULL);
 #endif
-	
-	/* TODO(shammash): this may be good for streams but breaks
-	 * looping in files, needs fixing. */
-	// 	      if(!pkt.duration) continue;
-	
-	// 	      if(!pkt.size || !pkt.data) {
-	// 		return NULL;
-	// 	      }
-	
-	
-	/**
-	 * check eof and loop
-	 */
-	if(ret!= 0) {	//does not enter if data are available
-	  eos->notify();
-	  //	  eos->dispatcher->do_jobs(); /// XXX hack hack hack
-	  ret = seek(avformat_context->start_time);
-	  if (ret < 0) {
-	    error("VideoLayer::could not loop file");
-	    return rgba_picture->data[0];
-	  }
-	  continue;
-	} else if( (pkt.stream_index == video_index) 
-		   || (pkt.stream_index == audio_index) )
-	  break; /* exit loop */
-      }
-    } // loop break after a known index is found
-    
-    
-    frame_number++;
-	//std::cout << "frame_number :" << frame_number << std::endl;
-    
+  if(new_fifo() < 0) {
+    error("VideoLayer::error allocating fifo");
+    return;
+  }
+  act("VideoLayer :: %s decodes to %s", get_filename(),
+      yuv420_out ? "yuv 4:2:0" : "RGBA");
+
+  start_pipeline();
+}
+
+void *VideoLayer::feed_cached() {
+  int first, last, len, n;
+  int64_t ts;
+
+  ts = take_seek();
+  if(ts >= 0)
+    clip_pos = clip->find((double)ts / AV_TIME_BASE);
+
+  first = 0;
+  last = clip->count - 1;
+  if(mark_in != NO_MARK && mark_out != NO_MARK) {
+    first = clip->find(mark_in);
+    last = clip->find(mark_out);
+    if(last < first) last = first;
+  }
+
+  if(!paused)
+    clip_pos += cache_speed;
+
+  // loop between the marks, forward and backwards
+  len = last - first + 1;
+  if(clip_pos >= last + 1) {
+    clip_pos = first + fmod(clip_pos - first, len);
+    eos->notify();
+  } else if(clip_pos < first)
+    clip_pos = last + 1 - fmod(first - clip_pos, len);
+
+  n = (int)clip_pos;
+  if(n < first) n = first;
+  if(n > last) n = last;
+
+  video_current_pts = clip->pts(n);
+  video_current_pts_time = av_gettime();
+  frame_number++;
+
+  return clip->frame(n);
+}
+
+void VideoLayer::start_pipeline() {
+  int c;
+
+  packets.reset();
+  frames.reset();
+  free_frames.reset();
+  for(c = 0; c < fifo_length; c++)
+    free_frames.push(&frame_fifo[c]);
+  shown = NULL;
+  reopen = false;
+
+  pipeline_running = true;
+  if(pthread_create(&demux_thread, NULL, &VideoLayer::demux_run, this) != 0) {
+    error("VideoLayer :: can't create demux thread");
+    pipeline_running = false;
+    return;
+  }
+  if(pthread_create(&decode_thread, NULL, &VideoLayer::decode_run, this) != 0) {
+    error("VideoLayer :: can't create decode thread");
+    stop_pipeline();
+  }
+}
+
+void VideoLayer::stop_pipeline() {
+  AVPacket *p;
+
+  if(!pipeline_running) return;
+  pipeline_running = false;
+
+  // wake up the threads waiting on the queues
+  packets.abort();
+  frames.abort();
+  free_frames.abort();
+  pthread_join(demux_thread, NULL);
+  pthread_join(decode_thread, NULL);
+
+  // drop what is left in the queues
+  while( (p = (AVPacket*)packets.try_pop()) ) {
+    if(p->data) av_free_packet(p);
+    BufferPool::put(p);
+  }
+  while( frames.try_pop() ) continue;
+  while( free_frames.try_pop() ) continue;
+  shown = NULL;
+
+  func("VideoLayer :: %s pipeline stopped, %u underruns", get_filename(), underruns);
+}
+
+void *VideoLayer::demux_run(void *arg) {
+  ((VideoLayer*)arg)->demux_loop();
+  return NULL;
+}
+
+void *VideoLayer::decode_run(void *arg) {
+  ((VideoLayer*)arg)->decode_loop();
+  return NULL;
+}
+
+// av_free_packet() gives the data of a queued packet back to the pool
+static void pooled_packet_destruct(AVPacket *pkt) {
+  BufferPool::put(pkt->data);
+  pkt->data = NULL;
+  pkt->size = 0;
+}
+
+void VideoLayer::demux_loop() {
+  AVPacket *p;
+  int64_t ts;
+  int ret;
+
+  func("VideoLayer :: demux thread started for %s", get_filename());
+
+  while(pipeline_running) {
+
+    // operate seek if was requested
+    ts = take_seek();
+    if(ts >= 0)
+      seek(ts, true);
+
+    /**
+     * Read one packet from the media
+     */
+    ret = av_read_frame(avformat_context, &pkt);
+
     /**
-     * Decode video
+     * check eof and loop
      */
+    if(ret != 0) {
+      eos->notify();
+      ret = seek(0, false);
+      if (ret < 0) {
+	error("VideoLayer::could not loop file");
+	break;
+      }
+      if(reopen) break; // feed() will open it again
+      continue;
+    }
+
     if(pkt.stream_index == video_index) {
-      
-      len1 = decode_video_packet(&got_picture);
-      
-      AVFrame *yuv_picture=&av_frame;
-      if(len1<0) {
-	//	  error("VideoLayer::Error while decoding frame");
-	func("one frame only?");
-	return NULL;
+      // the packet is handed to the decode thread, copied in buffers
+      // of the pool instead of duplicated on the heap by av_dup_packet
+      p = (AVPacket*)BufferPool::get(sizeof(AVPacket));
+      *p = pkt;
+      p->data = (uint8_t*)BufferPool::get_packet(pkt.size + FF_INPUT_BUFFER_PADDING_SIZE);
+      if(!p->data) {
+	av_free_packet(&pkt);
+	BufferPool::put(p);
+	continue;
       }
-      else if (len1 == 0) {
-	packet_len=0;
-	return NULL;
+      memcpy(p->data, pkt.data, pkt.size);
+      memset(p->data + pkt.size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+      p->destruct = pooled_packet_destruct;
+      av_free_packet(&pkt);
+      if(!packets.push(p)) { // aborted
+	av_free_packet(p);
+	BufferPool::put(p);
+	break;
       }
-      
-      /**
-       * We've found a picture
-       */
-      ptr += len1;
-      packet_len -= len1;
-      if (got_picture!=0) {
-	got_it=true;
-	avformat_stream=avformat_context->streams[video_index];
-	
-	/** Deinterlace input if requested */
-	if(deinterlaced)
-	  deinterlace((AVPicture *)yuv_picture);
-	
+
+    } else if(pkt.stream_index == audio_index) {
+      decode_audio(&pkt);
+      av_free_packet(&pkt); /* sun's good. love's bad */
+
+    } else
+      av_free_packet(&pkt);
+
+  }
+
+  func("VideoLayer :: demux thread ended for %s", get_filename());
+}
+
+void VideoLayer::flush_frames(bool drop) {
+  video_frame_t *frame;
+  // frames decoded before a seek are not shown
+  if(drop)
+    while( (frame = (video_frame_t*)frames.try_pop()) )
+      free_frames.push(frame);
+  if (video_codec_ctx)
+    avcodec_flush_buffers(video_codec_ctx);
+}
+
+void VideoLayer::decode_loop() {
+  AVPacket *p;
+  video_frame_t *frame;
+  AVFrame *yuv_picture = &av_frame;
+  int got_picture, len;
+
+  func("VideoLayer :: decode thread started for %s", get_filename());
+
+  while(pipeline_running) {
+
+    p = (AVPacket*)packets.pop();
+    if(!p) break; // aborted
+
+    // an empty packet is queued after seeking
+    if(!p->data) {
+      // one whole pass is cached: it ends when the stream loops, a
+      // seek by the user leaves a gap and the clip is given up
+      if(clip && !clip_ready) {
+	if(p->stream_index == 0 && clip->count) {
+	  ClipCache::finish(clip);
+	  clip_ready = true;
+	} else {
+	  ClipCache::release(clip);
+	  clip = NULL;
+	}
+      }
+      flush_frames(p->stream_index != 0);
+      // an accurate seek decodes the frames before its target, not shown
+      skip_to = (p->pts != (int64_t)AV_NOPTS_VALUE) ?
+	(double)p->pts / AV_TIME_BASE : -1;
+      BufferPool::put(p);
+      continue;
+    }
+
+    packet_len = 0;
+    do {
+      got_picture = 0;
+      len = decode_video_packet(p, &got_picture);
+      if(len <= 0) break;
+
+      ptr += len;
+      packet_len -= len;
+
+      if(!got_picture) continue;
+
+      if(skip_to >= 0) {
+	// half a frame early is on target
+	if(packet_pts + 0.5 / frame_rate < skip_to) continue;
+	skip_to = -1;
+      }
+
+      frame = (video_frame_t*)free_frames.pop();
+      if(!frame) break; // aborted
+
+      /** Deinterlace input if requested */
+      if(deinterlaced)
+	deinterlace((AVPicture *)yuv_picture);
+
+      if(yuv420_out && video_codec_ctx->pix_fmt == PIX_FMT_YUV420P)
+	// decoded as the screen wants it: copied, not converted
+	av_picture_copy(&frame->picture, (AVPicture *)yuv_picture,
+			PIX_FMT_YUV420P,
+			video_codec_ctx->width,
+			video_codec_ctx->height);
+      else {
 #ifdef WITH_SWSCALE
 	sws_scale(img_convert_ctx, yuv_picture->data, yuv_picture->linesize,
 		  0, video_codec_ctx->height,
-		  rgba_picture->data, rgba_picture->linesize);	  
+		  frame->picture.data, frame->picture.linesize);
 #else
 	/**
 	 * yuv2rgb
 	 */
-	img_convert(rgba_picture, PIX_FMT_RGB32, (AVPicture *)yuv_picture,
-		    video_codec_ctx->pix_fmt, 
-		    //avformat_stream.codec->pix_fmt,
+	img_convert(&frame->picture, out_pix_fmt(), (AVPicture *)yuv_picture,
+		    video_codec_ctx->pix_fmt,
 		    video_codec_ctx->width,
 		    video_codec_ctx->height);
 #endif
-	// memcpy(frame_fifo.picture[fifo_position % FIFO_SIZE]->data[0],rgba_picture->data[0],geo.size);
-	/* TODO move */
-	if(fifo_position == FIFO_SIZE)
-	  fifo_position=0;
-	
-	/* workaround since sws_scale conversion from YUV
-	   returns an buffer RGBA with alpha set to 0x0  */
-	{
-	  register int bufsize = ( rgba_picture->linesize[0] * video_codec_ctx->height ) /4;
-	  int32_t *pbuf =  (int32_t*)rgba_picture->data[0];
-	  
-	  for(; bufsize>0; bufsize--) {
-	    *pbuf = (*pbuf | alpha_bitmask);
-	    pbuf++;
-	  }
-	} 
-	
-	jmemcpy(frame_fifo.picture[fifo_position]->data[0],
-		rgba_picture->data[0],
-		rgba_picture->linesize[0] * video_codec_ctx->height);
-	
-	//			    avpicture_get_size(PIX_FMT_RGBA32, enc->width, enc->height));
-	fifo_position++;
       }
-    } // end video packet decoding
-    
-
-    ////////////////////////
-    // audio packet decoding
-    else if(pkt.stream_index == audio_index) {
-      // XXX(shammash): audio decoding seems to depend on screen properties, so
-      //                we skip decoding audio frames if there's no screen
-      //  long unsigned int m_SampleRate = screen->m_SampleRate?*(screen->m_SampleRate):48000;
-      //  ringbuffer_write(screen->audio, (const char*)audio_float_buf,  samples*sizeof(float));
-      //  ... and so on ...
-      if(use_audio && screen) {
-	int data_size;
-	len1 = decode_audio_packet(&data_size);
-	if (len1 > 0)  {
-	  int samples = data_size/sizeof(uint16_t);
-	  long unsigned int m_SampleRate = screen->m_SampleRate?*(screen->m_SampleRate):48000;
-	  double m_ResampleRatio = (double)(m_SampleRate)/(double)audio_samplerate; 
-	  long unsigned max_buf = ceil(AVCODEC_MAX_AUDIO_FRAME_SIZE * m_ResampleRatio * audio_channels);
-
-	  if (audio_resampled_buf_len < max_buf) {
-		if (audio_resampled_buf) free (audio_resampled_buf);
-		audio_resampled_buf = (float*) malloc(max_buf * sizeof(float));
-		audio_resampled_buf_len = max_buf;
-	  }
-
-	  src_short_to_float_array ((const short*) audio_buf, audio_float_buf, samples);
-	  if (m_ResampleRatio == 1.0) 
-	  {
-	    ringbuffer_write(screen->audio, (const char*)audio_float_buf,  samples*sizeof(float));
-	    time_t *tm = (time_t *)malloc(sizeof(time_t));
-	    time (tm);
-// 	    std::cerr << "-- VL:" << asctime(localtime(tm));
-	  } 
-	  else 
-	  {
-	    src_short_to_float_array ((const short*) audio_buf, audio_float_buf, samples);
-
-	    SRC_DATA src_data;
-	    int offset = 0;
-
-            do {
-	      src_data.input_frames  = samples/audio_channels;
-	      src_data.output_frames = audio_resampled_buf_len/audio_channels - offset;
-	      src_data.end_of_input  = 0;
-	      src_data.src_ratio     =  m_ResampleRatio;
-	      src_data.input_frames_used = 0;
-	      src_data.output_frames_gen = 0;
-	      src_data.data_in       = audio_float_buf + offset; 
-	      src_data.data_out      = audio_resampled_buf + offset;
-
-	      src_simple (&src_data, SRC_SINC_MEDIUM_QUALITY, audio_channels) ;
-	      ringbuffer_write(screen->audio,
-			       (const char*)audio_resampled_buf,
-			       src_data.output_frames_gen * audio_channels *sizeof(float));
-
-	      offset += src_data.input_frames_used * audio_channels;
-	      samples -= src_data.input_frames_used * audio_channels;
-
-	      if (samples>0)
-		warning("resampling left: %i < %i",
-			src_data.input_frames_used, samples/audio_channels);
-
-	    } while (samples > audio_channels);
-	  }
+
+      /* workaround since sws_scale conversion from YUV
+	 returns an buffer RGBA with alpha set to 0x0  */
+      if(!yuv420_out) {
+	register int bufsize = ( frame->picture.linesize[0] * video_codec_ctx->height ) /4;
+	int32_t *pbuf =  (int32_t*)frame->picture.data[0];
+
+	for(; bufsize>0; bufsize--) {
+	  *pbuf = (*pbuf | alpha_bitmask);
+	  pbuf++;
 	}
       }
-    }
-    
-    av_free_packet(&pkt); /* sun's good. love's bad */
-    
-  } // end of while(!got_it)
-  
-  return frame_fifo.picture[fifo_position-1]->data[0];
+
+      frame->pts = packet_pts;
+
+      if(clip && !clip_ready)
+	if(!ClipCache::add_frame(clip, frame->picture.data[0], frame->pts)) {
+	  warning("VideoLayer :: %s doesn't fit in the clip cache", get_filename());
+	  ClipCache::release(clip);
+	  clip = NULL;
+	}
+
+      if(!frames.push(frame)) break; // aborted
+
+    } while(packet_len > 0 && pipeline_running);
+
+    av_free_packet(p);
+    BufferPool::put(p);
+  }
+
+  func("VideoLayer :: decode thread ended for %s", get_filename());
 }
 
+void VideoLayer::get_queue_stats(queue_stats_t *st) {
+  st->packets = packets.depth();
+  st->frames = frames.depth();
+  st->underruns = underruns;
+}
+
+void VideoLayer::decode_audio(AVPacket *packet) {
+  // XXX(shammash): audio decoding seems to depend on screen properties, so
+  //                we skip decoding audio frames if there's no screen
+  if(use_audio && screen) {
+    int data_size;
+    int len1 = decode_audio_packet(packet, &data_size);
+    if (len1 > 0)  {
+      int samples = data_size/sizeof(uint16_t);
+      long unsigned int m_SampleRate = screen->m_SampleRate?*(screen->m_SampleRate):48000;
+      double m_ResampleRatio = (double)(m_SampleRate)/(double)audio_samplerate; 
+      long unsigned max_buf = ceil(AVCODEC_MAX_AUDIO_FRAME_SIZE * m_ResampleRatio * audio_channels);
+
+      if (audio_resampled_buf_len < max_buf) {
+	    if (audio_resampled_buf) free (audio_resampled_buf);
+	    audio_resampled_buf = (float*) malloc(max_buf * sizeof(float));
+	    audio_resampled_buf_len = max_buf;
+      }
 
-int VideoLayer::decode_audio_packet() {
-  return decode_audio_packet(NULL);
+      src_short_to_float_array ((const short*) audio_buf, audio_float_buf, samples);
+      if (m_ResampleRatio == 1.0) 
+      {
+	ringbuffer_write(screen->audio, (const char*)audio_float_buf,  samples*sizeof(float));
+      } 
+      else 
+      {
+	src_short_to_float_array ((const short*) audio_buf, audio_float_buf, samples);
+
+	SRC_DATA src_data;
+	int offset = 0;
+
+	do {
+	  src_data.input_frames  = samples/audio_channels;
+	  src_data.output_frames = audio_resampled_buf_len/audio_channels - offset;
+	  src_data.end_of_input  = 0;
+	  src_data.src_ratio     =  m_ResampleRatio;
+	  src_data.input_frames_used = 0;
+	  src_data.output_frames_gen = 0;
+	  src_data.data_in       = audio_float_buf + offset; 
+	  src_data.data_out      = audio_resampled_buf + offset;
+
+	  src_simple (&src_data, SRC_SINC_MEDIUM_QUALITY, audio_channels) ;
+	  ringbuffer_write(screen->audio,
+			   (const char*)audio_resampled_buf,
+			   src_data.output_frames_gen * audio_channels *sizeof(float));
+
+	  offset += src_data.input_frames_used * audio_channels;
+	  samples -= src_data.input_frames_used * audio_channels;
+
+	  if (samples>0)
+	    warning("resampling left: %i < %i",
+		    src_data.input_frames_used, samples/audio_channels);
+
+	} while (samples > audio_channels);
+      }
+    }
+  }
 }
 
-int VideoLayer::decode_audio_packet(int *data_size) {
+int VideoLayer::decode_audio_packet(AVPacket *packet, int *data_size) {
   int datasize, res;
 
   datasize = AVCODEC_MAX_AUDIO_FRAME_SIZE; //+ FF_INPUT_BUFFER_PADDING_SIZE;
 #if LIBAVCODEC_VERSION_MAJOR < 53
   res = avcodec_decode_audio2(audio_codec_ctx, (int16_t *)audio_buf,
-			      &datasize, pkt.data, pkt.size);
+			      &datasize, packet->data, packet->size);
 #else
   res = avcodec_decode_audio3(audio_codec_ctx, (int16_t *)audio_buf,
-			      &datasize, &pkt);
+			      &datasize, packet);
 #endif
 
   if (data_size) *data_size = datasize; 
   
   if(res < 0) {
     /* if error, skip frame */
-    pkt.size = 0;
     return 0;
   }
   /* We have data, return it and come back for more later */
   return res;
 }
-   
-int VideoLayer::decode_video_packet(int *got_picture) {
-	double pts1 = 0;
+
+int VideoLayer::decode_video_packet(AVPacket *packet, int *got_picture) {
+	int64_t pts;
 	/**
 	 * Decode the packet and put i(n)t in(t) av_frame
 	 */
 	if (packet_len <= 0) {
-		packet_len = pkt.size; // packet size is zero if packet contains only one frame
-		ptr        = pkt.data; /* pointer to frame data */
+		packet_len = packet->size; // packet size is zero if packet contains only one frame
+		ptr        = packet->data; /* pointer to frame data */
 	}
 	/**
 	 * In avcodec_get_frame_defaults() avcodec does:
@@ -633,30 +912,30 @@ int VideoLayer::decode_video_packet(int *got_picture) {
 #if LIBAVCODEC_VERSION_MAJOR < 53
 	int lien = avcodec_decode_video(video_codec_ctx, &av_frame,
 					got_picture, ptr,packet_len);
+	pts = packet->dts;
 #else
+	// the decoder hands back the pts of the packet of each picture
+	video_codec_ctx->reordered_opaque = packet->pts;
 	int lien = avcodec_decode_video2(video_codec_ctx, &av_frame,
-					got_picture, &pkt);
+					got_picture, packet);
+	pts = av_frame.reordered_opaque;
+	if (pts == (int64_t)AV_NOPTS_VALUE)
+		pts = packet->dts;
 #endif
-	
-	pts1 = packet_pts;
-	if (packet_pts != 0) {
+	if (!*got_picture)
+		return lien;
+
+	if (pts != (int64_t)AV_NOPTS_VALUE) {
 		/* update video clock with pts, if present */
+		packet_pts = (pts - stream_start) * av_q2d (avformat_stream -> time_base);
 		video_clock = packet_pts;
 	} else {
 		packet_pts = video_clock;
 	}
-	video_current_pts=packet_pts;
-
-	video_current_pts_time=av_gettime();
+	// the clock of the layer moves when the frame is shown by feed()
 
 	/* update video clock for next frame */
-	double frame_delay ;
-#if LIBAVCODEC_BUILD  >=     4754
-	frame_delay = av_q2d (avformat_stream -> time_base);
-#else
-	frame_delay = (double)avformat_stream->codec.frame_rate_base /
-		(double)avformat_stream->codec.frame_rate;
-#endif
+	double frame_delay = (frame_rate > 0) ? 1.0 / frame_rate : 0.04;
 
 	/* for MPEG2, the frame can be repeated, so we update the
 	   clock accordingly */
@@ -665,31 +944,46 @@ int VideoLayer::decode_video_packet(int *got_picture) {
 	}
 	video_clock += frame_delay;
 
-	/* Debug pts code */
-	{
-		int ftype;
-		if (av_frame.pict_type == FF_B_TYPE)
-			ftype = 'B';
-		else if (av_frame.pict_type == FF_I_TYPE)
-			ftype = 'I';
-		else
-			ftype = 'P';
-/*		func("frame_type=%c clock=%0.3f pts=%0.3f",
-                ftype, get_master_clock(), pts1); */
-	}
 	return lien;
 }
 
+int VideoLayer::decode_budget = 0;
+int VideoLayer::decode_clips = 4;
+
+/*
+ * threads for a codec about to open: each clip gets the same share of
+ * the budget, sized for the clips expected to play together, so that
+ * the codecs opened first don't take all cpus and keep them
+ */
+int VideoLayer::share_decode_budget() {
+  int budget = decode_budget;
+  int clips = (decode_clips < 1) ? 1 : decode_clips;
+
+  if(budget <= 0) {
+    // cpus left free by the compositor and encoder pools and by the
+    // main thread, which works with them
+    budget = online_cpus() - WorkerPool::running() - 1;
+    if(budget < 1) budget = 1;
+  }
+  budget /= clips;
+  return (budget < 1) ? 1 : budget;
+}
+
 void VideoLayer::close() {
-  if(frame_number!=0) {
-	func("free packet");
-    av_free_packet(&pkt);
+  stop_pipeline();
+  keyframes.close();
+
+  if(clip) {
+    ClipCache::release(clip);
+    clip = NULL;
   }
+  clip_ready = false;
 
   if(video_codec_ctx)
     if(video_codec_ctx->codec) {
 	func("close video codec");
       avcodec_close(video_codec_ctx);
+      codec_threads = 0;
   }
   
   if(audio_codec_ctx) 
@@ -709,33 +1003,35 @@ void VideoLayer::close() {
   if(avformat_context) {
     av_close_input_file(avformat_context);
   }
-//  free_fifo();
-  if(rgba_picture) free_picture(rgba_picture);
-  if(deinterlace_buffer) free(deinterlace_buffer);
+  free_fifo();
+  if (audio_float_buf) { free (audio_float_buf); audio_float_buf = NULL; }
+  if (audio_resampled_buf) { free (audio_resampled_buf); audio_resampled_buf = NULL; }
+  audio_resampled_buf_len = 0;
+  if(deinterlace_buffer) { av_free(deinterlace_buffer); deinterlace_buffer = NULL; }
 }
 
 /*
  * allocate fifo
  */
 int VideoLayer::new_fifo() {
-  fifo_position=0;
 	int ret;
 	// loop throught fifo
 	for ( int s = 0; s < FIFO_SIZE; s++) {
-		frame_fifo.picture[s] = (AVPicture *)malloc(sizeof(AVPicture));
-		AVPicture *tmp_picture = frame_fifo.picture[s];
-		ret = new_picture(tmp_picture);
+		ret = new_picture(&frame_fifo[s].picture);
 		if ( ret < 0)
 			return -1;
-		frame_fifo.length++;
+		frame_fifo[s].pts = 0;
+		fifo_length++;
 	}
 	return 0;
 }
 
 void VideoLayer::free_fifo() {
-	for ( int s = 0; s < frame_fifo.length; s++) {
-		free_picture(frame_fifo.picture[s]);
+	for ( int s = 0; s < fifo_length; s++) {
+		if (frame_fifo[s].picture.data[0])
+			BufferPool::put(frame_fifo[s].picture.data[0]);
 	}
+	fifo_length = 0;
 }
 // bool VideoLayer::keypress(int key) {
 // 	switch(key) {
@@ -812,7 +1108,6 @@ bool VideoLayer::set_mark_out() {
 }
 
 bool VideoLayer::relative_seek(double increment) {
-	int ret=0;
 	double current_time=get_master_clock();
 	//    printf("master_clock(): %f\n",current_time);
 	current_time += increment;
@@ -832,27 +1127,29 @@ bool VideoLayer::relative_seek(double increment) {
 	}
 
 	//    printf("VideoLayer::seeking to: %f\n",current_time);
-	ret = seek ((int64_t) current_time * AV_TIME_BASE);
-	if (ret < 0) {
-		error ("Can't seek file: %s", get_filename());
-		return false;
-	}
-	else
-		notice("seek to %.1f\%",current_time);
+	// the demux thread seeks before reading the next packet
+	seek_to((int64_t)(current_time * AV_TIME_BASE));
+	notice("seek to %.1f\%",current_time);
 	return true;
 }
 /**
- * Warning! doesn't lock feed
+ * Called by the demux thread, use seek_to() from other threads
  */
-int VideoLayer::seek(int64_t timestamp) {
+int VideoLayer::seek(int64_t timestamp, bool drop) {
   /* return value */
   int ret=0;
+  AVPacket *p;
   bool seeking_at_beginning_of_stream=false;
   /** mark-{in|out} in AV_TIME_BASE unit */
   int64_t mark_in_av_time_base;
   int64_t mark_out_av_time_base;
+  KeyframeIndex::keyframe_t key;
+  int flags = 0;
+#if (LIBAVFORMAT_BUILD >= 4618)
+  flags = AVSEEK_FLAG_BACKWARD;
+#endif
 
-  if(timestamp==avformat_context->start_time)
+  if(timestamp <= 0)
     seeking_at_beginning_of_stream=true;
   /**
    * handle bof by closing and reopening file when media it's not seekable
@@ -862,11 +1159,8 @@ int VideoLayer::seek(int64_t timestamp) {
 
   if(!seekable) {
     if(seeking_at_beginning_of_stream) {
-      /** close and reopen the stream*/
-      {
-	close();
-	open(full_filename);
-      }
+      /** close and reopen the stream, done by feed() */
+      reopen = true;
       return 0;
     }
     else {
@@ -875,8 +1169,8 @@ int VideoLayer::seek(int64_t timestamp) {
     }
   }
 
-  mark_in_av_time_base = (int64_t) mark_in * AV_TIME_BASE;
-  mark_out_av_time_base = (int64_t) mark_out * AV_TIME_BASE;
+  mark_in_av_time_base = (int64_t)(mark_in * AV_TIME_BASE);
+  mark_out_av_time_base = (int64_t)(mark_out * AV_TIME_BASE);
 
   /** mark-in and mark-out seek */
   if ( mark_in != NO_MARK && mark_out != NO_MARK ) {
@@ -889,29 +1183,42 @@ int VideoLayer::seek(int64_t timestamp) {
    * HERE sick
    */
   func("SEEKING");
-  ret = av_seek_frame(avformat_context, video_index,timestamp
-#if (LIBAVFORMAT_BUILD >= 4618) 
-		      ,AVSEEK_FLAG_BACKWARD
-#endif
-		      );
-  //#else
-  //    ret = av_seek_frame(avformat_context, video_index,timestamp);
+  if(keyframes.find((double)timestamp / AV_TIME_BASE, &key)) {
+    // straight to the keyframe before the target
+    ret = av_seek_frame(avformat_context, video_index, key.ts, flags);
+    if(ret < 0 && key.pos >= 0)
+      ret = av_seek_frame(avformat_context, video_index, key.pos, AVSEEK_FLAG_BYTE);
+  } else {
+    // not indexed yet: the demuxer looks for a keyframe
+    AVRational tb = { 1, AV_TIME_BASE };
+    ret = av_seek_frame(avformat_context, video_index,
+			av_rescale_q(timestamp, tb, avformat_stream->time_base)
+			+ stream_start, flags);
+  }
 
   if(ret<0) {
     seekable=false;
     if(seeking_at_beginning_of_stream) {
-      /** close and reopen the stream*/
-      {
-	close();
-	open(full_filename);
-	return 0;
-      }
+      /** close and reopen the stream, done by feed() */
+      reopen = true;
+      return 0;
     }
   }
   else { // seek with success
     // Flush buffers, should be called when seeking or when swicthing to a different stream.
-    if (video_codec_ctx)
-	avcodec_flush_buffers(video_codec_ctx);
+    // the video decoder is flushed by the decode thread when it finds
+    // an empty packet, which also drops the frames decoded ahead
+    if(drop) {
+      while( (p = (AVPacket*)packets.try_pop()) ) {
+	av_free_packet(p);
+	BufferPool::put(p);
+      }
+    }
+    p = (AVPacket*)BufferPool::get_zero(sizeof(AVPacket));
+    p->stream_index = drop ? 1 : 0;
+    // the target time, unless only the keyframe is needed
+    p->pts = (drop && !fast_seek) ? timestamp : AV_NOPTS_VALUE;
+    if(!packets.push(p)) BufferPool::put(p);
     if (audio_codec_ctx)
 	avcodec_flush_buffers(audio_codec_ctx);
   }
@@ -37,6 +37,11 @@ JSFunctionSpec video_layer_methods[] = {
   {	"mark-in",	video_layer_mark_in, 		1},
   {	"mark-out",	video_layer_mark_out, 		1},
   {	"pause",	video_layer_pause, 		0}, 
+  {	"queue_stats",	video_layer_queue_stats,	0},
+  {	"decode_threads", video_layer_decode_threads,	0},
+  {	"cache",	video_layer_cache,		0},
+  {	"speed",	video_layer_speed,		1},
+  {	"fast_seek",	video_layer_fast_seek,		1},
   {0}
 };
 
@@ -56,8 +61,8 @@ JS(video_layer_seek) {
       return JS_FALSE;
   } else {
     JS_ValueToECMAUint32(cx, argv[0], &pos);
-    lay->to_seek = pos;
-    func("to seek: %d",lay->to_seek);
+    lay->seek_to(pos);
+    func("to seek: %u",pos);
   }
   return JS_TRUE;
 }
@@ -79,6 +84,84 @@ JS(video_layer_mark_out) {
   lay->set_mark_out();
   return JS_TRUE;
 }
+JS(video_layer_queue_stats) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+  VideoLayer::queue_stats_t st;
+  JSObject *objtmp;
+  jsval val;
+
+  GET_LAYER(VideoLayer);
+
+  lay->get_queue_stats(&st);
+
+  objtmp = JS_NewObject(cx, NULL, NULL, NULL);
+  if(!objtmp) return JS_FALSE;
+  val = INT_TO_JSVAL(st.packets);
+  JS_SetProperty(cx, objtmp, "packets", &val);
+  val = INT_TO_JSVAL(st.frames);
+  JS_SetProperty(cx, objtmp, "frames", &val);
+  JS_NewNumberValue(cx, st.underruns, &val);
+  JS_SetProperty(cx, objtmp, "underruns", &val);
+
+  *rval = OBJECT_TO_JSVAL(objtmp);
+  return JS_TRUE;
+}
+
+// set the codec threads used from the next open, get the ones in use
+JS(video_layer_decode_threads) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+  uint32_t threads;
+
+  GET_LAYER(VideoLayer);
+
+  if(argc > 0) {
+    JS_ValueToECMAUint32(cx, argv[0], &threads);
+    lay->decode_threads = threads;
+  }
+  *rval = INT_TO_JSVAL(lay->get_codec_threads());
+  return JS_TRUE;
+}
+
+// keep the clip in the memory cache from the next open, get if cached
+JS(video_layer_cache) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+
+  JSBool cache;
+
+  GET_LAYER(VideoLayer);
+
+  if(argc > 0) {
+    JS_ValueToBoolean(cx, argv[0], &cache);
+    lay->use_cache = cache;
+  }
+  *rval = BOOLEAN_TO_JSVAL(lay->is_cached());
+  return JS_TRUE;
+}
+
+// frames stepped on each feed of a cached clip, negative plays backwards
+JS(video_layer_speed) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+  JS_CHECK_ARGC(1);
+
+  GET_LAYER(VideoLayer);
+
+  lay->cache_speed = js_get_double(argv[0]);
+  return JS_TRUE;
+}
+
+// seek to keyframes only, for scrubbing
+JS(video_layer_fast_seek) {
+  func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
+  JSBool fast;
+  JS_CHECK_ARGC(1);
+
+  GET_LAYER(VideoLayer);
+
+  JS_ValueToBoolean(cx, argv[0], &fast);
+  lay->fast_seek = fast;
+  return JS_TRUE;
+}
+
 JS(video_layer_pause) {
   func("%u:%s:%s",__LINE__,__FILE__,__FUNCTION__);
 
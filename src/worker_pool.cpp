@@ -0,0 +1,186 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <worker_pool.h>
+#include <jutils.h>
+#include <config.h>
+
+int online_cpus() {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n < 1) ? 1 : (int)n;
+}
+
+volatile int WorkerPool::total = 0;
+
+WorkerPool::WorkerPool() {
+  workers = NULL;
+  nthreads = 0;
+
+  job_fun = NULL;
+  job_arg = NULL;
+  job_count = job_next = job_done = 0;
+
+  batch = 0;
+  quit = false;
+
+  pthread_mutex_init(&mutex, NULL);
+  pthread_mutex_init(&run_mutex, NULL);
+  pthread_cond_init(&wake_cond, NULL);
+  pthread_cond_init(&done_cond, NULL);
+}
+
+WorkerPool::~WorkerPool() {
+  close();
+  pthread_cond_destroy(&done_cond);
+  pthread_cond_destroy(&wake_cond);
+  pthread_mutex_destroy(&mutex);
+  pthread_mutex_destroy(&run_mutex);
+}
+
+bool WorkerPool::init(int n) {
+  int c;
+
+  if(workers) close();
+
+  // the thread calling run() works as well, so it counts as one
+  if(n <= 0) n = online_cpus() - 1;
+  if(n <= 0) {
+    func("worker pool running inline on a single cpu");
+    return true;
+  }
+
+  workers = (pthread_t*)calloc(n, sizeof(pthread_t));
+  quit = false;
+
+  for(c = 0; c < n; c++) {
+    if(pthread_create(&workers[c], NULL, &WorkerPool::_run, this) != 0) {
+      error("worker pool can't create thread %u of %u", c+1, n);
+      break;
+    }
+    nthreads++;
+  }
+
+  __sync_fetch_and_add(&total, nthreads);
+  act("worker pool started %u threads", nthreads);
+  return (nthreads == n);
+}
+
+void WorkerPool::close() {
+  int c;
+
+  if(!workers) return;
+
+  pthread_mutex_lock(&mutex);
+  quit = true;
+  pthread_cond_broadcast(&wake_cond);
+  pthread_mutex_unlock(&mutex);
+
+  for(c = 0; c < nthreads; c++)
+    pthread_join(workers[c], NULL);
+
+  free(workers);
+  workers = NULL;
+  __sync_fetch_and_sub(&total, nthreads);
+  nthreads = 0;
+}
+
+void WorkerPool::run(worker_job_f *fun, void *arg, int count) {
+  int c;
+
+  if(count <= 0) return;
+
+  if(!nthreads || count == 1) {
+    for(c = 0; c < count; c++)
+      (*fun)(arg, c);
+    return;
+  }
+
+  // a batch at a time, the other callers wait for their turn
+  pthread_mutex_lock(&run_mutex);
+
+  pthread_mutex_lock(&mutex);
+  job_fun = fun;
+  job_arg = arg;
+  job_count = count;
+  job_next = 0;
+  job_done = 0;
+  batch++;
+  pthread_cond_broadcast(&wake_cond);
+  pthread_mutex_unlock(&mutex);
+
+  work();
+
+  pthread_mutex_lock(&mutex);
+  while(job_done < job_count)
+    pthread_cond_wait(&done_cond, &mutex);
+  job_fun = NULL;
+  job_arg = NULL;
+  pthread_mutex_unlock(&mutex);
+
+  pthread_mutex_unlock(&run_mutex);
+}
+
+void WorkerPool::work() {
+  worker_job_f *fun;
+  void *arg;
+  int idx;
+
+  pthread_mutex_lock(&mutex);
+  while(job_next < job_count) {
+    idx = job_next++;
+    fun = job_fun;
+    arg = job_arg;
+    pthread_mutex_unlock(&mutex);
+
+    (*fun)(arg, idx);
+
+    pthread_mutex_lock(&mutex);
+    job_done++;
+    if(job_done == job_count)
+      pthread_cond_signal(&done_cond);
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+void *WorkerPool::_run(void *arg) {
+  WorkerPool *me = (WorkerPool*)arg;
+  unsigned int seen = 0;
+
+  pthread_mutex_lock(&me->mutex);
+  seen = me->batch;
+  while(!me->quit) {
+
+    while(!me->quit && seen == me->batch)
+      pthread_cond_wait(&me->wake_cond, &me->mutex);
+    if(me->quit) break;
+
+    seen = me->batch;
+    pthread_mutex_unlock(&me->mutex);
+
+    me->work();
+
+    pthread_mutex_lock(&me->mutex);
+  }
+  pthread_mutex_unlock(&me->mutex);
+
+  return NULL;
+}
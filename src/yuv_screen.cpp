@@ -2,7 +2,7 @@
  *  (c) Copyright 2009 Denis Roio aka jaromil <jaromil@dyne.org>
  *
  * This source code is free software; you can redistribute it and/or
- * modify it under the terms of the GNU Public License as published 
+ * modify it under the terms of the GNU Public License as published
  * by the Free Software Foundation; either version 3 of the License,
  * or (at your option) any later version.
  *
@@ -20,34 +20,152 @@
 #include <config.h>
 
 #include <stdlib.h>
+#include <string.h>
+
+#include <layer.h>
+#include <blitter.h>
 
 #include <jutils.h>
 #include <yuv_screen.h>
 
+// our objects are allowed to be created trough the factory engine
+FACTORY_REGISTER_INSTANTIATOR(ViewPort, YuvScreen, Screen, yuv);
+
+// byte order of the RGBA frames of layers, see the bitmasks in screen.h
+#if rchan == 1
+#define LAYER_FOURCC ViewPort::ARGB32
+#else
+#define LAYER_FOURCC ViewPort::BGRA32
+#endif
+
 YuvScreen::YuvScreen()
   : ViewPort() {
 
   yuv_buffer = NULL;
-  rgb_buffer = NULL;
-
+  rgb_frame = NULL;
+  rgb_frame_size = 0;
+  converter.set_format(LAYER_FOURCC);
+  set_name("YUV");
 }
 
 YuvScreen::~YuvScreen() {
   func("%s",__PRETTY_FUNCTION__);
-  if(yuv_buffer) delete yuv_buffer;
-  if(rgb_buffer) delete rgb_buffer;
+  if(yuv_buffer) free(yuv_buffer);
+  if(rgb_frame) free(rgb_frame);
+}
+
+bool YuvScreen::_init() {
+
+  if((geo.w & 1) || (geo.h & 1)) {
+    error("YUV screen needs an even size, %ux%u is not", geo.w, geo.h);
+    return(false);
+  }
+  yuv_buffer = (uint8_t*)malloc(geo.w * geo.h * 3 / 2);
+  clear();
+  return(true);
 }
 
-bool YuvScreen::init(int w, int h) {
+void YuvScreen::setup_blits(Layer *lay) {
+  Blit *b, *next;
 
-  this->w = w;
-  this->h = h;
-  bpp = 32;
-  size = w*h*(bpp>>3);
-  pitch = w*(bpp>>3);
+  Blitter *blitter = new Blitter();
+
+  // scalar kernels, the rows of the chroma planes are short and odd
+  setup_linear_blits(blitter, 0);
+
+  // keep only the blits that work on yuv samples as well
+  b = blitter->blitlist.begin();
+  while(b) {
+    next = (Blit*)b->next;
+    if(strcmp(b->name, "RGB") && strcmp(b->name, "ALPHA")) {
+      b->rem();
+      delete b;
+    }
+    b = next;
+  }
+
+  lay->blitter = blitter;
+
+  if(!lay->set_yuv420(true))
+    act("layer %s is converted to yuv by screen %s", lay->name, name);
+
+  lay->set_blit("RGB"); // default
+}
 
-  yuv_buffer = malloc(size);
-  rgb_buffer = malloc(size);
+void YuvScreen::blit(Layer *src) {
+  Blit *b;
+  uint8_t *frame, *sp, *dp, *splane, *dplane;
+  int lw, lh, x, y, sx, sy, w, h, p, shift, row;
+  uint32_t size;
 
+  if(src->screen != this) {
+    error("%s: blit called on a layer not belonging to screen",
+	  __PRETTY_FUNCTION__);
+    return;
+  }
+
+  b = src->current_blit;
+  if(!b) return;
+
+  lw = src->geo.w & ~1;
+  lh = src->geo.h & ~1;
+
+  if(src->buffer_yuv420)
+    frame = (uint8_t*)src->buffer;
+  else {
+    // RGBA frames are converted once, then blitted like yuv ones
+    size = lw * lh * 3 / 2;
+    if(rgb_frame_size < size) {
+      rgb_frame = (uint8_t*)realloc(rgb_frame, size);
+      rgb_frame_size = size;
+    }
+    converter.convert((uint8_t*)src->buffer, lw, lh, src->geo.bytewidth,
+		      rgb_frame, rgb_frame + lw * lh,
+		      rgb_frame + lw * lh + (lw >> 1) * (lh >> 1), NULL);
+    frame = rgb_frame;
+  }
+
+  // layers sit on even coordinates, so that chroma is not shifted
+  x = src->geo.x & ~1;
+  y = src->geo.y & ~1;
+  sx = (x < 0) ? -x : 0;
+  sy = (y < 0) ? -y : 0;
+  x += sx;
+  y += sy;
+  w = (x + lw - sx > geo.w) ? geo.w - x : lw - sx;
+  h = (y + lh - sy > geo.h) ? geo.h - y : lh - sy;
+  if(w <= 0 || h <= 0) return;
+
+  // the same blit on each plane, rows are of one byte per sample
+  splane = frame;
+  dplane = yuv_buffer;
+  for(p = 0; p < 3; p++) {
+    shift = p ? 1 : 0;
+    sp = splane + (sy >> shift) * (lw >> shift) + (sx >> shift);
+    dp = dplane + (y >> shift) * (geo.w >> shift) + (x >> shift);
+
+    for(row = h >> shift; row > 0; row--) {
+      (*b->fun)((void*)sp, (void*)dp, w >> shift, &b->parameters);
+      sp += lw >> shift;
+      dp += geo.w >> shift;
+    }
+
+    splane += (lw >> shift) * (lh >> shift);
+    dplane += (geo.w >> shift) * (geo.h >> shift);
+  }
+}
+
+void YuvScreen::clear() {
+  if(!yuv_buffer) return;
+  // black is 16 in the luma range of RGB2YUV, chroma is centered
+  memset(yuv_buffer, 16, geo.w * geo.h);
+  memset(yuv_buffer + geo.w * geo.h, 128, geo.w * geo.h / 2);
+}
+
+void *YuvScreen::coords(int x, int y) {
+  return ( yuv_buffer + y * geo.w + x );
+}
 
+void *YuvScreen::get_surface() {
+  return yuv_buffer;
 }
@@ -0,0 +1,316 @@
+/*  FreeJ
+ *  (c) Copyright 2010 Denis Roio <jaromil@dyne.org>
+ *
+ * This source code is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Public License as published
+ * by the Free Software Foundation; either version 3 of the License,
+ * or (at your option) any later version.
+ *
+ * This source code is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * Please refer to the GNU Public License for more details.
+ *
+ * You should have received a copy of the GNU Public License along with
+ * this source code; if not, write to:
+ * Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+  Benchmark of the pixel kernels of FreeJ: memory copy methods, linear
+  blits (scalar and SIMD), compositing of many layers, colorspace
+  conversions for the encoders and rotozoom.
+
+  Each kernel runs on full frames at several resolutions for at least
+  the time given with -t, results are printed as a table or, with -m,
+  as comma separated values to track performance regressions:
+
+  kernel,variant,width,height,layers,ns_per_pixel,mb_per_sec
+
+  ns_per_pixel is the time spent for each pixel of the frame, mb_per_sec
+  counts the source bytes processed (4 per pixel and per layer).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <config.h>
+
+#include <fps.h>
+#include <jutils.h>
+#include <fastmemcpy.h>
+#include <cpu_accel.h>
+#include <convertvid.h>
+#include <ccvt.h>
+#include <SDL_rotozoom.h>
+
+#include <blitter.h>
+#include <layer.h>
+#include <rotozoom.h>
+#include <worker_pool.h>
+#include <i420_convert.h>
+
+static const char *help =
+"Usage: freej-bench [options]\n"
+"  -h         print this help\n"
+"  -m         machine readable output (csv)\n"
+"  -t msecs   minimum time for each kernel - default 200\n"
+"  -s WxH     only benchmark this resolution\n"
+"  -k name    only benchmark kernels whose name contains this\n";
+
+static struct { const char *name; int w; int h; } resolutions[] = {
+  { "SD",   720,  576 },
+  { "HD",  1280,  720 },
+  { "FHD", 1920, 1080 },
+  { "4K",  3840, 2160 },
+  { NULL, 0, 0 }
+};
+
+static int layer_counts[] = { 1, 2, 4, 8, 0 };
+
+// blits composited with many layers
+static const char *composite_blits[] = { "RGB", "ADD", "ALPHA", NULL };
+
+static bool csv = false;
+static uint64_t min_time = 200000000ULL; // nanoseconds
+static int only_w = 0, only_h = 0;
+static const char *only_kernel = NULL;
+
+// frame buffers shared by all kernels
+#define MAX_LAYERS 8
+static uint32_t *src[MAX_LAYERS];
+static uint32_t *dst;
+static uint8_t *yuyv, *plane_y, *plane_u, *plane_v;
+static int width, height;
+
+/// layer only holding a frame for the rotozoom engine
+class BenchLayer: public Layer {
+ public:
+  void *feed() { return buffer; };
+ protected:
+  bool _init() { return true; };
+};
+
+static bool selected(const char *kernel) {
+  return !only_kernel || strstr(kernel, only_kernel);
+}
+
+static void report(const char *kernel, const char *variant,
+		   int layers, uint64_t ns, uint32_t runs) {
+  double pixels = (double)width * height * runs;
+  double ns_pixel = ns / pixels;
+  double mbs = (pixels * 4 * layers) / (ns / 1000000000.0) / 1048576.0;
+
+  if(csv)
+    fprintf(stdout, "%s,%s,%u,%u,%u,%.4f,%.1f\n",
+	    kernel, variant, width, height, layers, ns_pixel, mbs);
+  else
+    fprintf(stdout, "%-10s %-28s %4ux%-4u %2u layers %9.4f ns/px %9.1f MB/s\n",
+	    kernel, variant, width, height, layers, ns_pixel, mbs);
+  fflush(stdout);
+}
+
+/// run a kernel until min_time passed, then report its speed
+#define BENCH(kernel, variant, layers, code) {			\
+    uint64_t start, ns;						\
+    uint32_t runs = 0;						\
+    code; /* warm up caches and lazy allocations */		\
+    start = FPS::wall();					\
+    do { code; runs++; ns = FPS::wall() - start; }		\
+    while(ns < min_time);					\
+    report(kernel, variant, layers, ns, runs);			\
+  }
+
+static void blit_frame(blit_f *fun, Blit *b, uint32_t *s) {
+  int y, pitch = width * 4;
+  for(y = 0; y < height; y++)
+    (*fun)(s + y * width, dst + y * width, pitch, &b->parameters);
+}
+
+static void bench_memcpy() {
+  void *(*fun)(void *to, const void *from, size_t len);
+  const char *name;
+  int c;
+
+  if(!selected("memcpy")) return;
+  for(c = 0; (name = get_memcpy_method(c, &fun)); c++)
+    BENCH("memcpy", name, 1, (*fun)(dst, src[0], width * height * 4));
+}
+
+static void bench_blits(Blitter *scalar, uint32_t accel) {
+  Blit *b;
+  blit_f *simd;
+  char variant[64];
+
+  if(!selected("blit")) return;
+  b = scalar->blitlist.begin();
+  while(b) {
+    if(b->type == Blit::LINEAR) {
+      snprintf(variant, sizeof(variant), "%s scalar", b->name);
+      BENCH("blit", variant, 1, blit_frame(b->fun, b, src[0]));
+
+      simd = accel_linear_blit(b->name, accel);
+      if(simd) {
+	snprintf(variant, sizeof(variant), "%s %s", b->name,
+		 (accel & MM_ACCEL_X86_AVX2) ? "avx2" : "sse2");
+	BENCH("blit", variant, 1, blit_frame(simd, b, src[0]));
+      }
+    }
+    b = (Blit*)b->next;
+  }
+}
+
+static void bench_composite(Blitter *blitter, uint32_t accel) {
+  Blit *b;
+  blit_f *fun;
+  int c, l, layers;
+
+  if(!selected("composite")) return;
+  for(c = 0; composite_blits[c]; c++) {
+    b = blitter->blitlist.search(composite_blits[c], NULL);
+    if(!b) continue;
+    fun = accel_linear_blit(b->name, accel);
+    if(!fun) fun = b->fun;
+
+    for(l = 0; layer_counts[l]; l++) {
+      layers = layer_counts[l];
+      BENCH("composite", b->name, layers,
+	    for(int n = 0; n < layers; n++) blit_frame(fun, b, src[n]));
+    }
+  }
+}
+
+static void bench_convert(WorkerPool *pool) {
+  I420Convert i420;
+  char variant[64];
+
+  if(!selected("convert")) return;
+  BENCH("convert", "rgb24a to yuv422", 1,
+	mlt_convert_rgb24a_to_yuv422((uint8_t*)src[0], width, height,
+				     width * 4, yuyv, NULL));
+  BENCH("convert", "bgr24a to yuv422", 1,
+	mlt_convert_bgr24a_to_yuv422((uint8_t*)src[0], width, height,
+				     width * 4, yuyv, NULL));
+  BENCH("convert", "argb to yuv422", 1,
+	mlt_convert_argb_to_yuv422((uint8_t*)src[0], width, height,
+				   width * 4, yuyv, NULL));
+  BENCH("convert", "yuyv to 420p", 1,
+	ccvt_yuyv_420p(width, height, yuyv, plane_y, plane_u, plane_v));
+
+  i420.set_format(ViewPort::RGBA32);
+  BENCH("convert", "rgba to i420", 1,
+	i420.convert((uint8_t*)src[0], width, height, width * 4,
+		     plane_y, plane_u, plane_v, NULL));
+  snprintf(variant, sizeof(variant), "rgba to i420 %u threads", pool->threads() + 1);
+  BENCH("convert", variant, 1,
+	i420.convert((uint8_t*)src[0], width, height, width * 4,
+		     plane_y, plane_u, plane_v, pool));
+}
+
+static void bench_rotozoom(WorkerPool *pool) {
+  SDL_Surface *surf, *rot;
+  BenchLayer lay;
+  RotoZoom rz;
+  char variant[64];
+  int smooth;
+
+  if(!selected("rotozoom")) return;
+
+  surf = SDL_CreateRGBSurfaceFrom(src[0], width, height, 32, width * 4,
+				  red_bitmask, green_bitmask, blue_bitmask, alpha_bitmask);
+
+  lay.geo.init(width, height, 32);
+  lay.buffer = src[0];
+  lay.rotating = true;
+  lay.rotate = 30.0;
+  lay.zoom_x = lay.zoom_y = 1.0;
+
+  for(smooth = 0; smooth < 2; smooth++) {
+    snprintf(variant, sizeof(variant), "sdl_gfx%s", smooth ? " smooth" : "");
+    BENCH("rotozoom", variant, 1,
+	  rot = rotozoomSurface(surf, 30.0, 1.0, smooth); SDL_FreeSurface(rot));
+
+    lay.antialias = smooth;
+    rz.setup(&lay);
+    snprintf(variant, sizeof(variant), "engine%s", smooth ? " smooth" : "");
+    BENCH("rotozoom", variant, 1, rz.render(NULL));
+
+    snprintf(variant, sizeof(variant), "engine%s %u threads",
+	     smooth ? " smooth" : "", pool->threads() + 1);
+    BENCH("rotozoom", variant, 1, rz.render(pool));
+  }
+
+  lay.buffer = NULL;
+  SDL_FreeSurface(surf);
+}
+
+int main(int argc, char **argv) {
+  Blitter blitter;
+  WorkerPool pool;
+  uint32_t accel;
+  int c, r, res;
+  size_t bytes;
+
+  while((res = getopt(argc, argv, "hmt:s:k:")) != -1) {
+    switch(res) {
+    case 'm': csv = true; break;
+    case 't': min_time = strtoull(optarg, NULL, 10) * 1000000ULL; break;
+    case 's': sscanf(optarg, "%ux%u", &only_w, &only_h); break;
+    case 'k': only_kernel = optarg; break;
+    case 'h':
+    default:
+      fprintf(stderr, "%s", help);
+      exit(res == 'h' ? 0 : 1);
+    }
+  }
+
+  set_debug(0);
+  find_best_memcpy();
+  accel = mm_accel();
+  setup_linear_blits(&blitter, 0); // scalar kernels
+  pool.init();
+
+  if(csv)
+    fprintf(stdout, "kernel,variant,width,height,layers,ns_per_pixel,mb_per_sec\n");
+
+  for(r = 0; resolutions[r].name; r++) {
+    width = resolutions[r].w;
+    height = resolutions[r].h;
+    if(only_w && (only_w != width || only_h != height)) continue;
+
+    bytes = width * height * 4;
+    for(c = 0; c < MAX_LAYERS; c++) {
+      src[c] = (uint32_t*)malloc(bytes);
+      // some noise so that no kernel takes shortcuts
+      for(size_t p = 0; p < bytes / 4; p++)
+	src[c][p] = (uint32_t)(p * 2654435761U + c * 40503U);
+    }
+    dst = (uint32_t*)calloc(1, bytes);
+    yuyv = (uint8_t*)malloc(width * height * 2);
+    plane_y = (uint8_t*)malloc(width * height);
+    plane_u = (uint8_t*)malloc(width * height / 4);
+    plane_v = (uint8_t*)malloc(width * height / 4);
+
+    if(!csv)
+      fprintf(stdout, "== %s %ux%u\n", resolutions[r].name, width, height);
+
+    bench_memcpy();
+    bench_blits(&blitter, accel);
+    bench_composite(&blitter, accel);
+    bench_convert(&pool);
+    bench_rotozoom(&pool);
+
+    for(c = 0; c < MAX_LAYERS; c++) free(src[c]);
+    free(dst);
+    free(yuyv);
+    free(plane_y);
+    free(plane_u);
+    free(plane_v);
+  }
+
+  pool.close();
+  return 0;
+}
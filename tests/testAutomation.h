@@ -0,0 +1,111 @@
+#include <cxxtest/TestSuite.h>
+
+#include <math.h>
+
+#include <config.h>
+#include <jutils.h>
+#include <fps.h>
+#include <parameter.h>
+#include <automation.h>
+
+// envelopes of keyframes give the value of a parameter at each frame
+class TestAutomation : public CxxTest::TestSuite
+{
+public:
+   enum { SEC = 1000000000 };
+
+   void setUp( void )
+   {
+      set_debug(0);
+      FPS::set_virtual( true ); // nobody moves the clock but us
+      start = FPS::now();
+   }
+
+   void tearDown( void )
+   {
+      Automation::drop( owner() );
+      TS_ASSERT_EQUALS( Automation::tracks(), 0 );
+      FPS::set_virtual( false );
+   }
+
+   void testCurves( void )
+   {
+      Parameter step( Parameter::NUMBER ), line( Parameter::NUMBER ), smooth( Parameter::NUMBER );
+
+      add( &step, AUTOMATION_STEP, ONCE );
+      add( &line, AUTOMATION_LINEAR, ONCE );
+      add( &smooth, AUTOMATION_SMOOTH, ONCE );
+
+      TS_ASSERT_EQUALS( Automation::run( start + SEC / 4 ), 3 );
+      TS_ASSERT_DELTA( value( &step ), 0.0, 1e-9 );
+      TS_ASSERT_DELTA( value( &line ), 0.25, 1e-9 );
+      TS_ASSERT_DELTA( value( &smooth ), ( 1.0 - cos( M_PI / 4 ) ) / 2, 1e-9 );
+      TS_ASSERT( line.changed );
+
+      // only the values which changed are applied
+      TS_ASSERT_EQUALS( Automation::run( start + SEC / 4 ), 0 );
+      TS_ASSERT_EQUALS( Automation::run( start + SEC / 2 ), 2 );
+   }
+
+   void testRepeat( void )
+   {
+      Parameter once( Parameter::NUMBER ), loop( Parameter::NUMBER ), bounce( Parameter::NUMBER );
+
+      add( &once, AUTOMATION_LINEAR, ONCE );
+      add( &loop, AUTOMATION_LINEAR, LOOP );
+      add( &bounce, AUTOMATION_LINEAR, BOUNCE );
+
+      Automation::run( start + SEC + SEC / 4 );
+      TS_ASSERT_DELTA( value( &once ), 1.0, 1e-9 );
+      TS_ASSERT_DELTA( value( &loop ), 0.25, 1e-9 );
+      TS_ASSERT_DELTA( value( &bounce ), 0.75, 1e-9 );
+
+      // a track running once ends with its last keyframe
+      TS_ASSERT_EQUALS( Automation::tracks(), 2 );
+   }
+
+   void testMultiplierAndRemove( void )
+   {
+      Parameter p( Parameter::NUMBER );
+      int id;
+
+      p.multiplier = 255.0;
+      id = add( &p, AUTOMATION_LINEAR, LOOP );
+      Automation::run( start + SEC / 2 );
+      TS_ASSERT_DELTA( value( &p ), 127.5, 1e-6 );
+
+      // removed, the value stays where it is
+      TS_ASSERT( Automation::remove( id ) );
+      TS_ASSERT( ! Automation::remove( id ) );
+      Automation::run( start + SEC );
+      TS_ASSERT_DELTA( value( &p ), 127.5, 1e-6 );
+   }
+
+   void testBadKeyframes( void )
+   {
+      Parameter p( Parameter::NUMBER );
+      double times[] = { 1.0, 0.0 }, values[] = { 0.0, 1.0 };
+
+      TS_ASSERT_EQUALS( Automation::add( owner(), &p, 1, 0, times, values, 2,
+                                         AUTOMATION_LINEAR, ONCE ), -1 );
+      TS_ASSERT_EQUALS( Automation::add( owner(), &p, 1, 0, times, values, 0,
+                                         AUTOMATION_LINEAR, ONCE ), -1 );
+   }
+
+private:
+   uint64_t start;
+
+   // tracks are only stored on filters, never dereferenced
+   FilterInstance *owner( void ) { return (FilterInstance*)this; }
+
+   // from 0 to 1 in a second
+   int add( Parameter *p, automation_curve_t curve, iterator_mode_t mode )
+   {
+      double times[] = { 0.0, 1.0 }, values[] = { 0.0, 1.0 };
+      int id = Automation::add( owner(), p, 1, 0, times, values, 2, curve, mode );
+      TS_ASSERT( id > 0 );
+      return id;
+   }
+
+   double value( Parameter *p ) { return *(double*)p->value; }
+};
@@ -0,0 +1,86 @@
+#include <cxxtest/TestSuite.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <config.h>
+#include <jutils.h>
+#include <bounded_queue.h>
+
+// pipeline stages hand pointers over in order and are stopped by abort()
+class TestBoundedQueue : public CxxTest::TestSuite
+{
+public:
+   void setUp( void )
+   {
+      set_debug(0);
+   }
+
+   void testOrder( void )
+   {
+      BoundedQueue q;
+      long c;
+
+      TS_ASSERT( q.init( 3 ) );
+      // wraps around the end of the ring a few times
+      for( c = 1; c <= 10; c++ ) {
+         TS_ASSERT( q.push( (void*)c ) );
+         TS_ASSERT( q.try_push( (void*)(c + 100) ) );
+         TS_ASSERT_EQUALS( q.depth(), 2 );
+         TS_ASSERT_EQUALS( q.pop(), (void*)c );
+         TS_ASSERT_EQUALS( q.try_pop(), (void*)(c + 100) );
+      }
+      TS_ASSERT( q.try_pop() == NULL );
+   }
+
+   void testFull( void )
+   {
+      BoundedQueue q;
+
+      q.init( 2 );
+      TS_ASSERT( q.try_push( (void*)1 ) );
+      TS_ASSERT( q.try_push( (void*)2 ) );
+      TS_ASSERT( ! q.try_push( (void*)3 ) );
+      TS_ASSERT_EQUALS( q.depth(), 2 );
+   }
+
+   void testAbortWakesWaiters( void )
+   {
+      BoundedQueue q;
+      pthread_t popper;
+      void *res = (void*)1;
+
+      q.init( 2 );
+      pthread_create( &popper, NULL, pop_run, &q );
+      usleep( 20000 ); // let it wait on the empty queue
+      q.abort();
+      pthread_join( popper, &res );
+      TS_ASSERT( res == NULL );
+
+      // later calls fail at once, what was queued can still be drained
+      TS_ASSERT( ! q.push( (void*)1 ) );
+      TS_ASSERT( ! q.try_push( (void*)1 ) );
+      TS_ASSERT( q.pop() == NULL );
+   }
+
+   void testReset( void )
+   {
+      BoundedQueue q;
+
+      q.init( 2 );
+      q.push( (void*)7 );
+      q.abort();
+      TS_ASSERT( q.pop() == NULL );
+      TS_ASSERT_EQUALS( q.try_pop(), (void*)7 );
+
+      q.reset();
+      TS_ASSERT( q.push( (void*)8 ) );
+      TS_ASSERT_EQUALS( q.pop(), (void*)8 );
+   }
+
+private:
+   static void *pop_run( void *arg )
+   {
+      return ((BoundedQueue*)arg)->pop();
+   }
+};
@@ -0,0 +1,101 @@
+#include <cxxtest/TestSuite.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <config.h>
+#include <jutils.h>
+#include <buffer_pool.h>
+
+// buffers given back are handed out again instead of allocated
+class TestBufferPool : public CxxTest::TestSuite
+{
+public:
+   void setUp( void )
+   {
+      set_debug(0);
+      BufferPool::trim();
+   }
+
+   void tearDown( void )
+   {
+      BufferPool::trim();
+      TS_ASSERT_EQUALS( BufferPool::kept, 0U );
+   }
+
+   void testReuse( void )
+   {
+      void *a, *b;
+      uint64_t allocations = BufferPool::allocations;
+
+      a = BufferPool::get( 1000 );
+      TS_ASSERT( a != NULL );
+      TS_ASSERT_EQUALS( (uintptr_t)a & 15, 0U );
+      memset( a, 1, 1000 );
+      BufferPool::put( a );
+      TS_ASSERT( BufferPool::kept >= 1000 );
+
+      // same size, same buffer
+      b = BufferPool::get( 1000 );
+      TS_ASSERT_EQUALS( a, b );
+      TS_ASSERT_EQUALS( BufferPool::allocations, allocations + 1 );
+      BufferPool::put( b );
+      BufferPool::put( NULL );
+   }
+
+   void testZero( void )
+   {
+      uint8_t *a, zero[256];
+
+      memset( zero, 0, sizeof(zero) );
+      a = (uint8_t*)BufferPool::get( sizeof(zero) );
+      memset( a, 0xff, sizeof(zero) );
+      BufferPool::put( a );
+      a = (uint8_t*)BufferPool::get_zero( sizeof(zero) );
+      TS_ASSERT_SAME_DATA( a, zero, sizeof(zero) );
+      BufferPool::put( a );
+   }
+
+   void testPacketsOfAnySize( void )
+   {
+      void *a, *b;
+      size_t size;
+      uint64_t allocations;
+
+      // close sizes share a power of two, small or large
+      for( size = 100; size < 4194304; size *= 3 ) {
+         a = BufferPool::get_packet( size );
+         memset( a, 2, size );
+         BufferPool::put( a );
+         b = BufferPool::get_packet( size | (size >> 1) );
+         TS_ASSERT_EQUALS( a, b );
+         BufferPool::put( b );
+      }
+
+      // a slab for each size of frame is still there after many packets
+      for( size = 300000; size < 400000; size += 4096 )
+         BufferPool::put( BufferPool::get_packet( size ) );
+      allocations = BufferPool::allocations;
+      for( size = 1; size <= BUFFER_POOL_SLABS; size++ )
+         BufferPool::put( BufferPool::get( size * 65536 ) );
+      for( size = 1; size <= BUFFER_POOL_SLABS; size++ )
+         BufferPool::put( BufferPool::get( size * 65536 ) );
+      TS_ASSERT_EQUALS( BufferPool::allocations, allocations + BUFFER_POOL_SLABS );
+   }
+
+   void testTrim( void )
+   {
+      uint64_t allocations;
+
+      BufferPool::put( BufferPool::get( 4096 ) );
+      BufferPool::put( BufferPool::get_packet( 4096 ) );
+      TS_ASSERT( BufferPool::kept > 0 );
+      BufferPool::trim();
+      TS_ASSERT_EQUALS( BufferPool::kept, 0U );
+
+      // nothing left to reuse
+      allocations = BufferPool::allocations;
+      BufferPool::put( BufferPool::get( 4096 ) );
+      TS_ASSERT_EQUALS( BufferPool::allocations, allocations + 1 );
+   }
+};
@@ -0,0 +1,117 @@
+#include <cxxtest/TestSuite.h>
+
+#include <string.h>
+
+#include <config.h>
+#include <jutils.h>
+#include <clip_cache.h>
+
+// decoded clips stay in memory within a budget, least recently used go first
+class TestClipCache : public CxxTest::TestSuite
+{
+public:
+   enum { W = 4, H = 4, FRAME = W * H * 4 };
+
+   void setUp( void )
+   {
+      set_debug(0);
+      memset( frame, 0x5a, FRAME );
+   }
+
+   void tearDown( void )
+   {
+      ClipCache::set_budget( 0 ); // evicts what is left
+      TS_ASSERT_EQUALS( ClipCache::get_used(), 0U );
+   }
+
+   void testDisabled( void )
+   {
+      ClipCache::set_budget( 0 );
+      TS_ASSERT( ClipCache::create( "clip", W, H ) == NULL );
+   }
+
+   void testFillAndFind( void )
+   {
+      CachedClip *clip;
+      int c;
+
+      ClipCache::set_budget( 1048576 );
+      clip = ClipCache::create( "clip", W, H );
+      TS_ASSERT( clip != NULL );
+      for( c = 0; c < 5; c++ )
+         TS_ASSERT( ClipCache::add_frame( clip, frame, c * 0.04 ) );
+
+      // not complete yet, nobody else gets it
+      TS_ASSERT( ClipCache::find( "clip", W, H ) == NULL );
+      ClipCache::finish( clip );
+      TS_ASSERT( clip->complete );
+      TS_ASSERT_EQUALS( clip->count, 5 );
+      TS_ASSERT_SAME_DATA( clip->frame( 4 ), frame, FRAME );
+
+      TS_ASSERT_EQUALS( clip->find( -1.0 ), 0 );
+      TS_ASSERT_EQUALS( clip->find( 0.09 ), 2 );
+      TS_ASSERT_EQUALS( clip->find( 0.12 ), 3 );
+      TS_ASSERT_EQUALS( clip->find( 10.0 ), 4 );
+
+      // complete clips stay for the next user, at the same size only
+      ClipCache::release( clip );
+      TS_ASSERT_EQUALS( ClipCache::find( "clip", W, H ), clip );
+      TS_ASSERT( ClipCache::find( "clip", W, H * 2 ) == NULL );
+      ClipCache::release( clip );
+   }
+
+   void testIncompleteDropped( void )
+   {
+      CachedClip *clip;
+
+      ClipCache::set_budget( 1048576 );
+      clip = ClipCache::create( "clip", W, H );
+      ClipCache::add_frame( clip, frame, 0.0 );
+      TS_ASSERT( ClipCache::get_used() > 0 );
+      ClipCache::release( clip );
+      TS_ASSERT_EQUALS( ClipCache::get_used(), 0U );
+   }
+
+   void testEviction( void )
+   {
+      CachedClip *a, *b, *c;
+      size_t one;
+
+      ClipCache::set_budget( 1048576 );
+      a = fill( "a", 1 );
+      one = ClipCache::get_used();
+      ClipCache::release( a );
+
+      // room for two clips of one frame: a third evicts the oldest unused
+      ClipCache::set_budget( one * 2 );
+      b = fill( "b", 1 );
+      ClipCache::release( b );
+      TS_ASSERT( ClipCache::find( "a", W, H ) != NULL ); // a is used again
+      ClipCache::release( a );
+      c = fill( "c", 1 );
+      TS_ASSERT( c->complete );
+      TS_ASSERT( ClipCache::find( "b", W, H ) == NULL );
+      TS_ASSERT( ClipCache::get_used() <= ClipCache::get_budget() );
+
+      // clips in use are never evicted, the new one gives up instead
+      TS_ASSERT( ClipCache::find( "a", W, H ) == a );
+      b = ClipCache::create( "b", W, H );
+      TS_ASSERT( ! ClipCache::add_frame( b, frame, 0.0 ) );
+      ClipCache::release( b );
+      ClipCache::release( a );
+      ClipCache::release( c );
+   }
+
+private:
+   uint8_t frame[FRAME];
+
+   CachedClip *fill( const char *name, int frames )
+   {
+      CachedClip *clip = ClipCache::create( name, W, H );
+      int n;
+      for( n = 0; n < frames; n++ )
+         ClipCache::add_frame( clip, frame, n * 0.04 );
+      ClipCache::finish( clip );
+      return clip;
+   }
+};
@@ -0,0 +1,64 @@
+#include <cxxtest/TestSuite.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <config.h>
+#include <jutils.h>
+#include <cpu_accel.h>
+#include <i420_convert.h>
+
+// the SSE2 conversion must give the same planes as the plain C one
+class TestI420Convert : public CxxTest::TestSuite
+{
+public:
+   enum { MAX_W = 70, MAX_H = 10, TRIALS = 32 };
+
+   void setUp( void )
+   {
+      set_debug(0);
+      srand( 1 );
+   }
+
+   void testSimdMatchesScalar( void )
+   {
+      ViewPort::fourcc formats[] = { ViewPort::RGBA32, ViewPort::BGRA32, ViewPort::ARGB32 };
+      I420Convert scalar( 0 ), simd( mm_accel() );
+      int f, trial, c, w, h;
+
+      if( ! ( mm_accel() & MM_ACCEL_X86_SSE2 ) ) {
+         TS_WARN( "no SSE2 on this cpu" );
+         return;
+      }
+
+      for( f = 0; f < 3; f++ ) {
+         TS_ASSERT( scalar.set_format( formats[f] ) );
+         TS_ASSERT( simd.set_format( formats[f] ) );
+
+         for( trial = 0; trial < TRIALS; trial++ ) {
+            // widths which leave a tail to the scalar code, padded rows
+            w = ( rand() % (MAX_W / 2) + 1 ) * 2;
+            h = ( rand() % (MAX_H / 2) + 1 ) * 2;
+            for( c = 0; c < (int)sizeof(src); c++ )
+               src[c] = rand();
+            // the first trial hits the ends of the range
+            if( trial == 0 ) memset( src, 0, sizeof(src) );
+            if( trial == 1 ) memset( src, 0xff, sizeof(src) );
+            memset( ref, 0, sizeof(ref) );
+            memset( out, 0, sizeof(out) );
+
+            scalar.convert( src, w, h, MAX_W * 4, ref, ref + PLANE, ref + PLANE * 2, NULL );
+            simd.convert( src, w, h, MAX_W * 4, out, out + PLANE, out + PLANE * 2, NULL );
+
+            TS_ASSERT_SAME_DATA( ref, out, sizeof(ref) );
+            if( memcmp( ref, out, sizeof(ref) ) ) return; // once is enough
+         }
+      }
+   }
+
+private:
+   enum { PLANE = MAX_W * MAX_H };
+   uint8_t src[MAX_W * MAX_H * 4];
+   uint8_t ref[PLANE * 3];
+   uint8_t out[PLANE * 3];
+};
@@ -0,0 +1,66 @@
+#include <cxxtest/TestSuite.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <config.h>
+#include <jutils.h>
+#include <cpu_accel.h>
+#include <i420_scale.h>
+
+// the SSE2 scaling must give the same planes as the plain C one
+class TestI420Scale : public CxxTest::TestSuite
+{
+public:
+   enum { MAX_W = 96, MAX_H = 24, TRIALS = 32 };
+
+   void setUp( void )
+   {
+      set_debug(0);
+      srand( 1 );
+   }
+
+   void testSimdMatchesScalar( void )
+   {
+      I420Scale scalar( 0 ), simd( mm_accel() );
+      int trial, c, sw, sh, dw, dh;
+
+      if( ! ( mm_accel() & MM_ACCEL_X86_SSE2 ) ) {
+         TS_WARN( "no SSE2 on this cpu" );
+         return;
+      }
+
+      for( trial = 0; trial < TRIALS; trial++ ) {
+         // widths which leave a tail to the scalar code, shrinking at most by half
+         sw = ( rand() % (MAX_W / 4) + MAX_W / 4 ) * 2;
+         sh = ( rand() % (MAX_H / 4) + MAX_H / 4 ) * 2;
+         dw = ( rand() % (sw / 4) + sw / 4 + 1 ) * 2;
+         dh = ( rand() % (sh / 4) + sh / 4 + 1 ) * 2;
+         if( dw > sw ) dw = sw;
+         if( dh > sh ) dh = sh;
+         for( c = 0; c < (int)sizeof(src); c++ )
+            src[c] = rand();
+         memset( ref, 0, sizeof(ref) );
+         memset( out, 0, sizeof(out) );
+
+         run( &scalar, sw, sh, ref, dw, dh );
+         run( &simd, sw, sh, out, dw, dh );
+
+         TS_ASSERT_SAME_DATA( ref, out, sizeof(ref) );
+         if( memcmp( ref, out, sizeof(ref) ) ) return; // once is enough
+      }
+   }
+
+private:
+   enum { PLANE = MAX_W * MAX_H };
+   uint8_t src[PLANE * 3 / 2];
+   uint8_t ref[PLANE * 3 / 2];
+   uint8_t out[PLANE * 3 / 2];
+
+   void run( I420Scale *s, int sw, int sh, uint8_t *d, int dw, int dh )
+   {
+      int sy = sw * sh, dy = dw * dh;
+      s->scale( src, src + sy, src + sy + sy / 4, sw, sh,
+                d, d + dy, d + dy + dy / 4, dw, dh, NULL );
+   }
+};
@@ -0,0 +1,109 @@
+#include <cxxtest/TestSuite.h>
+
+#include <stdio.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <config.h>
+#include <jutils.h>
+#include <keyframe_index.h>
+
+// seeks jump to the last keyframe at or before the time asked
+class TestKeyframeIndex : public CxxTest::TestSuite
+{
+public:
+   void setUp( void )
+   {
+      FILE *fd;
+
+      set_debug(0);
+      snprintf( movie, sizeof(movie), "/tmp/freej-test-%u.mov", (unsigned)getpid() );
+      snprintf( index, sizeof(index), "%s%s", movie, KEYFRAME_INDEX_SUFFIX );
+
+      fd = fopen( movie, "w" );
+      fputs( "not a movie", fd );
+      fclose( fd );
+
+      // as saved by a previous run
+      fd = fopen( index, "w" );
+      fputs( "FreeJ keyframe index 1\nstream 0 keys 3\n"
+             "0 0 0.000000\n100 4096 2.000000\n200 8192 4.000000\n", fd );
+      fclose( fd );
+
+      KeyframeIndex::persist = true;
+   }
+
+   void tearDown( void )
+   {
+      KeyframeIndex::persist = false;
+      unlink( index );
+      unlink( movie );
+   }
+
+   void testEmpty( void )
+   {
+      KeyframeIndex idx;
+      KeyframeIndex::keyframe_t k;
+
+      TS_ASSERT( ! idx.find( 0.0, &k ) );
+      TS_ASSERT_EQUALS( idx.count(), 0 );
+   }
+
+   void testFind( void )
+   {
+#ifdef WITH_FFMPEG
+      KeyframeIndex idx;
+      KeyframeIndex::keyframe_t k;
+
+      idx.build( movie, 0, 0, 0.02 );
+      TS_ASSERT( wait_complete( &idx ) );
+      TS_ASSERT_EQUALS( idx.count(), 3 );
+
+      TS_ASSERT( idx.find( -1.0, &k ) );
+      TS_ASSERT_EQUALS( k.ts, 0 );
+      TS_ASSERT( idx.find( 1.99, &k ) );
+      TS_ASSERT_EQUALS( k.ts, 0 );
+      TS_ASSERT( idx.find( 2.0, &k ) );
+      TS_ASSERT_EQUALS( k.ts, 100 );
+      TS_ASSERT_EQUALS( k.pos, 4096 );
+      // the index is complete: nothing follows the last keyframe
+      TS_ASSERT( idx.find( 100.0, &k ) );
+      TS_ASSERT_EQUALS( k.ts, 200 );
+
+      idx.close();
+      TS_ASSERT( ! idx.find( 2.0, &k ) );
+#else
+      TS_WARN( "keyframe indexes need ffmpeg" );
+#endif
+   }
+
+   void testStaleIndex( void )
+   {
+#ifdef WITH_FFMPEG
+      KeyframeIndex idx;
+      KeyframeIndex::keyframe_t k;
+      struct utimbuf old = { 1, 1 };
+
+      // older than the movie: not loaded, and the movie can't be scanned
+      utime( index, &old );
+      idx.build( movie, 0, 0, 0.02 );
+      idx.close();
+      TS_ASSERT( ! idx.is_complete() );
+      TS_ASSERT( ! idx.find( 2.0, &k ) );
+#else
+      TS_WARN( "keyframe indexes need ffmpeg" );
+#endif
+   }
+
+private:
+   char movie[256];
+   char index[300];
+
+   bool wait_complete( KeyframeIndex *idx )
+   {
+      int c;
+      for( c = 0; c < 200 && ! idx->is_complete(); c++ )
+         usleep( 10000 );
+      return idx->is_complete();
+   }
+};
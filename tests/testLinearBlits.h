@@ -0,0 +1,74 @@
+#include <cxxtest/TestSuite.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <config.h>
+#include <jutils.h>
+#include <cpu_accel.h>
+#include <blitter.h>
+
+// the SIMD linear blits must give the same bytes as the scalar ones
+class TestLinearBlits : public CxxTest::TestSuite
+{
+public:
+   enum { MAX_PIXELS = 257, TRIALS = 64 };
+
+   void setUp( void )
+   {
+      set_debug(0);
+      setup_linear_blits( &scalar, 0 );
+      accel = mm_accel();
+      srand( 1 );
+   }
+
+   void testSimdMatchesScalar( void )
+   {
+      uint8_t src[MAX_PIXELS * 4 + 4], ref[MAX_PIXELS * 4 + 4], out[MAX_PIXELS * 4 + 4];
+      Blit *b;
+      Parameter *p;
+      blit_f *simd;
+      double v;
+      int trial, c, pixels, bytes, offset, tested = 0;
+
+      if( ! (accel & (MM_ACCEL_X86_SSE2 | MM_ACCEL_X86_AVX2)) ) {
+         TS_WARN( "no SIMD kernels on this cpu" );
+         return;
+      }
+
+      for( b = scalar.blitlist.begin(); b; b = (Blit*)b->next ) {
+         if( b->type != Blit::LINEAR ) continue;
+         simd = accel_linear_blit( b->name, accel );
+         if( ! simd ) continue;
+
+         for( trial = 0; trial < TRIALS; trial++ ) {
+            // odd row lengths and unaligned rows exercise the scalar tails
+            pixels = ( rand() % (MAX_PIXELS / 2) ) * 2 + 1;
+            bytes = pixels * 4;
+            offset = ( rand() % 4 );
+            for( c = 0; c < (int)sizeof(src); c++ ) {
+               src[c] = rand();
+               ref[c] = out[c] = rand();
+            }
+            // the first trials hit the ends of the range of the parameters
+            for( p = b->parameters.begin(); p; p = (Parameter*)p->next ) {
+               v = ( trial < 2 ) ? (double)trial : (double)rand() / RAND_MAX;
+               p->set( &v );
+            }
+
+            (*b->fun)( src + offset, ref + offset, bytes, &b->parameters );
+            (*simd)( src + offset, out + offset, bytes, &b->parameters );
+
+            TSM_ASSERT_SAME_DATA( b->name, ref, out, sizeof(ref) );
+            if( memcmp( ref, out, sizeof(ref) ) ) break; // once per blit is enough
+         }
+         tested++;
+      }
+
+      TS_ASSERT( tested > 0 );
+   }
+
+private:
+   Blitter scalar;
+   uint32_t accel;
+};
@@ -0,0 +1,87 @@
+#include <cxxtest/TestSuite.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <config.h>
+#include <jutils.h>
+#include <plugin_cache.h>
+
+// what was found of the plugins is read back as it was written
+class TestPluginCache : public CxxTest::TestSuite
+{
+public:
+   void setUp( void )
+   {
+      FILE *fd;
+
+      set_debug(0);
+      snprintf( registry, sizeof(registry), "/tmp/freej-test-%u.registry", (unsigned)getpid() );
+      snprintf( plugin, sizeof(plugin), "/tmp/freej-test-%u.so", (unsigned)getpid() );
+      fd = fopen( plugin, "w" );
+      fputs( "not a plugin", fd );
+      fclose( fd );
+      stat( plugin, &st );
+   }
+
+   void tearDown( void )
+   {
+      unlink( registry );
+      unlink( plugin );
+   }
+
+   void testRoundTrip( void )
+   {
+      PluginCache cache;
+      plugin_entry_t *e;
+      plugin_param_t param;
+      std::string longer( 20000, 'x' );
+
+      TS_ASSERT( ! cache.load( registry ) );
+      e = cache.add( plugin, &st );
+      e->kind = PLUGIN_FREI0R;
+      e->type = 2;
+      e->name = "mixer";
+      e->author = "some\tone";
+      e->explanation = longer;
+      e->version[1] = 1;
+      param.name = "amount";
+      param.explanation = longer;
+      param.type = 1;
+      e->params.push_back( param );
+      TS_ASSERT( cache.save() );
+
+      PluginCache again;
+      TS_ASSERT( again.load( registry ) );
+      e = again.find( plugin, &st );
+      TS_ASSERT( e != NULL );
+      if( ! e ) return;
+      TS_ASSERT_EQUALS( e->kind, (int)PLUGIN_FREI0R );
+      TS_ASSERT_EQUALS( e->type, 2 );
+      TS_ASSERT_EQUALS( e->name, "mixer" );
+      TS_ASSERT_EQUALS( e->author, "some one" ); // no tabs in the fields
+      TS_ASSERT_EQUALS( e->explanation, longer );
+      TS_ASSERT_EQUALS( e->version[1], 1 );
+      TS_ASSERT_EQUALS( e->params.size(), 1U );
+      TS_ASSERT_EQUALS( e->params[0].name, "amount" );
+      TS_ASSERT_EQUALS( e->params[0].explanation, longer );
+      TS_ASSERT_EQUALS( again.hits, 1 );
+   }
+
+   void testChangedFile( void )
+   {
+      PluginCache cache;
+
+      cache.load( registry ); // where it is saved
+      cache.add( plugin, &st );
+      cache.save();
+      TS_ASSERT( cache.load( registry ) );
+      st.st_size++;
+      TS_ASSERT( cache.find( plugin, &st ) == NULL );
+   }
+
+private:
+   char registry[256];
+   char plugin[256];
+   struct stat st;
+};
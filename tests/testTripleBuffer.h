@@ -0,0 +1,93 @@
+#include <cxxtest/TestSuite.h>
+
+#include <string.h>
+
+#include <config.h>
+#include <jutils.h>
+#include <triple_buffer.h>
+
+// frames go from one producer to one consumer, newest first
+class TestTripleBuffer : public CxxTest::TestSuite
+{
+public:
+   enum { BYTES = 64 };
+
+   void setUp( void )
+   {
+      set_debug(0);
+   }
+
+   void testEmpty( void )
+   {
+      TripleBuffer tb;
+      size_t bytes = 123;
+
+      TS_ASSERT( tb.front( &bytes ) == NULL );
+      TS_ASSERT_EQUALS( bytes, 123U );
+      TS_ASSERT_EQUALS( tb.published, 0U );
+   }
+
+   void testPublishCopies( void )
+   {
+      TripleBuffer tb;
+      uint8_t frame[BYTES];
+      size_t bytes = 0;
+      void *f;
+
+      memset( frame, 7, BYTES );
+      tb.publish( frame, BYTES );
+
+      f = tb.front( &bytes );
+      TS_ASSERT( f != NULL );
+      TS_ASSERT( f != (void*)frame );
+      TS_ASSERT_EQUALS( bytes, (size_t)BYTES );
+      TS_ASSERT_SAME_DATA( f, frame, BYTES );
+
+      // nothing new: the consumer keeps its frame
+      TS_ASSERT_EQUALS( tb.front(), f );
+   }
+
+   void testRenderInSlot( void )
+   {
+      TripleBuffer tb;
+      void *slot;
+
+      slot = tb.back( BYTES );
+      TS_ASSERT( slot != NULL );
+      memset( slot, 9, BYTES );
+      tb.publish( slot, BYTES );
+
+      // the slot itself is handed over, without copies
+      TS_ASSERT_EQUALS( tb.front(), slot );
+      // and the producer gets another one
+      TS_ASSERT_DIFFERS( tb.back( BYTES ), slot );
+   }
+
+   void testSlotNeverGrowsUnderFrame( void )
+   {
+      TripleBuffer tb;
+      void *slot;
+
+      slot = tb.back( BYTES );
+      tb.publish( slot, BYTES * 4 ); // rendered for a smaller geometry
+
+      TS_ASSERT_EQUALS( tb.published, 0U );
+      TS_ASSERT( tb.front() == NULL );
+      TS_ASSERT_EQUALS( tb.back( BYTES ), slot );
+   }
+
+   void testNewestWins( void )
+   {
+      TripleBuffer tb;
+      uint8_t frame[BYTES];
+      int c;
+
+      for( c = 1; c <= 3; c++ ) {
+         memset( frame, c, BYTES );
+         tb.publish( frame, BYTES );
+      }
+      TS_ASSERT_EQUALS( tb.published, 3U );
+      TS_ASSERT_EQUALS( tb.dropped, 2U );
+      TS_ASSERT_EQUALS( ((uint8_t*)tb.front())[0], 3 );
+   }
+};